@@ -0,0 +1,293 @@
+#!/usr/bin/env python3
+"""Benchmarks of playerctl and playerctld against a swarm of synthetic players.
+
+Every benchmark runs on its own private dbus-daemon with the players from
+mpris-swarm. Configure with `-Dbenchmarks=true` and run them from the build
+directory with `meson test --benchmark`, or by hand:
+
+    python3 bench/bench-swarm.py forwarding --swarm build/bench/mpris-swarm \\
+        --playerctl build/playerctl/playerctl \\
+        --playerctld build/playerctl/playerctld
+
+The benchmarks are:
+
+  forwarding  signals per second that playerctld takes in and forwards, and
+              the cpu time it spends on each signal
+  cli         wall clock time of one playerctl command
+  follow      time from a track change in a player to the line printed by
+              `playerctl --follow`, both directly and through playerctld
+  memory      resident memory of playerctld for each player it manages
+"""
+
+import argparse
+import asyncio
+import os
+import re
+import sys
+import time
+
+
+def percentile(samples, p):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * p / 100))]
+
+
+def report(name, samples, unit='ms', scale=1000):
+    if not samples:
+        print(f'{name:<40} no samples')
+        return
+    print(f'{name:<40} n {len(samples):>5}'
+          f'  p50 {percentile(samples, 50) * scale:>9.3f}{unit}'
+          f'  p90 {percentile(samples, 90) * scale:>9.3f}{unit}'
+          f'  p99 {percentile(samples, 99) * scale:>9.3f}{unit}'
+          f'  max {max(samples) * scale:>9.3f}{unit}')
+
+
+def read_proc_status(pid, field):
+    with open(f'/proc/{pid}/status') as f:
+        for line in f:
+            if line.startswith(field + ':'):
+                return int(line.split()[1])
+    return 0
+
+
+def read_cpu_seconds(pid):
+    with open(f'/proc/{pid}/stat') as f:
+        # the fields after the command name, which may contain spaces
+        fields = f.read().rsplit(')', 1)[1].split()
+    # utime and stime are fields 14 and 15 of the whole line
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+
+class Bench:
+    def __init__(self, args):
+        self.args = args
+        self.env = None
+        self.procs = []
+
+    async def spawn(self, *cmd, stdout=asyncio.subprocess.DEVNULL):
+        proc = await asyncio.create_subprocess_exec(
+            *cmd,
+            env=self.env,
+            stdout=stdout,
+            stderr=asyncio.subprocess.DEVNULL)
+        self.procs.append(proc)
+        return proc
+
+    async def run(self, *cmd):
+        proc = await asyncio.create_subprocess_exec(
+            *cmd,
+            env=self.env,
+            stdout=asyncio.subprocess.PIPE,
+            stderr=asyncio.subprocess.PIPE)
+        stdout, stderr = await proc.communicate()
+        return proc.returncode, stdout.decode(), stderr.decode()
+
+    async def start_bus(self):
+        proc = await asyncio.create_subprocess_exec(
+            'dbus-daemon',
+            '--session',
+            '--nofork',
+            '--print-address',
+            stdout=asyncio.subprocess.PIPE)
+        self.procs.append(proc)
+        address = (await proc.stdout.readline()).decode().strip()
+        self.env = dict(os.environ, DBUS_SESSION_BUS_ADDRESS=address)
+
+    async def start_swarm(self,
+                          players,
+                          properties_rate=0,
+                          seeked_rate=0,
+                          churn_rate=0):
+        proc = await self.spawn(self.args.swarm,
+                                '--players',
+                                str(players),
+                                '--properties-rate',
+                                str(properties_rate),
+                                '--seeked-rate',
+                                str(seeked_rate),
+                                '--churn-rate',
+                                str(churn_rate),
+                                stdout=asyncio.subprocess.PIPE)
+        line = await asyncio.wait_for(proc.stdout.readline(), 30)
+        if line.strip() != b'ready':
+            sys.exit(f'mpris-swarm did not start (exit code {proc.returncode})')
+        return proc
+
+    async def stats(self):
+        returncode, stdout, stderr = await self.run(self.args.playerctld,
+                                                    'stats')
+        if returncode != 0:
+            return None
+        # only the totals, which are not indented
+        return {
+            m.group(1): int(m.group(2))
+            for m in re.finditer(r'^(\w+): (\d+)$', stdout, re.MULTILINE)
+        }
+
+    async def start_playerctld(self):
+        proc = await self.spawn(self.args.playerctld)
+        for _ in range(100):
+            if await self.stats() is not None:
+                return proc
+            await asyncio.sleep(0.05)
+        sys.exit('playerctld did not start')
+
+    async def wait_settled(self, players):
+        """Waits for playerctld to know every player of the swarm"""
+        for _ in range(600):
+            stats = await self.stats()
+            returncode, stdout, _ = await self.run(self.args.playerctl, '-l')
+            names = [n for n in stdout.split() if n.startswith('swarm')]
+            if len(names) >= players and stats and stats.get(
+                    'PendingPlayers') == 0:
+                return
+            await asyncio.sleep(0.05)
+        sys.exit('playerctld did not pick up the swarm')
+
+    async def close(self):
+        for proc in reversed(self.procs):
+            if proc.returncode is None:
+                proc.terminate()
+                await proc.wait()
+
+    async def forwarding(self):
+        players = self.args.players
+        daemon = await self.start_playerctld()
+        await self.start_swarm(players, self.args.rate, self.args.rate / 10,
+                               self.args.churn)
+        await self.wait_settled(players)
+
+        before = await self.stats()
+        cpu_before = read_cpu_seconds(daemon.pid)
+        start = time.monotonic()
+        await asyncio.sleep(self.args.duration)
+        elapsed = time.monotonic() - start
+        after = await self.stats()
+        cpu = read_cpu_seconds(daemon.pid) - cpu_before
+
+        received = after['SignalsReceived'] - before['SignalsReceived']
+        forwarded = after['SignalsForwarded'] - before['SignalsForwarded']
+        emitted = after['SignalsEmitted'] - before['SignalsEmitted']
+        offered = players * self.args.rate * 1.1
+        print(f'{players} players at {self.args.rate:g} Hz, '
+              f'{self.args.churn:g} restarts/s for {elapsed:.1f}s')
+        print(f'{"signals offered/s":<40} {offered:>12.1f}')
+        print(f'{"signals received/s":<40} {received / elapsed:>12.1f}')
+        print(f'{"signals forwarded/s":<40} {forwarded / elapsed:>12.1f}')
+        print(f'{"signals emitted/s":<40} {emitted / elapsed:>12.1f}')
+        print(f'{"cpu time per received signal (us)":<40} '
+              f'{cpu * 1e6 / max(received, 1):>12.1f}')
+        print(f'{"cpu load (%)":<40} {cpu * 100 / elapsed:>12.1f}')
+
+    async def cli(self):
+        players = self.args.players
+        await self.start_playerctld()
+        await self.start_swarm(players)
+        await self.wait_settled(players)
+
+        for cmd in (('-p', 'swarm0', 'status'), ('status', ), ('-l', ),
+                    ('-p', 'playerctld', 'metadata', 'title')):
+            samples = []
+            for _ in range(self.args.runs):
+                start = time.perf_counter()
+                returncode, _, stderr = await self.run(self.args.playerctl,
+                                                       *cmd)
+                samples.append(time.perf_counter() - start)
+                if returncode != 0:
+                    sys.exit(f'playerctl {" ".join(cmd)} failed: {stderr}')
+            report(f'{players} players: {" ".join(cmd)}', samples)
+
+    async def follow_samples(self, player):
+        proc = await self.spawn(self.args.playerctl,
+                                '-p',
+                                player,
+                                '-F',
+                                'metadata',
+                                'title',
+                                stdout=asyncio.subprocess.PIPE)
+        samples = []
+        deadline = time.monotonic() + self.args.duration
+        # the first line is the state when playerctl started
+        skip = 1
+        while time.monotonic() < deadline:
+            try:
+                line = await asyncio.wait_for(proc.stdout.readline(),
+                                              deadline - time.monotonic())
+            except asyncio.TimeoutError:
+                break
+            now = time.monotonic_ns() // 1000
+            if not line:
+                break
+            if skip > 0:
+                skip -= 1
+                continue
+            # the title is the monotonic time of the change in microseconds
+            samples.append((now - int(line)) / 1e6)
+        proc.terminate()
+        await proc.wait()
+        return samples
+
+    async def follow(self):
+        players = self.args.players
+        await self.start_playerctld()
+        await self.start_swarm(players, self.args.rate)
+        await self.wait_settled(players)
+
+        samples = await self.follow_samples('swarm0')
+        report(f'{players} players: follow swarm0', samples)
+        samples = await self.follow_samples('playerctld')
+        report(f'{players} players: follow playerctld', samples)
+
+    async def memory(self):
+        daemon = await self.start_playerctld()
+        await asyncio.sleep(0.5)
+        base = read_proc_status(daemon.pid, 'VmRSS')
+        print(f'{"playerctld with no players (KiB)":<40} {base:>12}')
+
+        swarm = None
+        for players in sorted({10, 50, self.args.players}):
+            if players > self.args.players:
+                continue
+            # the names of the swarms overlap, so each one replaces the last
+            if swarm is not None:
+                swarm.terminate()
+                await swarm.wait()
+            swarm = await self.start_swarm(players)
+            await self.wait_settled(players)
+            await asyncio.sleep(0.5)
+            rss = read_proc_status(daemon.pid, 'VmRSS')
+            print(f'{f"playerctld with {players} players (KiB)":<40} '
+                  f'{rss:>12} {(rss - base) / players:>9.1f} KiB/player')
+
+async def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawTextHelpFormatter)
+    parser.add_argument('benchmark',
+                        choices=('forwarding', 'cli', 'follow', 'memory'))
+    parser.add_argument('--swarm', required=True, help='the mpris-swarm binary')
+    parser.add_argument('--playerctl', required=True)
+    parser.add_argument('--playerctld', required=True)
+    parser.add_argument('--players', type=int, default=100)
+    parser.add_argument('--rate',
+                        type=float,
+                        default=10,
+                        help='track changes per second of each player')
+    parser.add_argument('--churn',
+                        type=float,
+                        default=0,
+                        help='players that restart per second in forwarding')
+    parser.add_argument('--duration', type=float, default=5)
+    parser.add_argument('--runs', type=int, default=30)
+    args = parser.parse_args()
+
+    bench = Bench(args)
+    await bench.start_bus()
+    try:
+        await getattr(bench, args.benchmark)()
+    finally:
+        await bench.close()
+
+
+if __name__ == '__main__':
+    asyncio.run(main())
@@ -0,0 +1,239 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+/*
+ * Times the formatter on its own: how long it takes to parse each template of
+ * a corpus, how long it takes to render it against a synthetic context, and
+ * how many allocations each render makes.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "playerctl/playerctl-formatter.h"
+
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer)
+#define PCTL_SANITIZED 1
+#endif
+#endif
+#if defined(__SANITIZE_ADDRESS__)
+#define PCTL_SANITIZED 1
+#endif
+
+/*
+ * Allocations are counted by wrapping the glibc allocator. The sanitizers have
+ * their own allocator, so nothing is counted under them.
+ */
+#if defined(__GLIBC__) && !defined(PCTL_SANITIZED)
+#define COUNT_ALLOCATIONS 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static guint64 allocations = 0;
+
+void *malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    allocations++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
+/* Templates from the documentation, the tests, and status bar configurations */
+static const gchar *default_templates[] = {
+    "{{status}}",
+    "{{artist}} - {{title}}",
+    "Now playing: {{ artist }} - {{ album }} - {{ title }}",
+    "{{ playerName }}: {{ artist }} - {{ title }} {{ duration(position) }}|{{ "
+    "duration(mpris:length) }}",
+    "Time remaining: {{ duration(mpris:length - position) }}",
+    "Volume: {{ volume * 100 }}",
+    "STATUS: {{ uc(status) }}",
+    "{{ emoji(status) }} {{ trunc(title, 30) }}",
+    "{{ markup_escape(artist) }} - {{ markup_escape(title) }}",
+    "{{ default(xesam:albumArtist, artist) }} - {{ lc(album) }}",
+    "@{{ uc( \"hi\" ) }} - {{uc( lc( \"HO\"  ) ) }} . {{lc( uc(  title ) )   }}@",
+    "[{{ playerName }}] {{ emoji(status) }} {{ trunc(artist, 20) }} - {{ trunc(title, 40) }} "
+    "({{ duration(position) }}/{{ duration(mpris:length) }}) {{ emoji(volume) }} "
+    "{{ (volume * 100) / 10 }}",
+};
+
+static gint iterations_arg = 20000;
+static gchar *templates_arg = NULL;
+
+static const GOptionEntry entries[] = {
+    {"iterations", 'n', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &iterations_arg,
+     "Parse and render each template N times (default: 20000)", "N"},
+    {"templates", 't', G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &templates_arg,
+     "Read the templates from FILE, one on each line", "FILE"},
+    {NULL},
+};
+
+static GVariantDict *synthetic_context(void) {
+    GVariantDict *context = g_variant_dict_new(NULL);
+    const gchar *artists[] = {"The Artist", "Featured <Guest> & Friends", NULL};
+
+    g_variant_dict_insert(context, "playerName", "s", "spotify");
+    g_variant_dict_insert(context, "playerInstance", "s", "spotify.instance1234");
+    g_variant_dict_insert(context, "status", "s", "Playing");
+    g_variant_dict_insert(context, "loop", "s", "None");
+    g_variant_dict_insert(context, "shuffle", "b", FALSE);
+    g_variant_dict_insert(context, "volume", "d", 0.65);
+    g_variant_dict_insert(context, "position", "x", (gint64)83000000);
+    g_variant_dict_insert(context, "mpris:length", "x", (gint64)245000000);
+    g_variant_dict_insert(context, "mpris:trackid", "o", "/org/mpris/MediaPlayer2/Track/1");
+    g_variant_dict_insert_value(context, "artist", g_variant_new_strv(artists, -1));
+    g_variant_dict_insert_value(context, "xesam:artist", g_variant_new_strv(artists, -1));
+    g_variant_dict_insert(context, "title", "s", "A Rather Long Song Title (Extended Remix)");
+    g_variant_dict_insert(context, "xesam:title", "s",
+                          "A Rather Long Song Title (Extended Remix)");
+    g_variant_dict_insert(context, "album", "s", "The Album");
+    g_variant_dict_insert(context, "xesam:album", "s", "The Album");
+
+    return context;
+}
+
+static gchar **read_templates(const gchar *path, GError **error) {
+    gchar *contents = NULL;
+
+    if (!g_file_get_contents(path, &contents, NULL, error)) {
+        return NULL;
+    }
+
+    GPtrArray *templates = g_ptr_array_new();
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    for (gchar **line = lines; *line != NULL; ++line) {
+        if (**line != '\0' && **line != '#') {
+            g_ptr_array_add(templates, g_strdup(*line));
+        }
+    }
+    g_ptr_array_add(templates, NULL);
+
+    g_strfreev(lines);
+    g_free(contents);
+    return (gchar **)g_ptr_array_free(templates, FALSE);
+}
+
+/* Returns FALSE if the template does not parse or render */
+static gboolean bench_template(const gchar *template, GVariantDict *context, gint iterations) {
+    GError *error = NULL;
+
+    PlayerctlFormatter *formatter = playerctl_formatter_new(template, &error);
+    if (error != NULL) {
+        g_printerr("cannot parse \"%s\": %s\n", template, error->message);
+        g_clear_error(&error);
+        return FALSE;
+    }
+    gchar *expanded = playerctl_formatter_expand_format(formatter, context, &error);
+    if (error != NULL) {
+        g_printerr("cannot render \"%s\": %s\n", template, error->message);
+        g_clear_error(&error);
+        playerctl_formatter_destroy(formatter);
+        return FALSE;
+    }
+    g_free(expanded);
+
+    GTimer *timer = g_timer_new();
+    for (gint i = 0; i < iterations; ++i) {
+        playerctl_formatter_destroy(playerctl_formatter_new(template, NULL));
+    }
+    gdouble parse_time = g_timer_elapsed(timer, NULL);
+
+#ifdef COUNT_ALLOCATIONS
+    guint64 allocations_before = allocations;
+#endif
+    g_timer_start(timer);
+    for (gint i = 0; i < iterations; ++i) {
+        g_free(playerctl_formatter_expand_format(formatter, context, NULL));
+    }
+    gdouble render_time = g_timer_elapsed(timer, NULL);
+
+    printf("%10.3f %10.3f", parse_time * 1e9 / iterations, render_time * 1e9 / iterations);
+#ifdef COUNT_ALLOCATIONS
+    printf(" %10.1f", (gdouble)(allocations - allocations_before) / iterations);
+#else
+    printf(" %10s", "n/a");
+#endif
+    printf("  %s\n", template);
+
+    g_timer_destroy(timer);
+    playerctl_formatter_destroy(formatter);
+    return TRUE;
+}
+
+int main(int argc, char *argv[]) {
+    GError *error = NULL;
+    gchar **templates = NULL;
+    gboolean ok = TRUE;
+
+    GOptionContext *option_context = g_option_context_new("- Benchmark the format templates");
+    g_option_context_add_main_entries(option_context, entries, NULL);
+    if (!g_option_context_parse(option_context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        g_option_context_free(option_context);
+        return 1;
+    }
+    g_option_context_free(option_context);
+
+    if (iterations_arg < 1) {
+        g_printerr("The number of iterations must be positive: %d\n", iterations_arg);
+        return 1;
+    }
+
+    if (templates_arg != NULL) {
+        templates = read_templates(templates_arg, &error);
+        if (error != NULL) {
+            g_printerr("Cannot read templates: %s\n", error->message);
+            g_clear_error(&error);
+            return 1;
+        }
+    }
+
+    GVariantDict *context = synthetic_context();
+
+    printf("%10s %10s %10s  %s\n", "parse (ns)", "render (ns)", "allocs", "template");
+    if (templates != NULL) {
+        for (gchar **template = templates; *template != NULL; ++template) {
+            ok = bench_template(*template, context, iterations_arg) && ok;
+        }
+    } else {
+        for (gsize i = 0; i < G_N_ELEMENTS(default_templates); ++i) {
+            ok = bench_template(default_templates[i], context, iterations_arg) && ok;
+        }
+    }
+
+    g_variant_dict_unref(context);
+    g_strfreev(templates);
+    g_free(templates_arg);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,411 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+/*
+ * A swarm of synthetic MPRIS players for load and latency benchmarks. Each
+ * player has its own connection to the bus, like a real player, and changes
+ * its track, seeks, and drops and takes back its name at the given rates.
+ *
+ * The title of each track is the CLOCK_MONOTONIC time in microseconds when the
+ * track changed, so a client can tell how long the change took to reach it.
+ * "ready" is printed on stdout once every player owns its name.
+ */
+
+#include <gio/gio.h>
+#include <glib-unix.h>
+#include <signal.h>
+#include <stdio.h>
+
+#define MPRIS_PATH "/org/mpris/MediaPlayer2"
+#define ROOT_INTERFACE "org.mpris.MediaPlayer2"
+#define PLAYER_INTERFACE "org.mpris.MediaPlayer2.Player"
+#define PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
+
+static const char *mpris_introspection_xml =
+    "<node>\n"
+    "  <interface name=\"org.mpris.MediaPlayer2\">\n"
+    "    <method name=\"Raise\"/>\n"
+    "    <method name=\"Quit\"/>\n"
+    "    <property name=\"CanQuit\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"CanRaise\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"HasTrackList\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"Identity\" type=\"s\" access=\"read\"/>\n"
+    "    <property name=\"SupportedUriSchemes\" type=\"as\" access=\"read\"/>\n"
+    "    <property name=\"SupportedMimeTypes\" type=\"as\" access=\"read\"/>\n"
+    "  </interface>\n"
+    "  <interface name=\"org.mpris.MediaPlayer2.Player\">\n"
+    "    <method name=\"Next\"/>\n"
+    "    <method name=\"Previous\"/>\n"
+    "    <method name=\"Pause\"/>\n"
+    "    <method name=\"PlayPause\"/>\n"
+    "    <method name=\"Stop\"/>\n"
+    "    <method name=\"Play\"/>\n"
+    "    <method name=\"Seek\">\n"
+    "      <arg direction=\"in\" name=\"Offset\" type=\"x\"/>\n"
+    "    </method>\n"
+    "    <method name=\"SetPosition\">\n"
+    "      <arg direction=\"in\" name=\"TrackId\" type=\"o\"/>\n"
+    "      <arg direction=\"in\" name=\"Position\" type=\"x\"/>\n"
+    "    </method>\n"
+    "    <method name=\"OpenUri\">\n"
+    "      <arg direction=\"in\" name=\"Uri\" type=\"s\"/>\n"
+    "    </method>\n"
+    "    <signal name=\"Seeked\">\n"
+    "      <arg name=\"Position\" type=\"x\"/>\n"
+    "    </signal>\n"
+    "    <property name=\"PlaybackStatus\" type=\"s\" access=\"read\"/>\n"
+    "    <property name=\"LoopStatus\" type=\"s\" access=\"read\"/>\n"
+    "    <property name=\"Rate\" type=\"d\" access=\"read\"/>\n"
+    "    <property name=\"Shuffle\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"Metadata\" type=\"a{sv}\" access=\"read\"/>\n"
+    "    <property name=\"Volume\" type=\"d\" access=\"read\"/>\n"
+    "    <property name=\"Position\" type=\"x\" access=\"read\"/>\n"
+    "    <property name=\"MinimumRate\" type=\"d\" access=\"read\"/>\n"
+    "    <property name=\"MaximumRate\" type=\"d\" access=\"read\"/>\n"
+    "    <property name=\"CanGoNext\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"CanGoPrevious\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"CanPlay\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"CanPause\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"CanSeek\" type=\"b\" access=\"read\"/>\n"
+    "    <property name=\"CanControl\" type=\"b\" access=\"read\"/>\n"
+    "  </interface>\n"
+    "</node>\n";
+
+struct SwarmPlayer {
+    struct Swarm *swarm;
+    GDBusConnection *connection;
+    gchar *name;
+    guint owner_id;
+    gboolean owned;
+    // the track number and when the track started, which is also its title
+    guint64 track;
+    gint64 track_time;
+    gint64 position;
+};
+
+struct Swarm {
+    GMainLoop *loop;
+    GDBusNodeInfo *introspection_data;
+    struct SwarmPlayer *players;
+    guint n_players;
+    guint n_owned;
+    gboolean ready;
+    // the next player to drop and take back its name
+    guint next_churn;
+};
+
+static gchar *address_arg = NULL;
+static gchar *name_arg = NULL;
+static gint players_arg = 10;
+static gdouble properties_rate_arg = 10;
+static gdouble seeked_rate_arg = 1;
+static gdouble churn_rate_arg = 0;
+static gint duration_arg = 0;
+
+static const GOptionEntry entries[] = {
+    {"address", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &address_arg,
+     "The address of the bus (default: the session bus)", "ADDRESS"},
+    {"name", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &name_arg,
+     "The players are named NAME0, NAME1, and so on (default: swarm)", "NAME"},
+    {"players", 'n', G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &players_arg,
+     "The number of players (default: 10)", "N"},
+    {"properties-rate", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &properties_rate_arg,
+     "Track changes per second of each player (default: 10)", "HZ"},
+    {"seeked-rate", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &seeked_rate_arg,
+     "Seeks per second of each player (default: 1)", "HZ"},
+    {"churn-rate", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_DOUBLE, &churn_rate_arg,
+     "Names dropped and taken back per second over all players (default: 0)", "HZ"},
+    {"duration", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &duration_arg,
+     "Exit after SECONDS (default: run until interrupted)", "SECONDS"},
+    {NULL},
+};
+
+static GVariant *player_metadata(struct SwarmPlayer *player) {
+    GVariantBuilder builder;
+    gchar trackid[64];
+    gchar title[32];
+
+    g_snprintf(trackid, sizeof(trackid), "/org/playerctl/swarm/track/%" G_GUINT64_FORMAT,
+               player->track);
+    g_snprintf(title, sizeof(title), "%" G_GINT64_FORMAT, player->track_time);
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "mpris:trackid", g_variant_new_object_path(trackid));
+    g_variant_builder_add(&builder, "{sv}", "mpris:length", g_variant_new_int64(180000000));
+    g_variant_builder_add(&builder, "{sv}", "xesam:title", g_variant_new_string(title));
+    g_variant_builder_add(&builder, "{sv}", "xesam:album", g_variant_new_string("Swarm"));
+    const gchar *artists[] = {player->name, NULL};
+    g_variant_builder_add(&builder, "{sv}", "xesam:artist", g_variant_new_strv(artists, -1));
+    return g_variant_builder_end(&builder);
+}
+
+static GVariant *get_property_callback(GDBusConnection *connection, const gchar *sender,
+                                       const gchar *object_path, const gchar *interface_name,
+                                       const gchar *property_name, GError **error,
+                                       gpointer user_data) {
+    struct SwarmPlayer *player = user_data;
+
+    if (g_strcmp0(property_name, "Identity") == 0) {
+        return g_variant_new_string(player->name);
+    } else if (g_strcmp0(property_name, "SupportedUriSchemes") == 0 ||
+               g_strcmp0(property_name, "SupportedMimeTypes") == 0) {
+        return g_variant_new_strv(NULL, 0);
+    } else if (g_strcmp0(property_name, "CanQuit") == 0 ||
+               g_strcmp0(property_name, "CanRaise") == 0 ||
+               g_strcmp0(property_name, "HasTrackList") == 0 ||
+               g_strcmp0(property_name, "Shuffle") == 0) {
+        return g_variant_new_boolean(FALSE);
+    } else if (g_str_has_prefix(property_name, "Can")) {
+        return g_variant_new_boolean(TRUE);
+    } else if (g_strcmp0(property_name, "PlaybackStatus") == 0) {
+        return g_variant_new_string("Playing");
+    } else if (g_strcmp0(property_name, "LoopStatus") == 0) {
+        return g_variant_new_string("None");
+    } else if (g_strcmp0(property_name, "Rate") == 0 ||
+               g_strcmp0(property_name, "MinimumRate") == 0 ||
+               g_strcmp0(property_name, "MaximumRate") == 0 ||
+               g_strcmp0(property_name, "Volume") == 0) {
+        return g_variant_new_double(1.0);
+    } else if (g_strcmp0(property_name, "Metadata") == 0) {
+        return player_metadata(player);
+    } else if (g_strcmp0(property_name, "Position") == 0) {
+        return g_variant_new_int64(player->position);
+    }
+
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY, "Unknown property: %s",
+                property_name);
+    return NULL;
+}
+
+static void method_call_callback(GDBusConnection *connection, const gchar *sender,
+                                 const gchar *object_path, const gchar *interface_name,
+                                 const gchar *method_name, GVariant *parameters,
+                                 GDBusMethodInvocation *invocation, gpointer user_data) {
+    // the players accept every call and change nothing
+    g_dbus_method_invocation_return_value(invocation, NULL);
+}
+
+static const GDBusInterfaceVTable vtable = {method_call_callback, get_property_callback, NULL};
+
+static void emit_signal(struct SwarmPlayer *player, const gchar *interface_name,
+                        const gchar *signal_name, GVariant *parameters) {
+    GError *error = NULL;
+
+    g_dbus_connection_emit_signal(player->connection, NULL, MPRIS_PATH, interface_name,
+                                  signal_name, parameters, &error);
+    if (error != NULL) {
+        g_warning("%s: could not emit %s: %s", player->name, signal_name, error->message);
+        g_clear_error(&error);
+    }
+}
+
+static gboolean properties_timeout_callback(gpointer user_data) {
+    struct SwarmPlayer *player = user_data;
+    GVariantBuilder changed;
+
+    if (!player->owned) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    player->track++;
+    player->track_time = g_get_monotonic_time();
+    player->position = 0;
+
+    g_variant_builder_init(&changed, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&changed, "{sv}", "Metadata", player_metadata(player));
+    emit_signal(player, PROPERTIES_INTERFACE, "PropertiesChanged",
+                g_variant_new("(sa{sv}@as)", PLAYER_INTERFACE, &changed,
+                              g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0)));
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean seeked_timeout_callback(gpointer user_data) {
+    struct SwarmPlayer *player = user_data;
+
+    if (!player->owned) {
+        return G_SOURCE_CONTINUE;
+    }
+
+    player->position += 5000000;
+    emit_signal(player, PLAYER_INTERFACE, "Seeked", g_variant_new("(x)", player->position));
+    return G_SOURCE_CONTINUE;
+}
+
+static void name_acquired_callback(GDBusConnection *connection, const gchar *name,
+                                   gpointer user_data) {
+    struct SwarmPlayer *player = user_data;
+    struct Swarm *swarm = player->swarm;
+
+    player->owned = TRUE;
+    swarm->n_owned++;
+    if (!swarm->ready && swarm->n_owned == swarm->n_players) {
+        swarm->ready = TRUE;
+        printf("ready\n");
+        fflush(stdout);
+    }
+}
+
+static void name_lost_callback(GDBusConnection *connection, const gchar *name,
+                               gpointer user_data) {
+    struct SwarmPlayer *player = user_data;
+
+    if (player->owned) {
+        player->owned = FALSE;
+        player->swarm->n_owned--;
+    }
+    if (connection == NULL) {
+        g_printerr("%s: lost the connection to the bus\n", player->name);
+        g_main_loop_quit(player->swarm->loop);
+    }
+}
+
+static void player_own_name(struct SwarmPlayer *player) {
+    gchar *well_known = g_strconcat("org.mpris.MediaPlayer2.", player->name, NULL);
+    player->owner_id = g_bus_own_name_on_connection(
+        player->connection, well_known, G_BUS_NAME_OWNER_FLAGS_DO_NOT_QUEUE,
+        name_acquired_callback, name_lost_callback, player, NULL);
+    g_free(well_known);
+}
+
+static gboolean churn_timeout_callback(gpointer user_data) {
+    struct Swarm *swarm = user_data;
+    struct SwarmPlayer *player = &swarm->players[swarm->next_churn];
+    swarm->next_churn = (swarm->next_churn + 1) % swarm->n_players;
+
+    // the name disappears and comes back, like a player that restarts
+    if (player->owned) {
+        player->owned = FALSE;
+        swarm->n_owned--;
+    }
+    g_bus_unown_name(player->owner_id);
+    player_own_name(player);
+    return G_SOURCE_CONTINUE;
+}
+
+static guint add_rate_timeout(gdouble rate, GSourceFunc callback, gpointer user_data) {
+    if (rate <= 0) {
+        return 0;
+    }
+    return g_timeout_add(MAX((guint)(1000 / rate), 1), callback, user_data);
+}
+
+static gboolean player_init(struct SwarmPlayer *player, struct Swarm *swarm, guint index,
+                            GError **error) {
+    GError *tmp_error = NULL;
+
+    player->swarm = swarm;
+    player->name = g_strdup_printf("%s%u", (name_arg != NULL ? name_arg : "swarm"), index);
+    player->track_time = g_get_monotonic_time();
+
+    player->connection = g_dbus_connection_new_for_address_sync(
+        address_arg,
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+            G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(error, tmp_error);
+        return FALSE;
+    }
+
+    for (guint i = 0; swarm->introspection_data->interfaces[i] != NULL; ++i) {
+        g_dbus_connection_register_object(player->connection, MPRIS_PATH,
+                                          swarm->introspection_data->interfaces[i], &vtable,
+                                          player, NULL, &tmp_error);
+        if (tmp_error != NULL) {
+            g_propagate_error(error, tmp_error);
+            return FALSE;
+        }
+    }
+
+    player_own_name(player);
+    add_rate_timeout(properties_rate_arg, properties_timeout_callback, player);
+    add_rate_timeout(seeked_rate_arg, seeked_timeout_callback, player);
+    return TRUE;
+}
+
+static gboolean quit_callback(gpointer user_data) {
+    struct Swarm *swarm = user_data;
+    g_main_loop_quit(swarm->loop);
+    return G_SOURCE_REMOVE;
+}
+
+int main(int argc, char *argv[]) {
+    struct Swarm swarm = {0};
+    GError *error = NULL;
+
+    GOptionContext *context = g_option_context_new("- Synthetic MPRIS players for benchmarks");
+    g_option_context_add_main_entries(context, entries, NULL);
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        g_option_context_free(context);
+        return 1;
+    }
+    g_option_context_free(context);
+
+    if (players_arg < 1) {
+        g_printerr("The number of players must be positive: %d\n", players_arg);
+        return 1;
+    }
+
+    if (address_arg == NULL) {
+        address_arg = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SESSION, NULL, &error);
+        if (error != NULL) {
+            g_printerr("could not get bus address: %s\n", error->message);
+            g_clear_error(&error);
+            return 1;
+        }
+    }
+
+    swarm.loop = g_main_loop_new(NULL, FALSE);
+    swarm.introspection_data = g_dbus_node_info_new_for_xml(mpris_introspection_xml, NULL);
+    swarm.n_players = players_arg;
+    swarm.players = g_new0(struct SwarmPlayer, swarm.n_players);
+
+    for (guint i = 0; i < swarm.n_players; ++i) {
+        if (!player_init(&swarm.players[i], &swarm, i, &error)) {
+            g_printerr("could not start player %u: %s\n", i, error->message);
+            g_clear_error(&error);
+            return 1;
+        }
+    }
+
+    add_rate_timeout(churn_rate_arg, churn_timeout_callback, &swarm);
+    if (duration_arg > 0) {
+        g_timeout_add_seconds(duration_arg, quit_callback, &swarm);
+    }
+    g_unix_signal_add(SIGINT, quit_callback, &swarm);
+    g_unix_signal_add(SIGTERM, quit_callback, &swarm);
+
+    g_main_loop_run(swarm.loop);
+
+    for (guint i = 0; i < swarm.n_players; ++i) {
+        g_bus_unown_name(swarm.players[i].owner_id);
+        g_dbus_connection_flush_sync(swarm.players[i].connection, NULL, NULL);
+        g_object_unref(swarm.players[i].connection);
+        g_free(swarm.players[i].name);
+    }
+    g_free(swarm.players);
+    g_dbus_node_info_unref(swarm.introspection_data);
+    g_main_loop_unref(swarm.loop);
+    g_free(address_arg);
+    g_free(name_arg);
+
+    return 0;
+}
@@ -21,8 +21,13 @@ _playerctl_completions() {
 		-p --player=
 		-a --all-players
 		-i --ignore-player=
+		--source=
+		--timeout=
+		--timings
 		-f --format
+		--json
 		-F --follow
+		--debounce=
 		-l --list-all
 		-v --version"
 
@@ -39,6 +44,14 @@ _playerctl_completions() {
 			COMPREPLY=($(compgen -W "$(playerctl --list-all)" -- "$cur"))
 			return 0
 			;;
+		--source=)
+			COMPREPLY=($(compgen -W "auto session system all" -- "$cur"))
+			return 0
+			;;
+		--timeout=|--debounce=)
+			COMPREPLY=()
+			return 0
+			;;
 		-f|--format)
 			COMPREPLY=()
 			return 0
@@ -0,0 +1,72 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+/*
+ * A libFuzzer harness for the format template parser. Each input is parsed
+ * with playerctl_formatter_new(), which runs tokenize_format() and the
+ * recursive tokenize_expression(), and every template that parses is rendered
+ * against a small context so the evaluator sees the same trees.
+ */
+
+#include <glib.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "playerctl/playerctl-formatter.h"
+
+static GVariantDict *context = NULL;
+
+static GVariantDict *fuzz_context(void) {
+    GVariantDict *context = g_variant_dict_new(NULL);
+    const gchar *artists[] = {"Artist", NULL};
+
+    g_variant_dict_insert(context, "status", "s", "Playing");
+    g_variant_dict_insert(context, "volume", "d", 0.5);
+    g_variant_dict_insert(context, "position", "x", (gint64)1000000);
+    g_variant_dict_insert(context, "mpris:length", "x", (gint64)2000000);
+    g_variant_dict_insert_value(context, "artist", g_variant_new_strv(artists, -1));
+    g_variant_dict_insert(context, "title", "s", "<Title>");
+
+    return context;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    GError *error = NULL;
+
+    if (context == NULL) {
+        context = fuzz_context();
+    }
+
+    // templates are C strings, so the input ends at the first nul
+    gchar *template = g_strndup((const gchar *)data, size);
+
+    PlayerctlFormatter *formatter = playerctl_formatter_new(template, &error);
+    if (error != NULL) {
+        g_clear_error(&error);
+        g_free(template);
+        return 0;
+    }
+
+    g_free(playerctl_formatter_expand_format(formatter, context, &error));
+    g_clear_error(&error);
+
+    playerctl_formatter_destroy(formatter);
+    g_free(template);
+    return 0;
+}
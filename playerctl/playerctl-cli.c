@@ -26,10 +26,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "playerctl-common.h"
 #include "playerctl-formatter.h"
+#include "playerctl-json.h"
 #include "playerctl-player-private.h"
+#include "playerctl-trace.h"
 
 #define LENGTH(array) (sizeof array / sizeof array[0])
 
@@ -45,6 +48,16 @@ static gchar *player_arg = NULL;
 static gchar *ignore_player_arg = NULL;
 /* If true, control all available media players */
 static gboolean select_all_players;
+/* The source of the players to control: "auto", "session", "system", or "all" */
+static gchar *source_arg = NULL;
+/* The source parsed from the --source arg, PLAYERCTL_SOURCE_NONE for all sources */
+static PlayerctlSource selected_source = PLAYERCTL_SOURCE_NONE;
+/* If true, only connect to the system bus when no player is selected on the session bus */
+static gboolean source_is_auto = TRUE;
+/* The time in milliseconds the command may take, or -1 for no limit */
+static gint timeout_arg = -1;
+/* The monotonic time by which the command must finish, or 0 for no limit */
+static gint64 invocation_deadline = 0;
 /* If true, list all available players' names and exit. */
 static gboolean list_all_players_and_exit;
 /* If true, print the version and exit. */
@@ -59,60 +72,54 @@ static gchar *format_string_arg = NULL;
 static PlayerctlFormatter *formatter = NULL;
 /* Block and follow the command */
 static gboolean follow = FALSE;
+/* Print the state of the player as JSON for queries */
+static gboolean json_output = FALSE;
 /* The main loop for the follow command */
 static GMainLoop *main_loop = NULL;
-/* The last output printed by the cli */
-static gchar *last_output = NULL;
+/* If true, the output of the follow command shows the position and is rendered as it advances */
+static gboolean follow_position = FALSE;
+/* The timeout source for the next render of the position, or 0 if none is scheduled */
+static guint position_tick_id = 0;
+/* The time in milliseconds to wait for more changes before printing in follow mode */
+static gint debounce_arg = 0;
+/* The source of the pending render in follow mode, or 0 if none is pending */
+static guint render_source_id = 0;
 /* The manager of all the players we connect to */
 static PlayerctlPlayerManager *manager = NULL;
 /* List of player names parsed from the --player arg */
-static GList *player_names = NULL;
-/* List of ignored player names passed from the --ignore-player arg*/
-static GList *ignored_player_names = NULL;
+static gchar **player_names = NULL;
+/* If true, print how long each phase of the invocation took to stderr */
+static gboolean print_timings = FALSE;
+/* The time main() was entered, which the timings are relative to */
+static gint64 timings_origin = 0;
+/* The phases timed for --timings, or NULL when they are not timed */
+static GArray *timings = NULL;
+/* Matches the players selected by the --player and --ignore-player args */
+static PlayerctlPlayerSelector *player_selector = NULL;
 
 /* forward definitions */
 static void managed_players_execute_command(GError **error);
-
-/*
- * Sometimes players may notify metadata when nothing we care about has
- * changed, so we have this to avoid printing duplicate lines in follow
- * mode. Prints a newline if output is NULL which denotes that the property has
- * been cleared. Only use this in follow mode.
- *
- * This consumes the output string.
- */
-static void cli_print_output(gchar *output) {
-    if (output == NULL && last_output == NULL) {
-        return;
-    }
-
-    if (output == NULL) {
-        output = g_strdup("\n");
-    }
-
-    if (g_strcmp0(output, last_output) == 0) {
-        g_free(output);
-        return;
-    }
-
-    printf("%s", output);
-    fflush(stdout);
-    g_free(last_output);
-    last_output = output;
-}
+static gboolean playercmd_tick_callback(gpointer data);
 
 struct playercmd_args {
     gchar **argv;
     gint argc;
+    const struct player_command *command;
+    // the hash and length of the last output printed for the command, or a
+    // length of zero when nothing has been printed
+    guint last_output_hash;
+    gsize last_output_len;
 };
 
-/* Arguments given to the player for the follow command */
-static struct playercmd_args *playercmd_args = NULL;
+/* The commands to follow with the arguments given to the player for them */
+static GPtrArray *followed_commands = NULL;
 
-static struct playercmd_args *playercmd_args_create(gchar **argv, gint argc) {
+static struct playercmd_args *playercmd_args_create(gchar **argv, gint argc,
+                                                    const struct player_command *command) {
     struct playercmd_args *user_data = calloc(1, sizeof(struct playercmd_args));
     user_data->argc = argc;
     user_data->argv = g_strdupv(argv);
+    user_data->command = command;
     return user_data;
 }
 
@@ -127,19 +134,68 @@ static void playercmd_args_destroy(struct playercmd_args *data) {
     return;
 }
 
+/*
+ * Prints each line of the output after the name of the command so the
+ * outputs of several followed commands can be told apart.
+ */
+static void print_tagged_output(const gchar *tag, const gchar *output) {
+    gchar **lines = g_strsplit(output, "\n", -1);
+    for (gsize i = 0; lines[i] != NULL; ++i) {
+        if (lines[i + 1] == NULL && lines[i][0] == '\0') {
+            // the output ends with a newline
+            break;
+        }
+        printf("%s\t%s\n", tag, lines[i]);
+    }
+    g_strfreev(lines);
+}
+
+/*
+ * Sometimes players may notify metadata when nothing we care about has
+ * changed, so we have this to avoid printing duplicate lines in follow
+ * mode. Prints a newline if output is NULL which denotes that the property has
+ * been cleared. Only use this in follow mode.
+ *
+ * Only the hash and length of the output are kept, so the output may be a
+ * buffer that is reused for the next one.
+ */
+static void cli_print_output(struct playercmd_args *args, const gchar *output) {
+    if (output == NULL && args->last_output_len == 0) {
+        return;
+    }
+
+    if (output == NULL) {
+        output = "\n";
+    }
+
+    guint output_hash = g_str_hash(output);
+    gsize output_len = strlen(output);
+    if (output_len == args->last_output_len && output_hash == args->last_output_hash) {
+        return;
+    }
+
+    if (followed_commands->len > 1) {
+        print_tagged_output(args->command->name, output);
+    } else {
+        printf("%s", output);
+    }
+    fflush(stdout);
+    args->last_output_hash = output_hash;
+    args->last_output_len = output_len;
+}
+
 static gchar *get_metadata_formatted(PlayerctlPlayer *player, GError **error) {
     GError *tmp_error = NULL;
-    GVariant *metadata = NULL;
 
     g_return_val_if_fail(formatter != NULL, NULL);
 
-    g_object_get(player, "metadata", &metadata, NULL);
-    if (metadata == NULL) {
+    struct pctl_metadata *metadata = pctl_player_get_metadata_model(player, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(error, tmp_error);
         return NULL;
     }
 
-    if (g_variant_n_children(metadata) == 0) {
-        g_variant_unref(metadata);
+    if (metadata == NULL || pctl_metadata_get_n_entries(metadata) == 0) {
         return NULL;
     }
 
@@ -148,13 +204,11 @@ static gchar *get_metadata_formatted(PlayerctlPlayer *player, GError **error) {
 
     gchar *result = playerctl_formatter_expand_format(formatter, context, &tmp_error);
     if (tmp_error) {
-        g_variant_unref(metadata);
         g_variant_dict_unref(context);
         g_propagate_error(error, tmp_error);
         return NULL;
     }
 
-    g_variant_unref(metadata);
     g_variant_dict_unref(context);
 
     return result;
@@ -681,6 +735,15 @@ static gboolean playercmd_metadata(PlayerctlPlayer *player, gchar **argv, gint a
             g_debug("%s: no metadata, skipping", instance);
             return FALSE;
         }
+    } else if (argc == 1 && !follow && !select_all_players) {
+        // stream the table straight to stdout instead of building it up first
+        fflush(stdout);
+        gboolean result = pctl_player_write_metadata_table(player, STDOUT_FILENO, &tmp_error);
+        if (tmp_error) {
+            g_propagate_error(error, tmp_error);
+            return FALSE;
+        }
+        return result;
     } else if (argc == 1) {
         gchar *data = playerctl_player_print_metadata_prop(player, NULL, &tmp_error);
         if (tmp_error) {
@@ -726,23 +789,222 @@ static gboolean playercmd_metadata(PlayerctlPlayer *player, gchar **argv, gint a
     return TRUE;
 }
 
+static void json_buffer_free(gpointer data) {
+    g_string_free(data, TRUE);
+}
+
+/* The buffer each thread writes JSON documents into, kept to reuse its memory */
+static GPrivate json_buffer = G_PRIVATE_INIT(json_buffer_free);
+
+static GString *json_buffer_get(void) {
+    GString *buffer = g_private_get(&json_buffer);
+    if (buffer == NULL) {
+        buffer = g_string_sized_new(1024);
+        g_private_set(&json_buffer, buffer);
+    }
+    g_string_truncate(buffer, 0);
+    return buffer;
+}
+
+/* Takes the contents of the buffer of this thread, so they can outlive it */
+static gchar *json_buffer_steal(void) {
+    GString *buffer = g_private_get(&json_buffer);
+    g_private_set(&json_buffer, NULL);
+    return buffer != NULL ? g_string_free(buffer, FALSE) : NULL;
+}
+
+/*
+ * Writes the state of the player as one line of JSON. The position is given
+ * as an anchor: the position in microseconds at a CLOCK_MONOTONIC time in
+ * microseconds, from which it advances at the rate while the player is
+ * playing. The anchor only changes when the player seeks or changes status, so
+ * followed output is not repeated as the position advances.
+ */
+static gboolean playercmd_json(PlayerctlPlayer *player, gchar **argv, gint argc, gchar **output,
+                               GError **error) {
+    GError *tmp_error = NULL;
+    gchar *instance = pctl_player_get_instance(player);
+
+    struct pctl_metadata *metadata = pctl_player_get_metadata_model(player, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(error, tmp_error);
+        return FALSE;
+    }
+
+    gchar *player_name = NULL;
+    PlayerctlPlaybackStatus status = 0;
+    PlayerctlLoopStatus loop_status = 0;
+    gboolean shuffle = FALSE;
+    gdouble volume = 0;
+    gdouble rate = 1.0;
+    g_object_get(player, "player-name", &player_name, "playback-status", &status, "loop-status",
+                 &loop_status, "shuffle", &shuffle, "volume", &volume, "rate", &rate, NULL);
+
+    gint64 position_monotonic = 0;
+    gint64 position = pctl_player_get_position_anchor(player, &position_monotonic);
+
+    struct pctl_json_writer writer;
+    pctl_json_writer_init(&writer, json_buffer_get());
+
+    pctl_json_begin_object(&writer);
+    pctl_json_key(&writer, "playerName");
+    pctl_json_string(&writer, player_name);
+    pctl_json_key(&writer, "playerInstance");
+    pctl_json_string(&writer, instance);
+
+    pctl_json_key(&writer, "status");
+    if (pctl_player_has_cached_property(player, "PlaybackStatus")) {
+        pctl_json_string(&writer, pctl_playback_status_to_string(status));
+    } else {
+        pctl_json_null(&writer);
+    }
+
+    pctl_json_key(&writer, "position");
+    pctl_json_int64(&writer, position);
+    pctl_json_key(&writer, "positionMonotonic");
+    pctl_json_int64(&writer, position_monotonic);
+    pctl_json_key(&writer, "rate");
+    pctl_json_double(&writer, rate);
+
+    pctl_json_key(&writer, "volume");
+    if (pctl_player_has_cached_property(player, "Volume")) {
+        pctl_json_double(&writer, volume);
+    } else {
+        pctl_json_null(&writer);
+    }
+
+    pctl_json_key(&writer, "loop");
+    if (pctl_player_has_cached_property(player, "LoopStatus")) {
+        pctl_json_string(&writer, pctl_loop_status_to_string(loop_status));
+    } else {
+        pctl_json_null(&writer);
+    }
+
+    pctl_json_key(&writer, "shuffle");
+    if (pctl_player_has_cached_property(player, "Shuffle")) {
+        pctl_json_boolean(&writer, shuffle);
+    } else {
+        pctl_json_null(&writer);
+    }
+
+    pctl_json_key(&writer, "metadata");
+    if (metadata != NULL) {
+        pctl_json_variant(&writer, pctl_metadata_get_raw(metadata));
+    } else {
+        pctl_json_begin_object(&writer);
+        pctl_json_end_object(&writer);
+    }
+    pctl_json_end_object(&writer);
+    g_string_append_c(writer.buffer, '\n');
+
+    // the output is borrowed from the buffer until the next document is written on this thread
+    *output = writer.buffer->str;
+
+    g_free(player_name);
+    return TRUE;
+}
+
+static gboolean render_callback(gpointer data) {
+    GError *tmp_error = NULL;
+    render_source_id = 0;
+    managed_players_execute_command(&tmp_error);
+    if (tmp_error != NULL) {
+        exit_status = 1;
+        g_printerr("Could not execute command: %s\n", tmp_error->message);
+        g_clear_error(&tmp_error);
+        g_main_loop_quit(main_loop);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Renders the output of the follow command once the main loop has handled
+ * the changes that are pending, so the signals of one change only render
+ * once. With --debounce, waits that long for more changes instead.
+ */
+static void schedule_render() {
+    if (render_source_id != 0) {
+        return;
+    }
+
+    if (debounce_arg > 0) {
+        render_source_id = g_timeout_add(debounce_arg, render_callback, NULL);
+    } else {
+        render_source_id = g_idle_add(render_callback, NULL);
+    }
+}
+
 static void managed_player_properties_callback(PlayerctlPlayer *player, gpointer data) {
     playerctl_player_manager_move_player_to_top(manager, player);
-    GError *error = NULL;
-    managed_players_execute_command(&error);
+    schedule_render();
+}
+
+static void managed_player_properties_changed_callback(PlayerctlPlayer *player,
+                                                       PlayerctlPlayerPropertyFlags changed,
+                                                       GVariant *values, gpointer data) {
+    PlayerctlPlayerPropertyFlags follow_properties = GPOINTER_TO_UINT(data);
+    if ((changed & follow_properties) == 0) {
+        return;
+    }
+
+    managed_player_properties_callback(player, NULL);
 }
 
 static gboolean playercmd_tick_callback(gpointer data) {
     GError *tmp_error = NULL;
+    // rendering schedules the next tick
+    position_tick_id = 0;
     managed_players_execute_command(&tmp_error);
     if (tmp_error != NULL) {
         exit_status = 1;
         g_printerr("Error while executing command: %s\n", tmp_error->message);
         g_clear_error(&tmp_error);
         g_main_loop_quit(main_loop);
-        return FALSE;
     }
-    return TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Schedules the next render of the position for when the second it shows
+ * changes, which is when the position of the player that was rendered passes
+ * the next whole second at its rate. Nothing is scheduled while that player
+ * is not playing because its position does not change.
+ */
+static void position_tick_schedule(PlayerctlPlayer *player) {
+    if (position_tick_id != 0) {
+        g_source_remove(position_tick_id);
+        position_tick_id = 0;
+    }
+
+    if (!follow_position || player == NULL) {
+        return;
+    }
+
+    PlayerctlPlaybackStatus status = 0;
+    gint64 position = 0;
+    gdouble rate = 1.0;
+    g_object_get(player, "playback-status", &status, "position", &position, "rate", &rate, NULL);
+    if (status != PLAYERCTL_PLAYBACK_STATUS_PLAYING || rate <= 0) {
+        g_debug("%s", "the rendered player is not playing, stopping the position ticker");
+        return;
+    }
+
+    gint64 until_next_second = G_USEC_PER_SEC - position % G_USEC_PER_SEC;
+    // wake just after the boundary so the position is rendered as the next second
+    guint interval = (guint)MIN(until_next_second / rate / 1000 + 1, G_MAXUINT);
+    position_tick_id = g_timeout_add(interval, playercmd_tick_callback, NULL);
+}
+
+static void managed_player_position_anchor_callback(PlayerctlPlayer *player,
+                                                    PlayerctlPlayerPropertyFlags changed,
+                                                    GVariant *values, gpointer data) {
+    if ((changed & (PLAYERCTL_PLAYER_PROPERTY_PLAYBACK_STATUS | PLAYERCTL_PLAYER_PROPERTY_RATE)) ==
+        0) {
+        return;
+    }
+
+    // the position now advances differently, so render it and reschedule
+    schedule_render();
 }
 
 struct player_command {
@@ -751,22 +1013,52 @@ struct player_command {
                      GError **error);
     gboolean supports_format;
     const gchar *follow_signal;
+    PlayerctlPlayerPropertyFlags follow_properties;
+    // the output is owned by the command and must not be freed
+    gboolean borrows_output;
 } player_commands[] = {
-    {"open", &playercmd_open, FALSE, NULL},
-    {"play", &playercmd_play, FALSE, NULL},
-    {"pause", &playercmd_pause, FALSE, NULL},
-    {"play-pause", &playercmd_play_pause, FALSE, NULL},
-    {"stop", &playercmd_stop, FALSE, NULL},
-    {"next", &playercmd_next, FALSE, NULL},
-    {"previous", &playercmd_previous, FALSE, NULL},
-    {"position", &playercmd_position, TRUE, "seeked"},
-    {"volume", &playercmd_volume, TRUE, "volume"},
-    {"status", &playercmd_status, TRUE, "playback-status"},
-    {"loop", &playercmd_loop, TRUE, "loop-status"},
-    {"shuffle", &playercmd_shuffle, TRUE, "shuffle"},
-    {"metadata", &playercmd_metadata, TRUE, "metadata"},
+    {"open", &playercmd_open, FALSE, NULL, 0},
+    {"play", &playercmd_play, FALSE, NULL, 0},
+    {"pause", &playercmd_pause, FALSE, NULL, 0},
+    {"play-pause", &playercmd_play_pause, FALSE, NULL, 0},
+    {"stop", &playercmd_stop, FALSE, NULL, 0},
+    {"next", &playercmd_next, FALSE, NULL, 0},
+    {"previous", &playercmd_previous, FALSE, NULL, 0},
+    {"position", &playercmd_position, TRUE, "seeked", 0},
+    {"volume", &playercmd_volume, TRUE, "properties-changed", PLAYERCTL_PLAYER_PROPERTY_VOLUME},
+    {"status", &playercmd_status, TRUE, "properties-changed",
+     PLAYERCTL_PLAYER_PROPERTY_PLAYBACK_STATUS},
+    {"loop", &playercmd_loop, TRUE, "properties-changed", PLAYERCTL_PLAYER_PROPERTY_LOOP_STATUS},
+    {"shuffle", &playercmd_shuffle, TRUE, "properties-changed", PLAYERCTL_PLAYER_PROPERTY_SHUFFLE},
+    {"metadata", &playercmd_metadata, TRUE, "properties-changed",
+     PLAYERCTL_PLAYER_PROPERTY_METADATA},
 };
 
+/*
+ * Queries are written as the JSON state of the player with --json, and
+ * followed for any change to that state.
+ */
+static const struct player_command json_command = {
+    "json", &playercmd_json, TRUE, "properties-changed",
+    PLAYERCTL_PLAYER_PROPERTY_PLAYBACK_STATUS | PLAYERCTL_PLAYER_PROPERTY_LOOP_STATUS |
+        PLAYERCTL_PLAYER_PROPERTY_SHUFFLE | PLAYERCTL_PLAYER_PROPERTY_VOLUME |
+        PLAYERCTL_PLAYER_PROPERTY_METADATA | PLAYERCTL_PLAYER_PROPERTY_RATE,
+    TRUE};
+
+static gboolean player_command_run(const struct player_command *command, PlayerctlPlayer *player,
+                                   gchar **argv, gint argc, gchar **output, GError **error) {
+    PCTL_TRACE1(command_begin, command->name);
+    gboolean result = command->func(player, argv, argc, output, error);
+    PCTL_TRACE2(command_end, command->name, result);
+    return result;
+}
+
+static void player_command_output_free(const struct player_command *command, gchar *output) {
+    if (!command->borrows_output) {
+        g_free(output);
+    }
+}
+
 static const struct player_command *get_player_command(gchar **argv, gint argc, GError **error) {
     for (gsize i = 0; i < LENGTH(player_commands); ++i) {
         const struct player_command command = player_commands[i];
@@ -783,6 +1075,15 @@ static const struct player_command *get_player_command(gchar **argv, gint argc,
                 return NULL;
             }
 
+            if (json_output) {
+                if (!command.supports_format || argc > 1) {
+                    g_set_error(error, playerctl_cli_error_quark(), 1,
+                                "json output is not supported on command: %s", argv[0]);
+                    return NULL;
+                }
+                return &json_command;
+            }
+
             return &player_commands[i];
         }
     }
@@ -792,6 +1093,67 @@ static const struct player_command *get_player_command(gchar **argv, gint argc,
     return NULL;
 }
 
+/* The argument that separates the commands given to follow */
+#define FOLLOW_SEPARATOR ","
+
+/*
+ * Splits the commands given to follow at each separator, so "status , volume ,
+ * metadata artist" follows "status", "volume", and "metadata artist". The
+ * arguments of a command may be command names, as in "metadata status".
+ */
+static GPtrArray *parse_followed_commands(gchar **argv, gint argc, GError **error) {
+    GError *tmp_error = NULL;
+    GPtrArray *commands = g_ptr_array_new_with_free_func((GDestroyNotify)playercmd_args_destroy);
+
+    gint start = 0;
+    for (gint i = 0; i <= argc; ++i) {
+        if (i < argc && g_strcmp0(argv[i], FOLLOW_SEPARATOR) != 0) {
+            continue;
+        }
+
+        if (i == start) {
+            g_ptr_array_unref(commands);
+            g_set_error(error, playerctl_cli_error_quark(), 1,
+                        "expected a command on each side of \"" FOLLOW_SEPARATOR "\"");
+            return NULL;
+        }
+
+        gchar **command_argv = g_new0(gchar *, i - start + 1);
+        for (gint j = start; j < i; ++j) {
+            command_argv[j - start] = argv[j];
+        }
+
+        const struct player_command *command =
+            get_player_command(command_argv, i - start, &tmp_error);
+        if (tmp_error != NULL) {
+            g_free(command_argv);
+            g_ptr_array_unref(commands);
+            g_propagate_error(error, tmp_error);
+            return NULL;
+        }
+
+        g_ptr_array_add(commands, playercmd_args_create(command_argv, i - start, command));
+        g_free(command_argv);
+        start = i + 1;
+    }
+
+    if (commands->len > 1 && json_output) {
+        g_ptr_array_unref(commands);
+        g_set_error(error, playerctl_cli_error_quark(), 1,
+                    "json output already contains the state of every command");
+        return NULL;
+    }
+
+    if (commands->len > 1 && format_string_arg != NULL) {
+        g_ptr_array_unref(commands);
+        g_set_error(error, playerctl_cli_error_quark(), 1,
+                    "format strings are not supported when following several commands");
+        return NULL;
+    }
+
+    return commands;
+}
+
 static const GOptionEntry entries[] = {
     {"player", 'p', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &player_arg,
      "A comma separated list of names of players to control (default: the "
@@ -801,20 +1163,60 @@ static const GOptionEntry entries[] = {
      "Select all available players to be controlled", NULL},
     {"ignore-player", 'i', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &ignore_player_arg,
      "A comma separated list of names of players to ignore.", "IGNORE"},
+    {"source", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &source_arg,
+     "The bus to find players on: auto, session, system, or all (default: auto, which only "
+     "connects to the system bus when no player is selected on the session bus)",
+     "SOURCE"},
+    {"timeout", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &timeout_arg,
+     "The time in milliseconds the command may take. A player that does not respond in time is "
+     "skipped in favor of the next one. With --follow, the timeout of each call to a player "
+     "(default: no limit)",
+     "MS"},
     {"format", 'f', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &format_string_arg,
      "A format string for printing properties and metadata", NULL},
+    {"json", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &json_output,
+     "Print the state of the player with typed metadata as one line of JSON for a query", NULL},
     {"follow", 'F', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &follow,
-     "Block and append the query to output when it changes for the most recently updated player.",
+     "Block and append the query to output when it changes for the most recently updated player. "
+     "Several queries are followed at once when given one after another.",
      NULL},
+    {"debounce", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &debounce_arg,
+     "With --follow, wait this many milliseconds for more changes before printing (default: 0, "
+     "which prints once the pending changes are handled)",
+     "MS"},
     {"list-all", 'l', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &list_all_players_and_exit,
      "List the names of running players that can be controlled", NULL},
     {"no-messages", 's', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &no_status_error_messages,
      "Suppress diagnostic messages", NULL},
+    {"timings", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &print_timings,
+     "Print how long each phase of the command took to stderr", NULL},
     {"version", 'v', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &print_version_and_exit,
      "Print version information", NULL},
     {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &command_arg, NULL, "COMMAND"},
     {NULL}};
 
+static gboolean parse_source_arg(const gchar *arg, GError **error) {
+    if (arg == NULL || g_strcmp0(arg, "auto") == 0) {
+        source_is_auto = TRUE;
+        selected_source = PLAYERCTL_SOURCE_NONE;
+    } else if (g_strcmp0(arg, "all") == 0) {
+        source_is_auto = FALSE;
+        selected_source = PLAYERCTL_SOURCE_NONE;
+    } else if (g_strcmp0(arg, "session") == 0) {
+        source_is_auto = FALSE;
+        selected_source = PLAYERCTL_SOURCE_DBUS_SESSION;
+    } else if (g_strcmp0(arg, "system") == 0) {
+        source_is_auto = FALSE;
+        selected_source = PLAYERCTL_SOURCE_DBUS_SYSTEM;
+    } else {
+        g_set_error(error, playerctl_cli_error_quark(), 1,
+                    "Source must be one of auto, session, system, or all: %s", arg);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static gboolean parse_setup_options(int argc, char *argv[], GError **error) {
     static const gchar *description =
         "Available Commands:"
@@ -858,6 +1260,32 @@ static gboolean parse_setup_options(int argc, char *argv[], GError **error) {
         return FALSE;
     }
 
+    if (!parse_source_arg(source_arg, error)) {
+        g_option_context_free(context);
+        return FALSE;
+    }
+
+    if (debounce_arg < 0) {
+        g_set_error(error, playerctl_cli_error_quark(), 1,
+                    "Debounce must be a number of milliseconds: %d", debounce_arg);
+        g_option_context_free(context);
+        return FALSE;
+    }
+
+    if (json_output && format_string_arg != NULL) {
+        g_set_error(error, playerctl_cli_error_quark(), 1,
+                    "json output and format strings cannot be used together");
+        g_option_context_free(context);
+        return FALSE;
+    }
+
+    if (timeout_arg == 0 || timeout_arg < -1) {
+        g_set_error(error, playerctl_cli_error_quark(), 1,
+                    "Timeout must be a positive number of milliseconds: %d", timeout_arg);
+        g_option_context_free(context);
+        return FALSE;
+    }
+
     if (command_arg == NULL && !print_version_and_exit && !list_all_players_and_exit) {
         gchar *help = g_option_context_get_help(context, TRUE, NULL);
         printf("%s\n", help);
@@ -870,42 +1298,35 @@ static gboolean parse_setup_options(int argc, char *argv[], GError **error) {
     return TRUE;
 }
 
-static GList *parse_player_list(gchar *player_list_arg) {
-    GList *players = NULL;
+static gchar **parse_player_list(gchar *player_list_arg) {
     if (player_list_arg == NULL) {
         return NULL;
     }
 
+    GPtrArray *players = g_ptr_array_new();
     const gchar *delim = ",";
     gchar *token = strtok(player_list_arg, delim);
     while (token != NULL) {
-        players = g_list_append(players, g_strdup(g_strstrip(token)));
+        g_ptr_array_add(players, g_strdup(g_strstrip(token)));
         token = strtok(NULL, ",");
     }
+    g_ptr_array_add(players, NULL);
 
-    return players;
+    return (gchar **)g_ptr_array_free(players, FALSE);
 }
 
-static gboolean name_is_selected(const gchar *name) {
-    if (ignored_player_names != NULL) {
-        gboolean ignored =
-            (g_list_find_custom(ignored_player_names, name,
-                                (GCompareFunc)pctl_player_name_string_instance_compare) != NULL);
-        if (ignored) {
-            return FALSE;
+static gboolean name_is_listed(const gchar *name, gchar **names) {
+    for (gsize i = 0; names != NULL && names[i] != NULL; ++i) {
+        if (g_strcmp0(names[i], name) == 0) {
+            return TRUE;
         }
     }
 
-    if (player_names != NULL) {
-        gboolean selected =
-            (g_list_find_custom(player_names, name,
-                                (GCompareFunc)pctl_player_name_string_instance_compare) != NULL);
-        if (!selected) {
-            return FALSE;
-        }
-    }
+    return FALSE;
+}
 
-    return TRUE;
+static gboolean name_is_selected(const gchar *name) {
+    return playerctl_player_selector_matches(player_selector, name);
 }
 
 static int handle_version_flag() {
@@ -915,10 +1336,10 @@ static int handle_version_flag() {
 
 static int handle_list_all_flag() {
     GError *tmp_error = NULL;
-    GList *player_names_list = playerctl_list_players(&tmp_error);
+    GList *player_names_list = playerctl_list_players_for_source(selected_source, &tmp_error);
 
     player_names_list =
-        g_list_sort_with_data(player_names_list, player_name_compare_func, (gpointer)player_names);
+        g_list_sort_with_data(player_names_list, player_name_compare_func, player_selector);
 
     if (tmp_error != NULL) {
         g_printerr("%s\n", tmp_error->message);
@@ -945,289 +1366,547 @@ static int handle_list_all_flag() {
 
 static void managed_players_execute_command(GError **error) {
     GError *tmp_error = NULL;
-
-    const struct player_command *player_cmd =
-        get_player_command(playercmd_args->argv, playercmd_args->argc, &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(error, tmp_error);
-        return;
-    }
-    g_debug("executing command: %s", player_cmd->name);
-    assert(player_cmd->func != NULL);
-
-    gboolean did_command = FALSE;
+    PlayerctlPlayer *rendered_player = NULL;
     GList *players = NULL;
     g_object_get(manager, "players", &players, NULL);
-    GList *l = NULL;
-    for (l = players; l != NULL; l = l->next) {
-        PlayerctlPlayer *player = PLAYERCTL_PLAYER(l->data);
-        assert(player != NULL);
-        gchar *output = NULL;
 
-        gboolean result = player_cmd->func(player, playercmd_args->argv, playercmd_args->argc,
-                                           &output, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            g_free(output);
-            return;
-        }
+    for (guint i = 0; i < followed_commands->len; ++i) {
+        struct playercmd_args *args = g_ptr_array_index(followed_commands, i);
+        const struct player_command *player_cmd = args->command;
+        g_debug("executing command: %s", player_cmd->name);
+        assert(player_cmd->func != NULL);
+
+        gboolean did_command = FALSE;
+        GList *l = NULL;
+        for (l = players; l != NULL; l = l->next) {
+            PlayerctlPlayer *player = PLAYERCTL_PLAYER(l->data);
+            assert(player != NULL);
+            gchar *output = NULL;
+
+            gboolean result =
+                player_command_run(player_cmd, player, args->argv, args->argc, &output, &tmp_error);
+            if (tmp_error != NULL) {
+                g_propagate_error(error, tmp_error);
+                player_command_output_free(player_cmd, output);
+                return;
+            }
+
+            if (output != NULL) {
+                cli_print_output(args, output);
+                player_command_output_free(player_cmd, output);
+            }
+            did_command = did_command || result;
 
-        if (output != NULL) {
-            cli_print_output(output);
+            if (result) {
+                if (rendered_player == NULL) {
+                    rendered_player = player;
+                }
+                break;
+            }
         }
-        did_command = did_command || result;
 
-        if (result) {
-            break;
+        if (!did_command) {
+            cli_print_output(args, NULL);
         }
     }
 
-    if (!did_command) {
-        cli_print_output(NULL);
+    position_tick_schedule(rendered_player);
+}
+
+/*
+ * The time in milliseconds that remains for the invocation, or the timeout of
+ * each call in follow mode.
+ */
+static gint remaining_timeout() {
+    if (invocation_deadline == 0) {
+        return timeout_arg;
     }
+
+    gint64 remaining = (invocation_deadline - g_get_monotonic_time()) / G_TIME_SPAN_MILLISECOND;
+    return (gint)CLAMP(remaining, 1, G_MAXINT);
 }
 
-static void name_appeared_callback(PlayerctlPlayerManager *manager, PlayerctlPlayerName *name,
-                                   gpointer *data) {
-    if (!name_is_selected(name->instance)) {
+struct timing {
+    gchar *phase;
+    gint64 start;
+    gint64 end;
+};
+
+static void timing_addv(gint64 start, gint64 end, const gchar *format, va_list args) {
+    struct timing timing = {
+        .phase = g_strdup_vprintf(format, args),
+        .start = start,
+        .end = end,
+    };
+    g_array_append_val(timings, timing);
+}
+
+/* Records a phase that took place between the monotonic times start and end */
+static void timing_add(gint64 start, gint64 end, const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+static void timing_add(gint64 start, gint64 end, const gchar *format, ...) {
+    va_list args;
+
+    if (timings == NULL) {
         return;
     }
 
-    g_debug("a selected name appeared: %s (source=%d)", name->instance, name->source);
+    va_start(args, format);
+    timing_addv(start, end, format, args);
+    va_end(args);
+}
 
-    // make sure we are not managing the player already
-    GList *players = NULL;
-    g_object_get(manager, "players", &players, NULL);
-    for (GList *l = players; l != NULL; l = l->next) {
-        PlayerctlPlayer *player = PLAYERCTL_PLAYER(l->data);
-        gchar *instance = pctl_player_get_instance(player);
-        PlayerctlSource source = 0;
-        g_object_get(player, "source", &source, NULL);
-
-        if (source == name->source && g_strcmp0(instance, name->instance) == 0) {
-            g_debug("this player is already managed: %s (source=%d)", name->instance, name->source);
-            return;
-        }
+/*
+ * Records a phase that started at start and ends now. Returns the time it
+ * ended, which is when the next phase starts.
+ */
+static gint64 timing_mark(gint64 start, const gchar *format, ...) G_GNUC_PRINTF(2, 3);
+static gint64 timing_mark(gint64 start, const gchar *format, ...) {
+    va_list args;
+
+    if (timings == NULL) {
+        return start;
     }
 
-    GError *error = NULL;
-    PlayerctlPlayer *player = playerctl_player_new_from_name(name, &error);
-    if (error != NULL) {
-        exit_status = 1;
-        g_printerr("Could not connect to player: %s\n", error->message);
-        g_clear_error(&error);
-        g_main_loop_quit(main_loop);
+    gint64 now = g_get_monotonic_time();
+    va_start(args, format);
+    timing_addv(start, now, format, args);
+    va_end(args);
+    return now;
+}
+
+/*
+ * Prints the phases that were timed with the time each started after main()
+ * was entered and how long each took. Phases may overlap with --all-players.
+ */
+static void timings_print(void) {
+    if (timings == NULL) {
         return;
     }
 
-    playerctl_player_manager_manage_player(manager, player);
-    g_object_unref(player);
+    gint64 now = g_get_monotonic_time();
+    g_printerr("%10s %10s  %s\n", "start (ms)", "time (ms)", "phase");
+    for (guint i = 0; i < timings->len; ++i) {
+        struct timing *timing = &g_array_index(timings, struct timing, i);
+        g_printerr("%10.3f %10.3f  %s\n", (timing->start - timings_origin) / 1000.0,
+                   (timing->end - timing->start) / 1000.0, timing->phase);
+        g_free(timing->phase);
+    }
+    g_printerr("%10.3f %10.3f  %s\n", 0.0, (now - timings_origin) / 1000.0, "total");
+
+    g_array_free(timings, TRUE);
+    timings = NULL;
 }
 
-static void init_managed_player(PlayerctlPlayer *player, const struct player_command *player_cmd) {
-    assert(player_cmd->follow_signal != NULL);
-    g_signal_connect(G_OBJECT(player), player_cmd->follow_signal,
-                     G_CALLBACK(managed_player_properties_callback), playercmd_args);
+static PlayerctlPlayerManager *cli_manager_new(PlayerctlSource source, GError **error) {
+    return g_initable_new(PLAYERCTL_TYPE_PLAYER_MANAGER, NULL, error, "source", source, "timeout",
+                          remaining_timeout(), NULL);
+}
 
-    if (formatter != NULL) {
-        for (gsize i = 0; i < LENGTH(player_commands); ++i) {
-            const struct player_command cmd = player_commands[i];
-            if (&cmd != player_cmd && cmd.follow_signal != NULL &&
-                g_strcmp0(cmd.name, "metadata") != 0 &&
-                playerctl_formatter_contains_key(formatter, cmd.name)) {
-                g_signal_connect(G_OBJECT(player), cmd.follow_signal,
-                                 G_CALLBACK(managed_player_properties_callback), playercmd_args);
-            }
+/*
+ * Connects to the player. Each call to the player gets the --timeout and must
+ * also finish before the deadline, unless the deadline is 0.
+ */
+static PlayerctlPlayer *cli_player_new(PlayerctlPlayerName *name, gint64 deadline,
+                                       GCancellable *cancellable, GError **error) {
+    return g_initable_new(PLAYERCTL_TYPE_PLAYER, cancellable, error, "player-instance",
+                          name->instance, "source", name->source, "timeout", timeout_arg,
+                          "deadline", deadline, NULL);
+}
+
+static gboolean error_is_timeout(GError *error) {
+    return error != NULL && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+}
+
+/*
+ * The deadline for trying the player in the list. A player that is not the
+ * last selected one gets half the time that remains so the players after it
+ * can still be tried when it does not respond.
+ */
+static gint64 candidate_deadline(GList *link) {
+    if (invocation_deadline == 0) {
+        return 0;
+    }
+
+    for (GList *l = link->next; l != NULL; l = l->next) {
+        PlayerctlPlayerName *name = l->data;
+        if (name_is_selected(name->instance)) {
+            gint64 now = g_get_monotonic_time();
+            return now + MAX(invocation_deadline - now, 0) / 2;
         }
     }
+
+    return invocation_deadline;
 }
 
-static void player_appeared_callback(PlayerctlPlayerManager *manager, PlayerctlPlayer *player,
-                                     gpointer *data) {
-    GError *error = NULL;
-    const struct player_command *player_cmd =
-        get_player_command(playercmd_args->argv, playercmd_args->argc, &error);
-    if (error != NULL) {
-        exit_status = 1;
-        g_printerr("Could not get player command: %s\n", error->message);
-        g_clear_error(&error);
-        g_main_loop_quit(main_loop);
+static void name_appeared_callback(PlayerctlPlayerManager *manager, PlayerctlPlayerName *name,
+                                   gpointer *data) {
+    if (!name_is_selected(name->instance)) {
         return;
     }
 
-    init_managed_player(player, player_cmd);
+    g_debug("a selected name appeared: %s (source=%d)", name->instance, name->source);
 
-    managed_players_execute_command(&error);
-    if (error != NULL) {
-        exit_status = 1;
-        g_printerr("Could not execute command: %s\n", error->message);
-        g_clear_error(&error);
-        g_main_loop_quit(main_loop);
+    // make sure we are not managing the player already
+    if (playerctl_player_manager_lookup_player(manager, name) != NULL) {
+        g_debug("this player is already managed: %s (source=%d)", name->instance, name->source);
         return;
     }
-}
 
-static void player_vanished_callback(PlayerctlPlayerManager *manager, PlayerctlPlayer *player,
-                                     gpointer *data) {
     GError *error = NULL;
-
-    managed_players_execute_command(&error);
+    PlayerctlPlayer *player = cli_player_new(name, 0, NULL, &error);
     if (error != NULL) {
         exit_status = 1;
-        g_printerr("Could not execute command: %s\n", error->message);
+        g_printerr("Could not connect to player: %s\n", error->message);
         g_clear_error(&error);
         g_main_loop_quit(main_loop);
         return;
     }
+
+    playerctl_player_manager_manage_player(manager, player);
+    g_object_unref(player);
 }
 
-gint player_name_string_compare_func(gconstpointer a, gconstpointer b, gpointer user_data) {
-    const gchar *name_a = a;
-    const gchar *name_b = b;
-    GList *names = user_data;
+static void init_managed_player(PlayerctlPlayer *player) {
+    gboolean follow_seeked = FALSE;
+    PlayerctlPlayerPropertyFlags follow_properties = 0;
 
-    if (g_strcmp0(name_a, name_b) == 0) {
-        return 0;
+    for (guint i = 0; i < followed_commands->len; ++i) {
+        struct playercmd_args *args = g_ptr_array_index(followed_commands, i);
+        assert(args->command->follow_signal != NULL);
+        if (args->command->follow_properties == 0) {
+            follow_seeked = TRUE;
+        }
+        follow_properties |= args->command->follow_properties;
     }
 
-    int a_match_index = -1;
-    int b_match_index = -1;
-
-    int any_index = INT_MAX;
-    int i = 0;
-    GList *l = NULL;
-    for (l = names; l != NULL; l = l->next) {
-        gchar *name = l->data;
+    if (json_output) {
+        // the position anchor is in the output
+        follow_seeked = TRUE;
+    }
 
-        if (g_strcmp0(name, "%any") == 0) {
-            if (any_index == INT_MAX) {
-                any_index = i;
+    if (formatter != NULL) {
+        for (gsize i = 0; i < LENGTH(player_commands); ++i) {
+            const struct player_command *cmd = &player_commands[i];
+            if (cmd->follow_signal != NULL &&
+                g_strcmp0(cmd->name, "metadata") != 0 &&
+                playerctl_formatter_contains_key(formatter, cmd->name)) {
+                if (cmd->follow_properties == 0) {
+                    follow_seeked = TRUE;
+                }
+                follow_properties |= cmd->follow_properties;
             }
-            ++i;
-            continue;
         }
+    }
 
-        if (pctl_player_name_string_instance_compare(name, name_a) == 0) {
-            if (a_match_index == -1) {
-                a_match_index = i;
-            }
-        }
+    // one callback for all the followed properties so a change notification
+    // that touches several of them only runs the command once
+    if (follow_properties != 0) {
+        g_signal_connect(G_OBJECT(player), "properties-changed",
+                         G_CALLBACK(managed_player_properties_changed_callback),
+                         GUINT_TO_POINTER(follow_properties));
+    }
 
-        if (pctl_player_name_string_instance_compare(name, name_b) == 0) {
-            if (b_match_index == -1) {
-                b_match_index = i;
-            }
-        }
-        ++i;
+    if (follow_seeked) {
+        g_signal_connect(G_OBJECT(player), "seeked",
+                         G_CALLBACK(managed_player_properties_callback), NULL);
     }
 
-    if (a_match_index == -1 && b_match_index == -1) {
-        // neither are in the list
-        return 0;
-    } else if (a_match_index == -1) {
-        // b is in the list
-        return (b_match_index < any_index ? 1 : -1);
-    } else if (b_match_index == -1) {
-        // a is in the list
-        return (a_match_index < any_index ? -1 : 1);
-    } else if (a_match_index == b_match_index) {
-        // preserve order
-        return 0;
-    } else {
-        return (a_match_index < b_match_index ? -1 : 1);
+    if (follow_position) {
+        g_signal_connect(G_OBJECT(player), "properties-changed",
+                         G_CALLBACK(managed_player_position_anchor_callback), NULL);
     }
 }
 
+static void player_appeared_callback(PlayerctlPlayerManager *manager, PlayerctlPlayer *player,
+                                     gpointer *data) {
+    init_managed_player(player);
+    schedule_render();
+}
+
+static void player_vanished_callback(PlayerctlPlayerManager *manager, PlayerctlPlayer *player,
+                                     gpointer *data) {
+    schedule_render();
+}
+
+gint player_name_string_compare_func(gconstpointer a, gconstpointer b, gpointer user_data) {
+    return playerctl_player_selector_compare(user_data, a, b);
+}
+
 gint player_name_compare_func(gconstpointer a, gconstpointer b, gpointer user_data) {
     const PlayerctlPlayerName *name_a = a;
     const PlayerctlPlayerName *name_b = b;
     return player_name_string_compare_func(name_a->instance, name_b->instance, user_data);
 }
 
-gint player_compare_func(gconstpointer a, gconstpointer b, gpointer user_data) {
-    PlayerctlPlayer *player_a = PLAYERCTL_PLAYER(a);
-    PlayerctlPlayer *player_b = PLAYERCTL_PLAYER(b);
-    gchar *name_a = NULL;
-    gchar *name_b = NULL;
-    g_object_get(player_a, "player-name", &name_a, NULL);
-    g_object_get(player_b, "player-name", &name_b, NULL);
-    gint result = player_name_string_compare_func(name_a, name_b, user_data);
-    g_free(name_a);
-    g_free(name_b);
-    return result;
+/*
+ * Whether no player on another source could take priority over the selected
+ * player. Players of equal rank keep the session bus first.
+ */
+static gboolean name_rank_is_final(const gchar *instance) {
+    gint best_rank = (player_names == NULL ? G_MAXINT : 0);
+    return playerctl_player_selector_get_rank(player_selector, instance) <= best_rank;
 }
 
-int main(int argc, char *argv[]) {
-    g_debug("playerctl version %s", PLAYERCTL_VERSION_S);
-    GError *error = NULL;
-    guint num_commands = 0;
+/*
+ * Whether the manager has a selected player that no player on another source
+ * could take priority over.
+ */
+static gboolean manager_has_final_selection(PlayerctlPlayerManager *manager) {
     GList *available_players = NULL;
+    g_object_get(manager, "player-names", &available_players, NULL);
 
-    // seems to be required to print unicode (see #8)
-    setlocale(LC_CTYPE, "");
-
-    if (!parse_setup_options(argc, argv, &error)) {
-        g_printerr("%s\n", error->message);
-        g_clear_error(&error);
-        exit(0);
+    for (GList *l = available_players; l != NULL; l = l->next) {
+        PlayerctlPlayerName *name = l->data;
+        if (name_is_selected(name->instance) && name_rank_is_final(name->instance)) {
+            return TRUE;
+        }
     }
 
-    player_names = parse_player_list(player_arg);
-    ignored_player_names = parse_player_list(ignore_player_arg);
+    return FALSE;
+}
 
-    if (print_version_and_exit) {
-        int result = handle_version_flag();
-        exit(result);
-    }
+gint player_rank_func(PlayerctlPlayer *player, gpointer user_data) {
+    gchar *name = NULL;
+    g_object_get(player, "player-name", &name, NULL);
+    gint rank = playerctl_player_selector_get_rank(user_data, name);
+    g_free(name);
+    return rank;
+}
 
-    if (list_all_players_and_exit) {
-        int result = handle_list_all_flag();
-        exit(result);
+/*
+ * How long to wait for each player to execute the command with --all-players
+ * when no --timeout is given
+ */
+#define ALL_PLAYERS_TIMEOUT_MS 5000
+
+/*
+ * Connects to a player and executes the command on it in a worker thread so
+ * all the players can be commanded at once. The main thread joins the worker
+ * before it reads the results or frees the job.
+ */
+struct player_job {
+    PlayerctlPlayerName *name;
+    const struct player_command *command;
+    gint num_commands;
+    gint64 deadline;
+    GCancellable *cancellable;
+    GThread *thread;
+    GMutex lock;
+    GCond cond;
+    gboolean done;
+    // the worker was not done at the deadline
+    gboolean late;
+    gboolean connected;
+    gboolean result;
+    gchar *output;
+    GError *error;
+    // when the worker started, connected to the player, and finished, for --timings
+    gint64 start_time;
+    gint64 connected_time;
+    gint64 done_time;
+};
+
+static struct player_job *player_job_new(PlayerctlPlayerName *name,
+                                         const struct player_command *command, gint num_commands,
+                                         gint64 deadline, GCancellable *cancellable) {
+    struct player_job *job = g_slice_new0(struct player_job);
+    job->name = playerctl_player_name_copy(name);
+    job->command = command;
+    job->num_commands = num_commands;
+    job->deadline = deadline;
+    job->cancellable = g_object_ref(cancellable);
+    g_mutex_init(&job->lock);
+    g_cond_init(&job->cond);
+    return job;
+}
+
+static void player_job_free(struct player_job *job) {
+    playerctl_player_name_free(job->name);
+    g_object_unref(job->cancellable);
+    g_free(job->output);
+    g_clear_error(&job->error);
+    g_mutex_clear(&job->lock);
+    g_cond_clear(&job->cond);
+    g_slice_free(struct player_job, job);
+}
+
+static gpointer player_job_thread(gpointer data) {
+    struct player_job *job = data;
+    GError *tmp_error = NULL;
+    gboolean connected = FALSE;
+    gboolean result = FALSE;
+    gchar *output = NULL;
+
+    // keep the signals of this player off of the main context
+    GMainContext *context = g_main_context_new();
+    g_main_context_push_thread_default(context);
+
+    gint64 start_time = g_get_monotonic_time();
+    PlayerctlPlayer *player =
+        cli_player_new(job->name, job->deadline, job->cancellable, &tmp_error);
+    gint64 connected_time = g_get_monotonic_time();
+    if (tmp_error == NULL) {
+        connected = TRUE;
+        g_debug("executing command %s on %s", job->command->name, job->name->instance);
+        result =
+            player_command_run(job->command, player, command_arg, job->num_commands, &output,
+                               &tmp_error);
+    }
+    g_clear_object(&player);
+
+    g_main_context_pop_thread_default(context);
+    g_main_context_unref(context);
+
+    g_mutex_lock(&job->lock);
+    job->connected = connected;
+    job->result = result;
+    // the buffer of a borrowed output goes away with this thread, so keep its contents
+    job->output = (job->command->borrows_output && output != NULL) ? json_buffer_steal() : output;
+    job->error = tmp_error;
+    job->start_time = start_time;
+    job->connected_time = connected_time;
+    job->done_time = g_get_monotonic_time();
+    job->done = TRUE;
+    g_cond_signal(&job->cond);
+    g_mutex_unlock(&job->lock);
+
+    return NULL;
+}
+
+/*
+ * Executes the command on all the selected players at once and prints the
+ * output in the order of the players. Returns whether any player executed the
+ * command. The calls of each player must finish before the deadline, and the
+ * connections that are still being made then are cancelled, so every worker
+ * is joined before this returns. Since the players are commanded at once, an
+ * error on one player does not keep the others from executing the command.
+ */
+static gboolean all_players_execute_command(GList *available_players,
+                                            const struct player_command *player_cmd,
+                                            gint num_commands, gboolean *has_selected) {
+    GPtrArray *jobs = g_ptr_array_new_with_free_func((GDestroyNotify)player_job_free);
+    GCancellable *cancellable = g_cancellable_new();
+    gboolean did_command = FALSE;
+
+    gint64 deadline = invocation_deadline;
+    if (deadline == 0) {
+        deadline = g_get_monotonic_time() + ALL_PLAYERS_TIMEOUT_MS * G_TIME_SPAN_MILLISECOND;
     }
 
-    num_commands = g_strv_length(command_arg);
+    for (GList *l = available_players; l != NULL; l = l->next) {
+        PlayerctlPlayerName *name = l->data;
+        g_debug("found player: %s", name->instance);
+        if (!name_is_selected(name->instance)) {
+            continue;
+        }
+        *has_selected = TRUE;
 
-    const struct player_command *player_cmd = get_player_command(command_arg, num_commands, &error);
-    if (error != NULL) {
-        g_printerr("Could not execute command: %s\n", error->message);
-        g_clear_error(&error);
-        exit(1);
+        struct player_job *job =
+            player_job_new(name, player_cmd, num_commands, deadline, cancellable);
+        g_ptr_array_add(jobs, job);
+        job->thread = g_thread_new("playerctl-player", player_job_thread, job);
     }
 
-    if (format_string_arg != NULL) {
-        formatter = playerctl_formatter_new(format_string_arg, &error);
-        if (error != NULL) {
-            g_printerr("Could not execute command: %s\n", error->message);
-            g_clear_error(&error);
-            exit(1);
+    gboolean cancel = FALSE;
+    for (guint i = 0; i < jobs->len; ++i) {
+        struct player_job *job = g_ptr_array_index(jobs, i);
+
+        g_mutex_lock(&job->lock);
+        while (!job->done) {
+            if (!g_cond_wait_until(&job->cond, &job->lock, deadline)) {
+                break;
+            }
         }
+        // the players that are not done at the deadline are reported as failed
+        job->late = !job->done;
+        cancel = cancel || job->late;
+        g_mutex_unlock(&job->lock);
     }
 
-    playercmd_args = playercmd_args_create(command_arg, num_commands);
+    if (cancel) {
+        g_cancellable_cancel(cancellable);
+    }
+    for (guint i = 0; i < jobs->len; ++i) {
+        struct player_job *job = g_ptr_array_index(jobs, i);
+        g_thread_join(job->thread);
+    }
 
-    manager = playerctl_player_manager_new(&error);
-    if (error != NULL) {
-        g_printerr("Could not connect to players: %s\n", error->message);
-        exit_status = 1;
-        goto end;
+    for (guint i = 0; i < jobs->len; ++i) {
+        struct player_job *job = g_ptr_array_index(jobs, i);
+
+        if (job->late) {
+            g_printerr("Could not execute command: %s did not respond in time\n",
+                       job->name->instance);
+            exit_status = 1;
+            continue;
+        }
+
+        timing_add(job->start_time, job->connected_time, "connect %s", job->name->instance);
+        if (job->connected) {
+            timing_add(job->connected_time, job->done_time, "command %s %s", player_cmd->name,
+                       job->name->instance);
+        }
+
+        if (job->error != NULL) {
+            if (job->connected) {
+                g_printerr("Could not execute command: %s\n", job->error->message);
+            } else {
+                g_printerr("Could not connect to player: %s\n", job->error->message);
+            }
+            exit_status = 1;
+            continue;
+        }
+
+        if (job->result) {
+            did_command = TRUE;
+            if (job->output != NULL) {
+                printf("%s", job->output);
+                fflush(stdout);
+            }
+        }
     }
 
+    g_ptr_array_unref(jobs);
+    g_object_unref(cancellable);
+
+    return did_command;
+}
+
+/* What was done with the players selected so far, on any source */
+struct player_selection {
+    gboolean has_selected;
+    gboolean did_command;
+    gboolean skipped;
+};
+
+/*
+ * Runs the command on the players the manager selects, or starts following
+ * them. With session_first, only the players that are sure to come first among
+ * all sources are used and they are added to session_tried so they are not
+ * used again when the manager is replaced with one for all sources. Returns
+ * FALSE when an error was printed and the program should exit.
+ */
+static gboolean select_players(const struct player_command *player_cmd, guint num_commands,
+                               gboolean session_first, GHashTable **session_tried,
+                               struct player_selection *selection, gint64 *phase_start) {
+    GError *error = NULL;
+    GList *available_players = NULL;
+    gboolean success = TRUE;
+
     if (player_names != NULL && !select_all_players) {
-        playerctl_player_manager_set_sort_func(manager, player_compare_func, (gpointer)player_names,
-                                               NULL);
+        playerctl_player_manager_set_rank_func(manager, player_rank_func, player_selector, NULL);
     }
 
     g_object_get(manager, "player-names", &available_players, NULL);
     available_players = g_list_copy(available_players);
     available_players =
-        g_list_sort_with_data(available_players, player_name_compare_func, (gpointer)player_names);
+        g_list_sort_with_data(available_players, player_name_compare_func, player_selector);
 
     PlayerctlPlayerName playerctld_name = {
         .instance = "playerctld",
         .source = PLAYERCTL_SOURCE_DBUS_SESSION,
     };
-    if (name_is_selected("playerctld") &&
-        (g_list_find_custom(player_names, "playerctld", (GCompareFunc)g_strcmp0)) != NULL &&
+    if (name_is_selected("playerctld") && name_is_listed("playerctld", player_names) &&
         (g_list_find_custom(available_players, &playerctld_name,
                             (GCompareFunc)pctl_player_name_compare) == NULL)) {
         // playerctld is not ignored, was specified exactly in the list of
@@ -1237,67 +1916,242 @@ int main(int argc, char *argv[]) {
         available_players = g_list_append(
             available_players, pctl_player_name_new("playerctld", PLAYERCTL_SOURCE_DBUS_SESSION));
         available_players = g_list_sort_with_data(available_players, player_name_compare_func,
-                                                  (gpointer)player_names);
+                                                  player_selector);
     }
+    *phase_start = timing_mark(*phase_start, "list names");
 
-    gboolean has_selected = FALSE;
-    gboolean did_command = FALSE;
-    GList *l = NULL;
-    for (l = available_players; l != NULL; l = l->next) {
+    if (select_all_players && !follow) {
+        selection->did_command =
+            all_players_execute_command(available_players, player_cmd, num_commands,
+                                        &selection->has_selected);
+        *phase_start = timing_mark(*phase_start, "all players");
+        success = exit_status == 0;
+        goto out;
+    }
+
+    for (GList *l = available_players; l != NULL; l = l->next) {
         PlayerctlPlayerName *name = l->data;
         g_debug("found player: %s", name->instance);
         if (!name_is_selected(name->instance)) {
             continue;
         }
-        has_selected = TRUE;
+        if (*session_tried != NULL && name->source == PLAYERCTL_SOURCE_DBUS_SESSION &&
+            g_hash_table_contains(*session_tried, name->instance)) {
+            continue;
+        }
+        if (session_first) {
+            if (!name_rank_is_final(name->instance)) {
+                // a player on another source may come first
+                break;
+            }
+            if (*session_tried == NULL) {
+                *session_tried = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+            }
+            g_hash_table_add(*session_tried, g_strdup(name->instance));
+        }
+        selection->has_selected = TRUE;
 
-        PlayerctlPlayer *player = playerctl_player_new_from_name(name, &error);
+        PlayerctlPlayer *player = cli_player_new(name, candidate_deadline(l), NULL, &error);
+        *phase_start = timing_mark(*phase_start, "connect %s", name->instance);
+        if (error_is_timeout(error)) {
+            g_debug("skipping player that did not respond in time: %s", name->instance);
+            g_clear_error(&error);
+            selection->skipped = TRUE;
+            continue;
+        }
         if (error != NULL) {
             g_printerr("Could not connect to player: %s\n", error->message);
+            g_clear_error(&error);
             exit_status = 1;
-            goto end;
+            success = FALSE;
+            goto out;
         }
 
         if (follow) {
             playerctl_player_manager_manage_player(manager, player);
-            init_managed_player(player, player_cmd);
+            init_managed_player(player);
         } else {
             gchar *output = NULL;
             g_debug("executing command %s", player_cmd->name);
-            gboolean result = player_cmd->func(player, command_arg, num_commands, &output, &error);
+            gboolean result = player_command_run(player_cmd, player, command_arg, num_commands,
+                                                 &output, &error);
+            *phase_start =
+                timing_mark(*phase_start, "command %s %s", player_cmd->name, name->instance);
+            if (error_is_timeout(error)) {
+                g_debug("skipping player that did not respond in time: %s", name->instance);
+                g_clear_error(&error);
+                player_command_output_free(player_cmd, output);
+                g_object_unref(player);
+                selection->skipped = TRUE;
+                continue;
+            }
             if (error != NULL) {
                 g_printerr("Could not execute command: %s\n", error->message);
+                g_clear_error(&error);
                 exit_status = 1;
                 g_object_unref(player);
-                goto end;
+                success = FALSE;
+                goto out;
             }
             if (result) {
-                did_command = TRUE;
+                selection->did_command = TRUE;
                 if (output != NULL) {
                     printf("%s", output);
                     fflush(stdout);
-                    g_free(output);
+                    player_command_output_free(player_cmd, output);
+                    *phase_start = timing_mark(*phase_start, "output");
                 }
 
-                if (!select_all_players) {
-                    g_object_unref(player);
-                    goto end;
-                }
+                // the command is done with the first player that runs it
+                g_object_unref(player);
+                goto out;
             }
         }
 
         g_object_unref(player);
     }
 
+out:
+    g_list_free(available_players);
+    return success;
+}
+
+int main(int argc, char *argv[]) {
+    timings_origin = g_get_monotonic_time();
+    g_debug("playerctl version %s", PLAYERCTL_VERSION_S);
+    GError *error = NULL;
+    guint num_commands = 0;
+    // the players tried on the session bus before looking on all sources
+    GHashTable *session_tried = NULL;
+    gint64 phase_start = timings_origin;
+
+    // seems to be required to print unicode (see #8)
+    setlocale(LC_CTYPE, "");
+
+    if (!parse_setup_options(argc, argv, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        exit(0);
+    }
+
+    if (print_timings) {
+        // the timings are printed at any exit
+        timings = g_array_new(FALSE, FALSE, sizeof(struct timing));
+        atexit(timings_print);
+    }
+    phase_start = timing_mark(phase_start, "options");
+
+    if (timeout_arg > 0 && !follow) {
+        invocation_deadline = g_get_monotonic_time() + timeout_arg * G_TIME_SPAN_MILLISECOND;
+    }
+
+    player_names = parse_player_list(player_arg);
+    gchar **ignored_player_names = parse_player_list(ignore_player_arg);
+    player_selector = playerctl_player_selector_new((const gchar *const *)player_names,
+                                                    (const gchar *const *)ignored_player_names);
+    g_strfreev(ignored_player_names);
+
+    if (print_version_and_exit) {
+        int result = handle_version_flag();
+        exit(result);
+    }
+
+    if (list_all_players_and_exit) {
+        int result = handle_list_all_flag();
+        timing_mark(phase_start, "list players");
+        exit(result);
+    }
+
+    num_commands = g_strv_length(command_arg);
+
+    const struct player_command *player_cmd = NULL;
+    if (follow) {
+        followed_commands = parse_followed_commands(command_arg, num_commands, &error);
+        if (error == NULL) {
+            struct playercmd_args *first = g_ptr_array_index(followed_commands, 0);
+            player_cmd = first->command;
+        }
+    } else {
+        player_cmd = get_player_command(command_arg, num_commands, &error);
+    }
+    if (error != NULL) {
+        g_printerr("Could not execute command: %s\n", error->message);
+        g_clear_error(&error);
+        exit(1);
+    }
+
+    if (format_string_arg != NULL) {
+        formatter = playerctl_formatter_new(format_string_arg, &error);
+        if (error != NULL) {
+            g_printerr("Could not execute command: %s\n", error->message);
+            g_clear_error(&error);
+            exit(1);
+        }
+        follow_position = follow && playerctl_formatter_contains_key(formatter, "position");
+    }
+    phase_start = timing_mark(phase_start, "commands");
+
+    PlayerctlSource manager_source = selected_source;
+    if (source_is_auto && !select_all_players && !follow) {
+        // one player is controlled and it is almost always on the session bus
+        manager_source = PLAYERCTL_SOURCE_DBUS_SESSION;
+    }
+
+    manager = cli_manager_new(manager_source, &error);
+    phase_start = timing_mark(phase_start, "manager");
+    if (error != NULL) {
+        g_printerr("Could not connect to players: %s\n", error->message);
+        exit_status = 1;
+        goto end;
+    }
+
+    if (manager_source != selected_source && !manager_has_final_selection(manager)) {
+        g_debug("%s", "no player is selected on the session bus, watching all sources");
+        manager_source = selected_source;
+        g_object_unref(manager);
+        manager = cli_manager_new(selected_source, &error);
+        phase_start = timing_mark(phase_start, "manager (all sources)");
+        if (error != NULL) {
+            g_printerr("Could not connect to players: %s\n", error->message);
+            exit_status = 1;
+            goto end;
+        }
+    }
+
+    struct player_selection selection = {0};
+    if (!select_players(player_cmd, num_commands, manager_source != selected_source,
+                        &session_tried, &selection, &phase_start)) {
+        goto end;
+    }
+
+    if (!follow && !selection.did_command && manager_source != selected_source) {
+        g_debug("%s", "no player on the session bus ran the command, watching all sources");
+        manager_source = selected_source;
+        g_object_unref(manager);
+        manager = cli_manager_new(selected_source, &error);
+        phase_start = timing_mark(phase_start, "manager (all sources)");
+        if (error != NULL) {
+            g_printerr("Could not connect to players: %s\n", error->message);
+            exit_status = 1;
+            goto end;
+        }
+        if (!select_players(player_cmd, num_commands, FALSE, &session_tried, &selection,
+                            &phase_start)) {
+            goto end;
+        }
+    }
+
     if (!follow) {
-        if (!has_selected) {
+        if (!selection.has_selected) {
             if (!no_status_error_messages) {
                 g_printerr("No players found\n");
             }
             exit_status = 1;
             goto end;
-        } else if (!did_command) {
-            if (!no_status_error_messages) {
+        } else if (!selection.did_command) {
+            if (selection.skipped) {
+                g_printerr("Could not execute command: no player responded in time\n");
+            } else if (!no_status_error_messages) {
                 g_printerr("No player could handle this command\n");
             }
             exit_status = 1;
@@ -1305,11 +2159,14 @@ int main(int argc, char *argv[]) {
         }
     } else {
         managed_players_execute_command(&error);
+        timing_mark(phase_start, "command and output");
         if (error != NULL) {
             g_printerr("Connection to player failed: %s\n", error->message);
             exit_status = 1;
             goto end;
         }
+        // following does not end, so print what it took to get here
+        timings_print();
 
         g_signal_connect(PLAYERCTL_PLAYER_MANAGER(manager), "name-appeared",
                          G_CALLBACK(name_appeared_callback), NULL);
@@ -1318,27 +2175,30 @@ int main(int argc, char *argv[]) {
         g_signal_connect(PLAYERCTL_PLAYER_MANAGER(manager), "player-vanished",
                          G_CALLBACK(player_vanished_callback), NULL);
 
-        if (formatter != NULL && playerctl_formatter_contains_key(formatter, "position")) {
-            g_timeout_add(1000, playercmd_tick_callback, NULL);
-        }
-
         main_loop = g_main_loop_new(NULL, FALSE);
         g_main_loop_run(main_loop);
         g_main_loop_unref(main_loop);
     }
 
 end:
-    if (available_players != NULL) {
-        g_list_free(available_players);
+    if (position_tick_id != 0) {
+        g_source_remove(position_tick_id);
+    }
+    if (render_source_id != 0) {
+        g_source_remove(render_source_id);
+    }
+    if (followed_commands != NULL) {
+        g_ptr_array_unref(followed_commands);
+    }
+    if (session_tried != NULL) {
+        g_hash_table_unref(session_tried);
     }
-    playercmd_args_destroy(playercmd_args);
     if (manager != NULL) {
         g_object_unref(manager);
     }
     playerctl_formatter_destroy(formatter);
-    g_free(last_output);
-    g_list_free_full(player_names, g_free);
-    g_list_free_full(ignored_player_names, g_free);
+    g_strfreev(player_names);
+    playerctl_player_selector_unref(player_selector);
 
     exit(exit_status);
 }
@@ -24,8 +24,6 @@
 #include <stdlib.h>
 #include <strings.h>
 
-#define PLAYERCTLD_BUS_NAME "org.mpris.MediaPlayer2.playerctld"
-
 gboolean pctl_parse_playback_status(const gchar *status_str, PlayerctlPlaybackStatus *status) {
     if (status_str == NULL) {
         return FALSE;
@@ -152,6 +150,18 @@ gint pctl_player_name_compare(PlayerctlPlayerName *name_a, PlayerctlPlayerName *
     return g_strcmp0(name_a->instance, name_b->instance);
 }
 
+guint pctl_player_name_hash(gconstpointer name) {
+    const PlayerctlPlayerName *player_name = name;
+    return g_str_hash(player_name->instance) * 31 + player_name->source;
+}
+
+gboolean pctl_player_name_equal(gconstpointer name_a, gconstpointer name_b) {
+    const PlayerctlPlayerName *player_name_a = name_a;
+    const PlayerctlPlayerName *player_name_b = name_b;
+    return player_name_a->source == player_name_b->source &&
+           g_strcmp0(player_name_a->instance, player_name_b->instance) == 0;
+}
+
 gint pctl_player_name_instance_compare(PlayerctlPlayerName *name, PlayerctlPlayerName *instance) {
     if (name->source != instance->source) {
         return 1;
@@ -200,108 +210,3 @@ void pctl_player_name_list_destroy(GList *list) {
     }
     g_list_free_full(list, (GDestroyNotify)playerctl_player_name_free);
 }
-
-GList *pctl_list_player_names_on_bus(GBusType bus_type, GError **err) {
-    GError *tmp_error = NULL;
-    GList *players = NULL;
-    gboolean has_playerctld = FALSE;
-
-    GDBusProxy *proxy = g_dbus_proxy_new_for_bus_sync(
-        bus_type, G_DBUS_PROXY_FLAGS_NONE, NULL, "org.freedesktop.DBus", "/org/freedesktop/DBus",
-        "org.freedesktop.DBus", NULL, &tmp_error);
-
-    if (tmp_error != NULL) {
-        if (tmp_error->domain == G_IO_ERROR && tmp_error->code == G_IO_ERROR_NOT_FOUND) {
-            // XXX: This means the dbus socket address is not found which may
-            // mean that the bus is not running or the address was set
-            // incorrectly. I think we can pass through here because it is true
-            // that there are no names on the bus that is supposed to be at
-            // this socket path. But we need a better way of dealing with this case.
-            const gchar *message = "D-Bus socket address not found, unable to list player names";
-            if (bus_type == G_BUS_TYPE_SESSION) {
-                g_warning("%s", message);
-            } else {
-                g_debug("%s", message);
-            }
-
-            g_clear_error(&tmp_error);
-            return NULL;
-        }
-        g_propagate_error(err, tmp_error);
-        return NULL;
-    }
-
-    g_debug("Getting list of player names from D-Bus");
-    GVariant *reply = g_dbus_proxy_call_sync(proxy, "ListNames", NULL, G_DBUS_CALL_FLAGS_NONE, -1,
-                                             NULL, &tmp_error);
-
-    if (tmp_error != NULL) {
-        g_propagate_error(err, tmp_error);
-        g_object_unref(proxy);
-        return NULL;
-    }
-
-    GVariant *reply_child = g_variant_get_child_value(reply, 0);
-    gsize reply_count;
-    const gchar **names = g_variant_get_strv(reply_child, &reply_count);
-
-    // If playerctld is in the names, get the list of players from there
-    // because it will be in order of activity
-    for (gsize i = 0; i < reply_count; i += 1) {
-        if (g_strcmp0(names[i], PLAYERCTLD_BUS_NAME) == 0) {
-            g_debug("%s", "Playerctld is running. Getting names from there.");
-            has_playerctld = TRUE;
-
-            GDBusProxy *playerctld_proxy = g_dbus_proxy_new_for_bus_sync(
-                bus_type, G_DBUS_PROXY_FLAGS_NONE, NULL, PLAYERCTLD_BUS_NAME,
-                "/org/mpris/MediaPlayer2", "com.github.altdesktop.playerctld", NULL, &tmp_error);
-            if (tmp_error != NULL) {
-                g_warning("Could not get player names from playerctld: %s", tmp_error->message);
-                g_clear_error(&tmp_error);
-                g_object_unref(playerctld_proxy);
-                break;
-            }
-
-            GVariant *playerctld_reply =
-                g_dbus_proxy_get_cached_property(playerctld_proxy, "PlayerNames");
-            if (playerctld_reply == NULL) {
-                g_warning(
-                    "%s",
-                    "Could not get player names from playerctld: PlayerNames property not found");
-                g_clear_error(&tmp_error);
-                g_object_unref(playerctld_proxy);
-                break;
-            }
-
-            g_variant_unref(reply);
-            g_free(names);
-
-            reply = playerctld_reply;
-            names = g_variant_get_strv(reply, &reply_count);
-            g_object_unref(playerctld_proxy);
-            has_playerctld = TRUE;
-
-            break;
-        }
-    }
-
-    size_t offset = strlen(MPRIS_PREFIX);
-    for (gsize i = 0; i < reply_count; i += 1) {
-        if (g_str_has_prefix(names[i], MPRIS_PREFIX)) {
-            PlayerctlPlayerName *player_name =
-                pctl_player_name_new(names[i] + offset, pctl_bus_type_to_source(bus_type));
-            players = g_list_append(players, player_name);
-        }
-    }
-
-    if (!has_playerctld) {
-        players = g_list_sort(players, (GCompareFunc)pctl_player_name_compare);
-    }
-
-    g_object_unref(proxy);
-    g_variant_unref(reply);
-    g_variant_unref(reply_child);
-    g_free(names);
-
-    return players;
-}
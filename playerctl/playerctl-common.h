@@ -45,6 +45,10 @@ PlayerctlPlayerName *pctl_player_name_new(const gchar *name, PlayerctlSource sou
 
 gint pctl_player_name_compare(PlayerctlPlayerName *name_a, PlayerctlPlayerName *name_b);
 
+guint pctl_player_name_hash(gconstpointer name);
+
+gboolean pctl_player_name_equal(gconstpointer name_a, gconstpointer name_b);
+
 gint pctl_player_name_instance_compare(PlayerctlPlayerName *name, PlayerctlPlayerName *instance);
 
 gint pctl_player_name_string_instance_compare(const gchar *name, const gchar *instance);
@@ -55,8 +59,6 @@ GList *pctl_player_name_find_instance(GList *list, gchar *player_id, PlayerctlSo
 
 void pctl_player_name_list_destroy(GList *list);
 
-GList *pctl_list_player_names_on_bus(GBusType bus_type, GError **err);
-
 bool pctl_player_has_cached_property(PlayerctlPlayer *player, const gchar *name);
 
 #undef __PLAYERCTL_COMMON_H__
@@ -1,7 +1,17 @@
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <gio/gio.h>
+#include <glib-unix.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "playerctl-trace.h"
 
 #define MPRIS_PATH "/org/mpris/MediaPlayer2"
 #define DBUS_NAME "org.freedesktop.DBus"
@@ -14,6 +24,20 @@
 #define PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
 #define PLAYERCTLD_INTERFACE "com.github.altdesktop.playerctld"
 
+#define HISTOGRAM_BUCKETS 24
+
+/*
+ * A histogram of latencies in microseconds. Bucket i counts the latencies of
+ * less than 2^(i+1) microseconds not counted in a lower bucket, and the last
+ * bucket counts the rest.
+ */
+struct Histogram {
+    guint64 count;
+    guint64 total;
+    guint64 max;
+    guint64 buckets[HISTOGRAM_BUCKETS];
+};
+
 /**
  * A representation of an MPRIS player and its cached MPRIS properties
  */
@@ -32,8 +56,37 @@ struct Player {
         bool supported;
         GVariant *properties;
     } playlists;
+    // the properties were restored from the state file and not yet read from the player
+    bool stale;
+    // the monotonic time the track or playback status last changed
+    gint64 last_activity;
+    // the monotonic time the player was made active with a shift or unshift
+    gint64 selected_time;
+    // relative seeks and volume sets that arrived within the coalesce window of the last one sent
+    struct {
+        guint source_id;
+        // the sum of the offsets of the pending seeks
+        gint64 seek_offset;
+        GSList *seeks;
+        // the volume of the player at the start of the window, or -1 if it is not known
+        gdouble volume_base;
+        // the sum of the changes the sets of the volume in the window make to the base
+        gdouble volume_delta;
+        // the volume of the last pending set, for when the base is not known
+        gdouble volume;
+        GSList *volume_sets;
+    } coalesce;
+    // counters for the GetStats method
+    struct {
+        guint64 signals_received;
+        guint64 signals_forwarded;
+        guint64 method_calls;
+        struct Histogram call_latency;
+    } stats;
 };
 
+struct ActivePolicy;
+
 struct PlayerctldContext {
     GMainLoop *loop;
     gint bus_id;
@@ -48,6 +101,42 @@ struct PlayerctldContext {
     GQueue *pending_players;
     gint return_code;
     struct Player *pending_active;
+    // the timeout in milliseconds for calls to the players, or -1 for the default
+    gint call_timeout;
+    // the time in milliseconds relative seeks and volume sets are merged for, or 0 to send each
+    guint coalesce_window;
+    // the event stream on the Unix socket, if enabled
+    struct {
+        gchar *path;
+        int listen_fd;
+        guint listen_source_id;
+        GSList *subscribers;
+        // the frame being built, reused for every event
+        GByteArray *frame;
+    } events;
+    struct History *history;
+    // decides which player is active as the players change
+    const struct ActivePolicy *policy;
+    // the priority of each player name for the policy
+    GHashTable *priorities;
+    // counters for the GetStats method
+    struct {
+        guint64 signals_received;
+        guint64 signals_forwarded;
+        guint64 signals_emitted;
+        guint64 bytes_emitted;
+        guint64 method_calls;
+        guint64 method_call_errors;
+        guint64 method_calls_merged;
+        guint64 active_player_changes;
+        struct Histogram call_latency;
+        struct Histogram get_all_latency;
+    } stats;
+    // the file the players are saved to as they change and restored from at startup, if enabled
+    struct {
+        gchar *path;
+        guint save_source_id;
+    } state;
 };
 
 /**
@@ -65,6 +154,8 @@ static struct Player *player_new(const char *unique, const char *well_known) {
     player->tracklist.properties = NULL;
     player->playlists.supported = false;
     player->playlists.properties = NULL;
+    // a new player counts as active, so it is not ranked below players seen after it
+    player->last_activity = g_get_monotonic_time();
     return player;
 }
 
@@ -73,10 +164,31 @@ static void player_set_unique_name(struct Player *player, const char *unique) {
     player->unique = g_strdup(unique);
 }
 
+/*
+ * Answers the calls that were waiting to be merged with an error.
+ */
+static void player_coalesce_fail(struct Player *player) {
+    GSList *invocations = g_slist_concat(player->coalesce.seeks, player->coalesce.volume_sets);
+    for (GSList *l = invocations; l != NULL; l = l->next) {
+        g_dbus_method_invocation_return_dbus_error(
+            l->data, "com.github.altdesktop.playerctld.NoActivePlayer",
+            "The player went away before the call was sent");
+    }
+    g_slist_free(invocations);
+    player->coalesce.seeks = NULL;
+    player->coalesce.volume_sets = NULL;
+    player->coalesce.seek_offset = 0;
+    player->coalesce.volume_delta = 0;
+}
+
 static void player_free(struct Player *name) {
     if (name == NULL) {
         return;
     }
+    if (name->coalesce.source_id != 0) {
+        g_source_remove(name->coalesce.source_id);
+    }
+    player_coalesce_fail(name);
     if (name->player_properties != NULL) {
         g_variant_unref(name->player_properties);
     }
@@ -97,7 +209,8 @@ static void player_free(struct Player *name) {
 static gint player_compare(gconstpointer a, gconstpointer b) {
     struct Player *fn_a = (struct Player *)a;
     struct Player *fn_b = (struct Player *)b;
-    if (fn_a->unique != NULL && fn_b->unique != NULL && strcmp(fn_a->unique, fn_b->unique) != 0) {
+    // a player whose unique name is not known yet never matches a lookup by sender
+    if (fn_b->unique != NULL && g_strcmp0(fn_a->unique, fn_b->unique) != 0) {
         return 1;
     }
     if (fn_a->well_known != NULL && fn_b->well_known != NULL &&
@@ -223,9 +336,9 @@ static void player_update_position_sync(struct Player *player, struct Playerctld
     g_debug("updating position for player unique='%s', well_known='%s'", player->unique,
             player->well_known);
     GVariant *reply = g_dbus_connection_call_sync(
-        ctx->connection, player->unique, MPRIS_PATH, PROPERTIES_INTERFACE, "Get",
-        g_variant_new("(ss)", PLAYER_INTERFACE, "Position"), NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START,
-        -1, NULL, &tmp_error);
+        ctx->connection, (player->stale ? player->well_known : player->unique), MPRIS_PATH,
+        PROPERTIES_INTERFACE, "Get", g_variant_new("(ss)", PLAYER_INTERFACE, "Position"), NULL,
+        G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(error, tmp_error);
         return;
@@ -252,271 +365,1048 @@ static GVariant *context_player_names_to_gvariant(struct PlayerctldContext *ctx)
     return g_variant_builder_end(&builder);
 }
 
-static void context_emit_active_player_changed(struct PlayerctldContext *ctx, GError **error) {
-    GError *tmp_error = NULL;
-    g_return_if_fail(error == NULL || *error == NULL);
+/*
+ * With --socket, playerctld sends a stream of events to every client of a Unix
+ * socket in the runtime directory, so clients can follow the players without
+ * matching signals on the bus. Clients only read from the socket. The stream
+ * is a sequence of frames in which all integers are little-endian:
+ *
+ *   u32 length    the number of bytes in the frame after this field
+ *   u8  type      an enum EventType
+ *   u64 time      the CLOCK_MONOTONIC time of the event in microseconds
+ *   u16 name_len  followed by the well-known name of the player (empty for none)
+ *
+ * followed by the payload of the type:
+ *
+ *   EVENT_ACTIVE_PLAYER_CHANGED  none
+ *   EVENT_PROPERTIES_CHANGED     a u8 enum EventInterface followed by the changed
+ *                                properties as a serialized GVariant of type
+ *                                a{sv} in little-endian normal form
+ *   EVENT_SEEKED                 an i64 position in microseconds that the player
+ *                                was at at the time of the frame
+ *
+ * A new client is first sent the state of the active player. A client that
+ * does not keep up with the socket buffer is disconnected.
+ */
+enum EventType {
+    EVENT_ACTIVE_PLAYER_CHANGED = 1,
+    EVENT_PROPERTIES_CHANGED = 2,
+    EVENT_SEEKED = 3,
+};
 
-    struct Player *player = g_queue_peek_head(ctx->players);
+enum EventInterface {
+    EVENT_INTERFACE_ROOT = 0,
+    EVENT_INTERFACE_PLAYER = 1,
+    EVENT_INTERFACE_TRACKLIST = 2,
+    EVENT_INTERFACE_PLAYLISTS = 3,
+};
 
-    g_dbus_connection_emit_signal(
-        ctx->connection, NULL, MPRIS_PATH, PLAYERCTLD_INTERFACE, "ActivePlayerChangeBegin",
-        g_variant_new("(s)", (player != NULL ? player->well_known : "")), &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(error, tmp_error);
-        return;
-    }
+struct EventSubscriber {
+    struct PlayerctldContext *ctx;
+    int fd;
+    guint source_id;
+};
 
-    if (player != NULL) {
-        g_debug("emitting signals for new active player: '%s'", player->well_known);
-        GVariant *player_children[3] = {
-            g_variant_new_string(PLAYER_INTERFACE),
-            player->player_properties,
-            g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
-        };
-        GVariant *player_properties_tuple = g_variant_new_tuple(player_children, 3);
+static void frame_append_uint16(GByteArray *frame, guint16 value) {
+    value = GUINT16_TO_LE(value);
+    g_byte_array_append(frame, (const guint8 *)&value, sizeof(value));
+}
 
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                      "PropertiesChanged", player_properties_tuple, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
+static void frame_append_uint32(GByteArray *frame, guint32 value) {
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(frame, (const guint8 *)&value, sizeof(value));
+}
+
+static void frame_append_uint64(GByteArray *frame, guint64 value) {
+    value = GUINT64_TO_LE(value);
+    g_byte_array_append(frame, (const guint8 *)&value, sizeof(value));
+}
+
+static void events_begin_frame(struct PlayerctldContext *ctx, enum EventType type,
+                               const char *name) {
+    GByteArray *frame = ctx->events.frame;
+    guint8 type_byte = type;
+    // D-Bus names are at most 255 bytes
+    gsize name_len = (name != NULL ? strlen(name) : 0);
+
+    g_byte_array_set_size(frame, 0);
+    // the length is filled in when the frame is sent
+    frame_append_uint32(frame, 0);
+    g_byte_array_append(frame, &type_byte, 1);
+    frame_append_uint64(frame, g_get_monotonic_time());
+    frame_append_uint16(frame, name_len);
+    g_byte_array_append(frame, (const guint8 *)name, name_len);
+}
+
+static void events_remove_subscriber(struct EventSubscriber *subscriber) {
+    struct PlayerctldContext *ctx = subscriber->ctx;
+    ctx->events.subscribers = g_slist_remove(ctx->events.subscribers, subscriber);
+    g_source_remove(subscriber->source_id);
+    close(subscriber->fd);
+    free(subscriber);
+}
+
+/*
+ * Sends the frame to the subscriber, or to all subscribers if it is NULL, with
+ * one write each.
+ */
+static void events_send_frame(struct PlayerctldContext *ctx, struct EventSubscriber *only) {
+    GByteArray *frame = ctx->events.frame;
+    guint32 length = GUINT32_TO_LE(frame->len - sizeof(guint32));
+    memcpy(frame->data, &length, sizeof(length));
+
+    GSList *next = NULL;
+    for (GSList *l = ctx->events.subscribers; l != NULL; l = next) {
+        next = l->next;
+        struct EventSubscriber *subscriber = l->data;
+        if (only != NULL && subscriber != only) {
+            continue;
         }
 
-        GVariant *root_children[3] = {
-            g_variant_new_string(ROOT_INTERFACE),
-            player->root_properties,
-            g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
-        };
-        GVariant *root_properties_tuple = g_variant_new_tuple(root_children, 3);
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                      "PropertiesChanged", root_properties_tuple, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
+        ssize_t written =
+            send(subscriber->fd, frame->data, frame->len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written != (ssize_t)frame->len) {
+            // the rest of a partial frame would have to be buffered, so drop
+            // the subscriber instead
+            g_debug("dropping event subscriber: %s",
+                    written < 0 ? g_strerror(errno) : "the socket buffer is full");
+            events_remove_subscriber(subscriber);
         }
+    }
+}
 
-        // Emit nothing for unsupported optional interfaces
-        if (player->tracklist.supported) {
-            GVariant *tracklist_children[3] = {
-                g_variant_new_string(TRACKLIST_INTERFACE),
-                player->tracklist.properties,
-                g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
-            };
-            GVariant *tracklist_properties_tuple = g_variant_new_tuple(tracklist_children, 3);
+static void events_emit_properties(struct PlayerctldContext *ctx, struct EventSubscriber *only,
+                                   const char *name, enum EventInterface interface,
+                                   GVariant *properties) {
+    if (properties == NULL) {
+        return;
+    }
 
-            g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                          "PropertiesChanged", tracklist_properties_tuple,
-                                          &tmp_error);
-            if (tmp_error != NULL) {
-                g_propagate_error(error, tmp_error);
-                return;
-            }
-        }
+    events_begin_frame(ctx, EVENT_PROPERTIES_CHANGED, name);
+    guint8 interface_byte = interface;
+    g_byte_array_append(ctx->events.frame, &interface_byte, 1);
 
-        if (player->playlists.supported) {
-            GVariant *playlists_children[3] = {
-                g_variant_new_string(PLAYLISTS_INTERFACE),
-                player->playlists.properties,
-                g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
-            };
-            GVariant *playlists_properties_tuple = g_variant_new_tuple(playlists_children, 3);
+    GVariant *normal = g_variant_get_normal_form(properties);
+    if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+        GVariant *swapped = g_variant_byteswap(normal);
+        g_variant_unref(normal);
+        normal = swapped;
+    }
+    g_byte_array_append(ctx->events.frame, g_variant_get_data(normal), g_variant_get_size(normal));
+    g_variant_unref(normal);
 
-            g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                          "PropertiesChanged", playlists_properties_tuple,
-                                          &tmp_error);
-            if (tmp_error != NULL) {
-                g_propagate_error(error, tmp_error);
-                return;
-            }
-        }
+    events_send_frame(ctx, only);
+}
 
-        g_debug("sending Seeked signal with position %ld", player->position);
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PLAYER_INTERFACE, "Seeked",
-                                      g_variant_new("(x)", player->position), &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
-        }
-    } else {
-        g_debug("emitting invalidated property signals, no active player");
-        const gchar *const player_properties[] = {
-            "CanControl", "CanGoNext", "CanGoPrevious", "CanPause",    "CanPlay",
-            "CanSeek",    "Shuffle",   "Metadata",      "MaximumRate", "MinimumRate",
-            "Rate",       "Volume",    "Position",      "LoopStatus",  "PlaybackStatus"};
-        const gchar *const root_properties[] = {
-            "SupportedMimeTypes", "SupportedUriSchemes", "CanQuit",      "CanRaise",
-            "CanSetFullScreen",   "HasTrackList",        "DesktopEntry", "Identity"};
-        GVariant *player_invalidated = g_variant_new_strv(
-            player_properties, sizeof(player_properties) / sizeof(player_properties[0]));
-        GVariant *root_invalidated = g_variant_new_strv(
-            root_properties, sizeof(root_properties) / sizeof(root_properties[0]));
-        GVariant *player_children[3] = {
-            g_variant_new_string(PLAYER_INTERFACE),
-            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
-            player_invalidated,
-        };
-        GVariant *root_children[3] = {
-            g_variant_new_string(ROOT_INTERFACE),
-            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
-            root_invalidated,
-        };
-        GVariant *player_invalidated_tuple = g_variant_new_tuple(player_children, 3);
-        GVariant *root_invalidated_tuple = g_variant_new_tuple(root_children, 3);
+static void events_emit_seeked(struct PlayerctldContext *ctx, struct EventSubscriber *only,
+                               const char *name, gint64 position) {
+    events_begin_frame(ctx, EVENT_SEEKED, name);
+    frame_append_uint64(ctx->events.frame, (guint64)position);
+    events_send_frame(ctx, only);
+}
 
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                      "PropertiesChanged", player_invalidated_tuple, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
-        }
+/*
+ * Sends the active player and all of its properties and position.
+ */
+static void events_emit_active_player(struct PlayerctldContext *ctx,
+                                      struct EventSubscriber *only) {
+    if (ctx->events.subscribers == NULL) {
+        return;
+    }
 
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                      "PropertiesChanged", root_invalidated_tuple, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
-        }
+    struct Player *player = g_queue_peek_head(ctx->players);
+    const char *name = (player != NULL ? player->well_known : NULL);
 
-        // Assume old player supported all optional interfaces and invalidate those properties
-        // unconditionally
-        const gchar *const tracklist_properties[] = {"Tracks", "CanEditTracks"};
-        GVariant *tracklist_invalidated = g_variant_new_strv(
-            tracklist_properties, sizeof(tracklist_properties) / sizeof(tracklist_properties[0]));
-        GVariant *tracklist_children[3] = {
-            g_variant_new_string(ROOT_INTERFACE),
-            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
-            tracklist_invalidated,
-        };
-        GVariant *tracklist_invalidated_tuple = g_variant_new_tuple(tracklist_children, 3);
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                      "PropertiesChanged", tracklist_invalidated_tuple, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
-        }
+    events_begin_frame(ctx, EVENT_ACTIVE_PLAYER_CHANGED, name);
+    events_send_frame(ctx, only);
 
-        const gchar *const playlists_properties[] = {"PlaylistCount", "Orderings",
-                                                     "ActivePlaylist"};
-        GVariant *playlists_invalidated = g_variant_new_strv(
-            playlists_properties, sizeof(playlists_properties) / sizeof(playlists_properties[0]));
-        GVariant *playlists_children[3] = {
-            g_variant_new_string(ROOT_INTERFACE),
-            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
-            playlists_invalidated,
-        };
-        GVariant *playlists_invalidated_tuple = g_variant_new_tuple(playlists_children, 3);
-        g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                      "PropertiesChanged", playlists_invalidated_tuple, &tmp_error);
-        if (tmp_error != NULL) {
-            g_propagate_error(error, tmp_error);
-            return;
-        }
+    if (player == NULL) {
+        return;
     }
 
-    GVariantDict dict;
-    g_variant_dict_init(&dict, NULL);
-    g_variant_dict_insert_value(&dict, "PlayerNames", context_player_names_to_gvariant(ctx));
+    events_emit_properties(ctx, only, name, EVENT_INTERFACE_PLAYER, player->player_properties);
+    events_emit_properties(ctx, only, name, EVENT_INTERFACE_ROOT, player->root_properties);
+    if (player->tracklist.supported) {
+        events_emit_properties(ctx, only, name, EVENT_INTERFACE_TRACKLIST,
+                               player->tracklist.properties);
+    }
+    if (player->playlists.supported) {
+        events_emit_properties(ctx, only, name, EVENT_INTERFACE_PLAYLISTS,
+                               player->playlists.properties);
+    }
+    events_emit_seeked(ctx, only, name, player->position);
+}
 
-    GVariant *playerctld_children[3] = {
-        g_variant_new_string(PLAYERCTLD_INTERFACE),
-        g_variant_dict_end(&dict),
-        g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
-    };
-    GVariant *playerctld_properties = g_variant_new_tuple(playerctld_children, 3);
-    g_dbus_connection_emit_signal(ctx->connection, NULL, MPRIS_PATH, PROPERTIES_INTERFACE,
-                                  "PropertiesChanged", playerctld_properties, &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(error, tmp_error);
+/*
+ * Sends the changed properties or the new position from a signal of a player.
+ */
+static void events_emit_player_signal(struct PlayerctldContext *ctx, struct Player *player,
+                                      const gchar *signal_name, GVariant *parameters) {
+    if (ctx->events.subscribers == NULL) {
         return;
     }
-    g_dbus_connection_emit_signal(
-        ctx->connection, NULL, MPRIS_PATH, PLAYERCTLD_INTERFACE, "ActivePlayerChangeEnd",
-        g_variant_new("(s)", (player != NULL ? player->well_known : "")), &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(error, tmp_error);
+
+    if (g_strcmp0(signal_name, "Seeked") == 0 &&
+        g_variant_is_of_type(parameters, G_VARIANT_TYPE("(x)"))) {
+        gint64 position = 0;
+        g_variant_get(parameters, "(x)", &position);
+        events_emit_seeked(ctx, NULL, player->well_known, position);
         return;
     }
-}
 
-static struct Player *context_find_player(struct PlayerctldContext *ctx, const char *unique,
-                                          const char *well_known) {
-    const struct Player find_name = {
-        .unique = (char *)unique,
-        .well_known = (char *)well_known,
-    };
-    GList *found = g_queue_find_custom(ctx->players, &find_name, player_compare);
-    if (found != NULL) {
-        return (struct Player *)found->data;
+    if (g_strcmp0(signal_name, "PropertiesChanged") != 0 ||
+        !g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sa{sv}as)"))) {
+        return;
     }
 
-    found = g_queue_find_custom(ctx->pending_players, &find_name, player_compare);
-    if (found != NULL) {
-        return (struct Player *)found->data;
+    const gchar *interface_name = NULL;
+    GVariant *properties = NULL;
+    g_variant_get(parameters, "(&s@a{sv}@as)", &interface_name, &properties, NULL);
+
+    enum EventInterface interface;
+    if (g_strcmp0(interface_name, PLAYER_INTERFACE) == 0) {
+        interface = EVENT_INTERFACE_PLAYER;
+    } else if (g_strcmp0(interface_name, ROOT_INTERFACE) == 0) {
+        interface = EVENT_INTERFACE_ROOT;
+    } else if (g_strcmp0(interface_name, TRACKLIST_INTERFACE) == 0) {
+        interface = EVENT_INTERFACE_TRACKLIST;
+    } else if (g_strcmp0(interface_name, PLAYLISTS_INTERFACE) == 0) {
+        interface = EVENT_INTERFACE_PLAYLISTS;
+    } else {
+        g_variant_unref(properties);
+        return;
     }
 
-    return NULL;
+    events_emit_properties(ctx, NULL, player->well_known, interface, properties);
+    g_variant_unref(properties);
 }
 
-static struct Player *context_get_active_player(struct PlayerctldContext *ctx) {
-    return g_queue_peek_head(ctx->players);
-}
+static gboolean events_subscriber_callback(gint fd, GIOCondition condition, gpointer user_data) {
+    struct EventSubscriber *subscriber = user_data;
+    char buffer[64];
 
-static void context_set_active_player(struct PlayerctldContext *ctx, struct Player *player) {
-    g_queue_remove(ctx->players, player);
-    g_queue_remove(ctx->pending_players, player);
-    g_queue_push_head(ctx->players, player);
-    ctx->pending_active = NULL;
-}
+    // subscribers only read, so anything they send is discarded until they hang up
+    ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))) {
+        return G_SOURCE_CONTINUE;
+    }
 
-static void context_add_player(struct PlayerctldContext *ctx, struct Player *player) {
-    g_queue_remove(ctx->players, player);
-    g_queue_remove(ctx->pending_players, player);
-    g_queue_push_tail(ctx->players, player);
+    g_debug("%s", "event subscriber disconnected");
+    events_remove_subscriber(subscriber);
+    return G_SOURCE_REMOVE;
 }
 
-static void context_add_pending_player(struct PlayerctldContext *ctx, struct Player *player) {
-    g_queue_remove(ctx->players, player);
-    g_queue_remove(ctx->pending_players, player);
-    g_queue_push_tail(ctx->pending_players, player);
-}
+static gboolean events_accept_callback(gint fd, GIOCondition condition, gpointer user_data) {
+    struct PlayerctldContext *ctx = user_data;
 
-static void context_remove_player(struct PlayerctldContext *ctx, struct Player *player) {
-    g_queue_remove(ctx->players, player);
-    g_queue_remove(ctx->pending_players, player);
-    if (ctx->pending_active == player) {
-        ctx->pending_active = NULL;
+    int subscriber_fd = accept(fd, NULL, NULL);
+    if (subscriber_fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            g_warning("could not accept event subscriber: %s", g_strerror(errno));
+        }
+        return G_SOURCE_CONTINUE;
     }
+
+    g_debug("%s", "event subscriber connected");
+    struct EventSubscriber *subscriber = calloc(1, sizeof(struct EventSubscriber));
+    subscriber->ctx = ctx;
+    subscriber->fd = subscriber_fd;
+    subscriber->source_id = g_unix_fd_add(subscriber_fd, G_IO_IN | G_IO_HUP | G_IO_ERR,
+                                          events_subscriber_callback, subscriber);
+    ctx->events.subscribers = g_slist_prepend(ctx->events.subscribers, subscriber);
+
+    events_emit_active_player(ctx, subscriber);
+
+    return G_SOURCE_CONTINUE;
 }
 
-static void context_rotate_queue(struct PlayerctldContext *ctx) {
-    struct Player *player;
-    if ((player = g_queue_peek_head(ctx->players))) {
-        context_remove_player(ctx, player);
-        g_queue_push_tail(ctx->players, player);
+static gboolean events_listen(struct PlayerctldContext *ctx, GError **error) {
+    struct sockaddr_un address = {0};
+    address.sun_family = AF_UNIX;
+
+    gchar *path = g_build_filename(g_get_user_runtime_dir(), "playerctld.sock", NULL);
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FILENAME_TOO_LONG,
+                    "socket path is too long: %s", path);
+        g_free(path);
+        return FALSE;
+    }
+    g_strlcpy(address.sun_path, path, sizeof(address.sun_path));
+
+    // a socket left behind by a daemon that exited is replaced, but not one
+    // that another daemon is listening on
+    int probe_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe_fd >= 0) {
+        int connected = connect(probe_fd, (struct sockaddr *)&address, sizeof(address));
+        close(probe_fd);
+        if (connected == 0) {
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_ADDRESS_IN_USE,
+                        "another playerctld is listening on %s", path);
+            g_free(path);
+            return FALSE;
+        }
     }
+    unlink(path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved_errno),
+                    "could not listen on %s: %s", path, g_strerror(saved_errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        g_free(path);
+        return FALSE;
+    }
+
+    g_debug("listening for event subscribers on %s", path);
+    ctx->events.path = path;
+    ctx->events.listen_fd = fd;
+    ctx->events.frame = g_byte_array_new();
+    ctx->events.listen_source_id = g_unix_fd_add(fd, G_IO_IN, events_accept_callback, ctx);
+    return TRUE;
 }
 
-static void context_unrotate_queue(struct PlayerctldContext *ctx) {
-    struct Player *player;
-    if ((player = g_queue_peek_tail(ctx->players))) {
-        context_remove_player(ctx, player);
-        g_queue_push_head(ctx->players, player);
+static gboolean quit_signal_callback(gpointer user_data) {
+    struct PlayerctldContext *ctx = user_data;
+    g_main_loop_quit(ctx->loop);
+    return G_SOURCE_REMOVE;
+}
+
+static void events_close(struct PlayerctldContext *ctx) {
+    if (ctx->events.path == NULL) {
+        return;
+    }
+
+    while (ctx->events.subscribers != NULL) {
+        events_remove_subscriber(ctx->events.subscribers->data);
     }
+    g_source_remove(ctx->events.listen_source_id);
+    close(ctx->events.listen_fd);
+    unlink(ctx->events.path);
+    g_byte_array_unref(ctx->events.frame);
+    g_clear_pointer(&ctx->events.path, g_free);
 }
 
-/**
- * Returns the newly activated player
+/*
+ * The history of player activity is kept in a ring of fixed-size records, so
+ * recording an event never allocates and the memory used does not grow with
+ * uptime. Once the ring is full, the oldest events are overwritten. Text that
+ * does not fit in a record is cut short.
  */
-static struct Player *context_shift_active_player(struct PlayerctldContext *ctx) {
-    GError *error = NULL;
-    struct Player *previous, *current;
+#define HISTORY_CAPACITY 1024
+#define HISTORY_PLAYER_MAX 96
+#define HISTORY_DETAIL_MAX 160
+
+enum HistoryKind {
+    // the detail is empty
+    HISTORY_ACTIVE_PLAYER = 0,
+    // the detail is "artist - title", or the title or track id when there is no artist
+    HISTORY_TRACK = 1,
+    // the detail is the playback status
+    HISTORY_STATUS = 2,
+};
 
-    if (!(previous = current = context_get_active_player(ctx))) {
-        return NULL;
-    }
-    context_remove_player(ctx, previous);
-    context_add_player(ctx, previous);
+static const char *const history_kind_names[] = {"active", "track", "status"};
+
+struct HistoryEvent {
+    // the CLOCK_MONOTONIC time of the event in microseconds
+    gint64 time;
+    guint8 kind;
+    char player[HISTORY_PLAYER_MAX];
+    char detail[HISTORY_DETAIL_MAX];
+};
+
+struct History {
+    struct HistoryEvent events[HISTORY_CAPACITY];
+    // the index of the next event to write
+    guint head;
+    guint len;
+    // each event is also appended here if it is not -1
+    int spill_fd;
+};
+
+static struct History *history_new(int spill_fd) {
+    struct History *history = calloc(1, sizeof(struct History));
+    history->spill_fd = spill_fd;
+    return history;
+}
+
+static void history_free(struct History *history) {
+    if (history == NULL) {
+        return;
+    }
+    if (history->spill_fd >= 0) {
+        close(history->spill_fd);
+    }
+    free(history);
+}
+
+/* Copies as much of the text as fits without splitting a UTF-8 character */
+static void history_copy_text(char *dest, gsize size, const char *text) {
+    gsize len = (text != NULL ? strlen(text) : 0);
+    if (len >= size) {
+        len = size - 1;
+        while (len > 0 && ((guchar)text[len] & 0xC0) == 0x80) {
+            len--;
+        }
+    }
+    if (len > 0) {
+        memcpy(dest, text, len);
+    }
+    dest[len] = '\0';
+}
+
+/*
+ * Appends the event to the spill file as one record in which all integers are
+ * little-endian:
+ *
+ *   u16 length      the number of bytes in the record after this field
+ *   i64 monotonic   the CLOCK_MONOTONIC time of the event in microseconds
+ *   i64 realtime    the wall clock time of the event in microseconds
+ *   u8  kind        an enum HistoryKind
+ *   u8  player_len  followed by the name of the player
+ *   u8  detail_len  followed by the detail
+ */
+static void history_spill(struct History *history, const struct HistoryEvent *event) {
+    guint8 record[2 + 8 + 8 + 1 + 1 + HISTORY_PLAYER_MAX + 1 + HISTORY_DETAIL_MAX];
+    gsize offset = sizeof(guint16);
+
+    gint64 monotonic = GINT64_TO_LE(event->time);
+    memcpy(record + offset, &monotonic, sizeof(monotonic));
+    offset += sizeof(monotonic);
+    gint64 realtime = GINT64_TO_LE(g_get_real_time());
+    memcpy(record + offset, &realtime, sizeof(realtime));
+    offset += sizeof(realtime);
+    record[offset++] = event->kind;
+
+    const char *texts[] = {event->player, event->detail};
+    for (gsize i = 0; i < G_N_ELEMENTS(texts); ++i) {
+        gsize len = strlen(texts[i]);
+        record[offset++] = len;
+        memcpy(record + offset, texts[i], len);
+        offset += len;
+    }
+
+    guint16 length = GUINT16_TO_LE(offset - sizeof(guint16));
+    memcpy(record, &length, sizeof(length));
+
+    if (write(history->spill_fd, record, offset) != (ssize_t)offset) {
+        g_warning("could not write to the history file, no longer writing to it: %s",
+                  g_strerror(errno));
+        close(history->spill_fd);
+        history->spill_fd = -1;
+    }
+}
+
+static void history_record(struct PlayerctldContext *ctx, enum HistoryKind kind,
+                           const char *player, const char *detail) {
+    struct History *history = ctx->history;
+    if (history == NULL) {
+        return;
+    }
+
+    struct HistoryEvent *event = &history->events[history->head];
+    event->time = g_get_monotonic_time();
+    event->kind = kind;
+    history_copy_text(event->player, sizeof(event->player), player);
+    history_copy_text(event->detail, sizeof(event->detail), detail);
+    g_debug("history: %s %s '%s'", history_kind_names[kind], event->player, event->detail);
+
+    history->head = (history->head + 1) % HISTORY_CAPACITY;
+    if (history->len < HISTORY_CAPACITY) {
+        history->len++;
+    }
+
+    if (history->spill_fd >= 0) {
+        history_spill(history, event);
+    }
+}
+
+/*
+ * Gets a string from the metadata, or the first string of a string array since
+ * some players send the artist as a string.
+ */
+static GVariant *metadata_lookup_string(GVariant *metadata, const gchar *key) {
+    GVariant *value = g_variant_lookup_value(metadata, key, NULL);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING) ||
+        g_variant_is_of_type(value, G_VARIANT_TYPE_OBJECT_PATH)) {
+        return value;
+    }
+
+    GVariant *first = NULL;
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING_ARRAY) &&
+        g_variant_n_children(value) > 0) {
+        first = g_variant_get_child_value(value, 0);
+    }
+    g_variant_unref(value);
+    return first;
+}
+
+/*
+ * Formats the track of the metadata as the detail of a track event. Returns
+ * FALSE if the metadata has no track.
+ */
+static gboolean history_format_track(GVariant *metadata, char *detail, gsize size) {
+    GVariant *artist = metadata_lookup_string(metadata, "xesam:artist");
+    GVariant *title = metadata_lookup_string(metadata, "xesam:title");
+    GVariant *track_id = metadata_lookup_string(metadata, "mpris:trackid");
+    gboolean found = TRUE;
+
+    if (artist != NULL && title != NULL) {
+        g_snprintf(detail, size, "%s - %s", g_variant_get_string(artist, NULL),
+                   g_variant_get_string(title, NULL));
+    } else if (title != NULL) {
+        g_snprintf(detail, size, "%s", g_variant_get_string(title, NULL));
+    } else if (track_id != NULL) {
+        g_snprintf(detail, size, "%s", g_variant_get_string(track_id, NULL));
+    } else {
+        detail[0] = '\0';
+        found = FALSE;
+    }
+
+    if (artist != NULL) {
+        g_variant_unref(artist);
+    }
+    if (title != NULL) {
+        g_variant_unref(title);
+    }
+    if (track_id != NULL) {
+        g_variant_unref(track_id);
+    }
+    return found;
+}
+
+/*
+ * Records the changes of track and playback status in the properties of the
+ * player. Returns TRUE if either changed.
+ */
+static gboolean history_record_player_changes(struct PlayerctldContext *ctx,
+                                              struct Player *player, GVariant *properties) {
+    GVariant *cached = player->player_properties;
+    gboolean changed = FALSE;
+
+    const gchar *status = NULL;
+    if (g_variant_lookup(properties, "PlaybackStatus", "&s", &status)) {
+        const gchar *cached_status = NULL;
+        if (cached == NULL || !g_variant_lookup(cached, "PlaybackStatus", "&s", &cached_status) ||
+            g_strcmp0(status, cached_status) != 0) {
+            history_record(ctx, HISTORY_STATUS, player->well_known, status);
+            changed = TRUE;
+        }
+    }
+
+    GVariant *metadata = g_variant_lookup_value(properties, "Metadata", G_VARIANT_TYPE_VARDICT);
+    if (metadata == NULL) {
+        return changed;
+    }
+
+    // twice the size of a record, so the record cuts the text at a whole character
+    char track[HISTORY_DETAIL_MAX * 2];
+    char cached_track[HISTORY_DETAIL_MAX * 2] = {0};
+    if (history_format_track(metadata, track, sizeof(track))) {
+        GVariant *cached_metadata =
+            (cached != NULL ? g_variant_lookup_value(cached, "Metadata", G_VARIANT_TYPE_VARDICT)
+                            : NULL);
+        if (cached_metadata != NULL) {
+            history_format_track(cached_metadata, cached_track, sizeof(cached_track));
+            g_variant_unref(cached_metadata);
+        }
+        if (strcmp(track, cached_track) != 0) {
+            history_record(ctx, HISTORY_TRACK, player->well_known, track);
+            changed = TRUE;
+        }
+    }
+    g_variant_unref(metadata);
+    return changed;
+}
+
+static GVariant *history_to_gvariant(struct History *history, gint64 since) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(xsss)"));
+
+    guint oldest = (history->head + HISTORY_CAPACITY - history->len) % HISTORY_CAPACITY;
+    for (guint i = 0; i < history->len; ++i) {
+        const struct HistoryEvent *event = &history->events[(oldest + i) % HISTORY_CAPACITY];
+        if (event->time <= since) {
+            continue;
+        }
+        g_variant_builder_add(&builder, "(xsss)", event->time, history_kind_names[event->kind],
+                              event->player, event->detail);
+    }
+
+    return g_variant_builder_end(&builder);
+}
+
+/*
+ * The state file is a serialized GVariant in little-endian normal form, so it
+ * can be mapped and read in place at startup. It holds the version of the
+ * format, the address of the bus the players are on, and the players in order
+ * of activity with their well-known names, the wall clock time of their last
+ * activity in microseconds, and their player and root properties.
+ */
+#define STATE_VERSION 2
+#define STATE_TYPE "(usa(sxa{sv}a{sv}))"
+// the time to wait for more changes before saving the state
+#define STATE_SAVE_DELAY_SECONDS 2
+
+static GVariant *context_state_to_gvariant(struct PlayerctldContext *ctx) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(sxa{sv}a{sv})"));
+    // the monotonic clock does not carry over a reboot, so the activity is saved as wall time
+    gint64 monotonic_now = g_get_monotonic_time();
+    gint64 real_now = g_get_real_time();
+
+    for (GList *l = ctx->players->head; l != NULL; l = l->next) {
+        struct Player *player = l->data;
+        GVariant *empty = g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0);
+        g_variant_ref_sink(empty);
+        gint64 last_activity =
+            (player->last_activity != 0 ? real_now - (monotonic_now - player->last_activity)
+                                        : 0);
+        g_variant_builder_add(&builder, "(sx@a{sv}@a{sv})", player->well_known, last_activity,
+                              (player->player_properties != NULL ? player->player_properties
+                                                                 : empty),
+                              (player->root_properties != NULL ? player->root_properties : empty));
+        g_variant_unref(empty);
+    }
+
+    return g_variant_new("(us@a(sxa{sv}a{sv}))", STATE_VERSION, ctx->bus_address,
+                         g_variant_builder_end(&builder));
+}
+
+static void context_save_state(struct PlayerctldContext *ctx) {
+    GError *error = NULL;
+
+    GVariant *built = g_variant_ref_sink(context_state_to_gvariant(ctx));
+    GVariant *state = g_variant_get_normal_form(built);
+    g_variant_unref(built);
+    if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+        GVariant *swapped = g_variant_byteswap(state);
+        g_variant_unref(state);
+        state = swapped;
+    }
+
+    // the file is replaced rather than written in place, which keeps a mapping of it valid
+    g_file_set_contents(ctx->state.path, g_variant_get_data(state), g_variant_get_size(state),
+                        &error);
+    if (error != NULL) {
+        g_warning("could not save state to %s: %s", ctx->state.path, error->message);
+        g_clear_error(&error);
+    } else {
+        g_debug("saved state to %s", ctx->state.path);
+    }
+    g_variant_unref(state);
+}
+
+static gboolean context_save_state_callback(gpointer user_data) {
+    struct PlayerctldContext *ctx = user_data;
+    ctx->state.save_source_id = 0;
+    context_save_state(ctx);
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Saves the state once the players have not changed for a while.
+ */
+static void context_schedule_save(struct PlayerctldContext *ctx) {
+    if (ctx->state.path == NULL || ctx->state.save_source_id != 0) {
+        return;
+    }
+
+    ctx->state.save_source_id =
+        g_timeout_add_seconds(STATE_SAVE_DELAY_SECONDS, context_save_state_callback, ctx);
+}
+
+static void histogram_add(struct Histogram *histogram, gint64 latency) {
+    guint64 value = MAX(latency, 0);
+    guint bucket = 0;
+    while (bucket < HISTOGRAM_BUCKETS - 1 && value >= (G_GUINT64_CONSTANT(2) << bucket)) {
+        ++bucket;
+    }
+
+    histogram->count++;
+    histogram->total += value;
+    histogram->max = MAX(histogram->max, value);
+    histogram->buckets[bucket]++;
+}
+
+static GVariant *histogram_to_gvariant(const struct Histogram *histogram) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "Count", g_variant_new_uint64(histogram->count));
+    g_variant_builder_add(&builder, "{sv}", "Total", g_variant_new_uint64(histogram->total));
+    g_variant_builder_add(&builder, "{sv}", "Max", g_variant_new_uint64(histogram->max));
+    g_variant_builder_add(&builder, "{sv}", "Buckets",
+                          g_variant_new_fixed_array(G_VARIANT_TYPE_UINT64, histogram->buckets,
+                                                    HISTOGRAM_BUCKETS, sizeof(guint64)));
+    return g_variant_builder_end(&builder);
+}
+
+static gsize player_cache_size(struct Player *player) {
+    GVariant *cached[] = {player->player_properties, player->root_properties,
+                          player->tracklist.properties, player->playlists.properties};
+    gsize size = 0;
+    for (gsize i = 0; i < G_N_ELEMENTS(cached); ++i) {
+        if (cached[i] != NULL) {
+            size += g_variant_get_size(cached[i]);
+        }
+    }
+    return size;
+}
+
+static GVariant *player_stats_to_gvariant(struct Player *player) {
+    GVariantBuilder builder;
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "SignalsReceived",
+                          g_variant_new_uint64(player->stats.signals_received));
+    g_variant_builder_add(&builder, "{sv}", "SignalsForwarded",
+                          g_variant_new_uint64(player->stats.signals_forwarded));
+    g_variant_builder_add(&builder, "{sv}", "MethodCalls",
+                          g_variant_new_uint64(player->stats.method_calls));
+    g_variant_builder_add(&builder, "{sv}", "CallLatency",
+                          histogram_to_gvariant(&player->stats.call_latency));
+    g_variant_builder_add(&builder, "{sv}", "CacheBytes",
+                          g_variant_new_uint64(player_cache_size(player)));
+    return g_variant_builder_end(&builder);
+}
+
+/*
+ * The counters of the daemon, with the counters of each player keyed by its
+ * well-known name under "Players". Latencies are in microseconds.
+ */
+static GVariant *context_stats_to_gvariant(struct PlayerctldContext *ctx) {
+    GVariantBuilder builder;
+    GVariantBuilder players;
+    gsize cache_size = 0;
+
+    g_variant_builder_init(&players, G_VARIANT_TYPE("a{sv}"));
+    for (GList *l = ctx->players->head; l != NULL; l = l->next) {
+        struct Player *player = l->data;
+        cache_size += player_cache_size(player);
+        g_variant_builder_add(&players, "{sv}", player->well_known,
+                              player_stats_to_gvariant(player));
+    }
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE_VARDICT);
+    g_variant_builder_add(&builder, "{sv}", "SignalsReceived",
+                          g_variant_new_uint64(ctx->stats.signals_received));
+    g_variant_builder_add(&builder, "{sv}", "SignalsForwarded",
+                          g_variant_new_uint64(ctx->stats.signals_forwarded));
+    g_variant_builder_add(&builder, "{sv}", "SignalsEmitted",
+                          g_variant_new_uint64(ctx->stats.signals_emitted));
+    g_variant_builder_add(&builder, "{sv}", "BytesEmitted",
+                          g_variant_new_uint64(ctx->stats.bytes_emitted));
+    g_variant_builder_add(&builder, "{sv}", "MethodCalls",
+                          g_variant_new_uint64(ctx->stats.method_calls));
+    g_variant_builder_add(&builder, "{sv}", "MethodCallErrors",
+                          g_variant_new_uint64(ctx->stats.method_call_errors));
+    g_variant_builder_add(&builder, "{sv}", "MethodCallsMerged",
+                          g_variant_new_uint64(ctx->stats.method_calls_merged));
+    g_variant_builder_add(&builder, "{sv}", "ActivePlayerChanges",
+                          g_variant_new_uint64(ctx->stats.active_player_changes));
+    g_variant_builder_add(&builder, "{sv}", "CallLatency",
+                          histogram_to_gvariant(&ctx->stats.call_latency));
+    g_variant_builder_add(&builder, "{sv}", "GetAllLatency",
+                          histogram_to_gvariant(&ctx->stats.get_all_latency));
+    g_variant_builder_add(&builder, "{sv}", "PendingPlayers",
+                          g_variant_new_uint32(g_queue_get_length(ctx->pending_players)));
+    g_variant_builder_add(&builder, "{sv}", "CacheBytes", g_variant_new_uint64(cache_size));
+    g_variant_builder_add(&builder, "{sv}", "HistoryEvents",
+                          g_variant_new_uint32(ctx->history->len));
+    g_variant_builder_add(&builder, "{sv}", "EventSubscribers",
+                          g_variant_new_uint32(g_slist_length(ctx->events.subscribers)));
+    g_variant_builder_add(&builder, "{sv}", "Players", g_variant_builder_end(&players));
+    return g_variant_builder_end(&builder);
+}
+
+/*
+ * Emits the signal on the bus and counts it for the stats.
+ */
+static void context_emit_signal(struct PlayerctldContext *ctx, const gchar *object_path,
+                                const gchar *interface_name, const gchar *signal_name,
+                                GVariant *parameters, GError **error) {
+    if (parameters != NULL) {
+        ctx->stats.bytes_emitted += g_variant_get_size(parameters);
+    }
+    ctx->stats.signals_emitted++;
+    g_dbus_connection_emit_signal(ctx->connection, NULL, object_path, interface_name, signal_name,
+                                  parameters, error);
+}
+
+static void context_emit_active_player_changed(struct PlayerctldContext *ctx, GError **error) {
+    GError *tmp_error = NULL;
+    g_return_if_fail(error == NULL || *error == NULL);
+
+    ctx->stats.active_player_changes++;
+
+    struct Player *player = g_queue_peek_head(ctx->players);
+    const gchar *name = (player != NULL ? player->well_known : "");
+    PCTL_TRACE1(active_player_change_begin, name);
+
+    events_emit_active_player(ctx, NULL);
+    history_record(ctx, HISTORY_ACTIVE_PLAYER, (player != NULL ? player->well_known : NULL), NULL);
+
+    context_emit_signal(ctx, MPRIS_PATH, PLAYERCTLD_INTERFACE, "ActivePlayerChangeBegin",
+                        g_variant_new("(s)", name), &tmp_error);
+    if (tmp_error != NULL) {
+        goto out;
+    }
+
+    if (player != NULL) {
+        g_debug("emitting signals for new active player: '%s'", player->well_known);
+        GVariant *player_children[3] = {
+            g_variant_new_string(PLAYER_INTERFACE),
+            player->player_properties,
+            g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
+        };
+        GVariant *player_properties_tuple = g_variant_new_tuple(player_children, 3);
+
+        context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                            player_properties_tuple, &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+
+        GVariant *root_children[3] = {
+            g_variant_new_string(ROOT_INTERFACE),
+            player->root_properties,
+            g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
+        };
+        GVariant *root_properties_tuple = g_variant_new_tuple(root_children, 3);
+        context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                            root_properties_tuple, &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+
+        // Emit nothing for unsupported optional interfaces
+        if (player->tracklist.supported) {
+            GVariant *tracklist_children[3] = {
+                g_variant_new_string(TRACKLIST_INTERFACE),
+                player->tracklist.properties,
+                g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
+            };
+            GVariant *tracklist_properties_tuple = g_variant_new_tuple(tracklist_children, 3);
+
+            context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                                tracklist_properties_tuple, &tmp_error);
+            if (tmp_error != NULL) {
+                goto out;
+            }
+        }
+
+        if (player->playlists.supported) {
+            GVariant *playlists_children[3] = {
+                g_variant_new_string(PLAYLISTS_INTERFACE),
+                player->playlists.properties,
+                g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
+            };
+            GVariant *playlists_properties_tuple = g_variant_new_tuple(playlists_children, 3);
+
+            context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                                playlists_properties_tuple, &tmp_error);
+            if (tmp_error != NULL) {
+                goto out;
+            }
+        }
+
+        g_debug("sending Seeked signal with position %ld", player->position);
+        context_emit_signal(ctx, MPRIS_PATH, PLAYER_INTERFACE, "Seeked",
+                            g_variant_new("(x)", player->position), &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+    } else {
+        g_debug("emitting invalidated property signals, no active player");
+        const gchar *const player_properties[] = {
+            "CanControl", "CanGoNext", "CanGoPrevious", "CanPause",    "CanPlay",
+            "CanSeek",    "Shuffle",   "Metadata",      "MaximumRate", "MinimumRate",
+            "Rate",       "Volume",    "Position",      "LoopStatus",  "PlaybackStatus"};
+        const gchar *const root_properties[] = {
+            "SupportedMimeTypes", "SupportedUriSchemes", "CanQuit",      "CanRaise",
+            "CanSetFullScreen",   "HasTrackList",        "DesktopEntry", "Identity"};
+        GVariant *player_invalidated = g_variant_new_strv(
+            player_properties, sizeof(player_properties) / sizeof(player_properties[0]));
+        GVariant *root_invalidated = g_variant_new_strv(
+            root_properties, sizeof(root_properties) / sizeof(root_properties[0]));
+        GVariant *player_children[3] = {
+            g_variant_new_string(PLAYER_INTERFACE),
+            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
+            player_invalidated,
+        };
+        GVariant *root_children[3] = {
+            g_variant_new_string(ROOT_INTERFACE),
+            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
+            root_invalidated,
+        };
+        GVariant *player_invalidated_tuple = g_variant_new_tuple(player_children, 3);
+        GVariant *root_invalidated_tuple = g_variant_new_tuple(root_children, 3);
+
+        context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                            player_invalidated_tuple, &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+
+        context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                            root_invalidated_tuple, &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+
+        // Assume old player supported all optional interfaces and invalidate those properties
+        // unconditionally
+        const gchar *const tracklist_properties[] = {"Tracks", "CanEditTracks"};
+        GVariant *tracklist_invalidated = g_variant_new_strv(
+            tracklist_properties, sizeof(tracklist_properties) / sizeof(tracklist_properties[0]));
+        GVariant *tracklist_children[3] = {
+            g_variant_new_string(ROOT_INTERFACE),
+            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
+            tracklist_invalidated,
+        };
+        GVariant *tracklist_invalidated_tuple = g_variant_new_tuple(tracklist_children, 3);
+        context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                            tracklist_invalidated_tuple, &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+
+        const gchar *const playlists_properties[] = {"PlaylistCount", "Orderings",
+                                                     "ActivePlaylist"};
+        GVariant *playlists_invalidated = g_variant_new_strv(
+            playlists_properties, sizeof(playlists_properties) / sizeof(playlists_properties[0]));
+        GVariant *playlists_children[3] = {
+            g_variant_new_string(ROOT_INTERFACE),
+            g_variant_new_array(G_VARIANT_TYPE("{sv}"), NULL, 0),
+            playlists_invalidated,
+        };
+        GVariant *playlists_invalidated_tuple = g_variant_new_tuple(playlists_children, 3);
+        context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                            playlists_invalidated_tuple, &tmp_error);
+        if (tmp_error != NULL) {
+            goto out;
+        }
+    }
+
+    GVariantDict dict;
+    g_variant_dict_init(&dict, NULL);
+    g_variant_dict_insert_value(&dict, "PlayerNames", context_player_names_to_gvariant(ctx));
+
+    GVariant *playerctld_children[3] = {
+        g_variant_new_string(PLAYERCTLD_INTERFACE),
+        g_variant_dict_end(&dict),
+        g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0),
+    };
+    GVariant *playerctld_properties = g_variant_new_tuple(playerctld_children, 3);
+    context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                        playerctld_properties, &tmp_error);
+    if (tmp_error != NULL) {
+        goto out;
+    }
+    context_emit_signal(ctx, MPRIS_PATH, PLAYERCTLD_INTERFACE, "ActivePlayerChangeEnd",
+                        g_variant_new("(s)", name), &tmp_error);
+    if (tmp_error != NULL) {
+        goto out;
+    }
+
+out:
+    if (tmp_error != NULL) {
+        g_propagate_error(error, tmp_error);
+    }
+    // the end is traced on every exit so each begin has an end
+    PCTL_TRACE1(active_player_change_end, name);
+}
+
+static struct Player *context_find_player(struct PlayerctldContext *ctx, const char *unique,
+                                          const char *well_known) {
+    const struct Player find_name = {
+        .unique = (char *)unique,
+        .well_known = (char *)well_known,
+    };
+    GList *found = g_queue_find_custom(ctx->players, &find_name, player_compare);
+    if (found != NULL) {
+        return (struct Player *)found->data;
+    }
+
+    found = g_queue_find_custom(ctx->pending_players, &find_name, player_compare);
+    if (found != NULL) {
+        return (struct Player *)found->data;
+    }
+
+    return NULL;
+}
+
+static struct Player *context_get_active_player(struct PlayerctldContext *ctx) {
+    return g_queue_peek_head(ctx->players);
+}
+
+static void context_set_active_player(struct PlayerctldContext *ctx, struct Player *player) {
+    g_queue_remove(ctx->players, player);
+    g_queue_remove(ctx->pending_players, player);
+    g_queue_push_head(ctx->players, player);
+    ctx->pending_active = NULL;
+    context_schedule_save(ctx);
+}
+
+static void context_add_player(struct PlayerctldContext *ctx, struct Player *player) {
+    g_queue_remove(ctx->players, player);
+    g_queue_remove(ctx->pending_players, player);
+    g_queue_push_tail(ctx->players, player);
+    context_schedule_save(ctx);
+}
+
+static void context_add_pending_player(struct PlayerctldContext *ctx, struct Player *player) {
+    g_queue_remove(ctx->players, player);
+    g_queue_remove(ctx->pending_players, player);
+    g_queue_push_tail(ctx->pending_players, player);
+}
+
+static void context_remove_player(struct PlayerctldContext *ctx, struct Player *player) {
+    g_queue_remove(ctx->players, player);
+    g_queue_remove(ctx->pending_players, player);
+    if (ctx->pending_active == player) {
+        ctx->pending_active = NULL;
+    }
+    context_schedule_save(ctx);
+}
+
+static void context_rotate_queue(struct PlayerctldContext *ctx) {
+    struct Player *player;
+    if ((player = g_queue_peek_head(ctx->players))) {
+        context_remove_player(ctx, player);
+        g_queue_push_tail(ctx->players, player);
+    }
+}
+
+static void context_unrotate_queue(struct PlayerctldContext *ctx) {
+    struct Player *player;
+    if ((player = g_queue_peek_tail(ctx->players))) {
+        context_remove_player(ctx, player);
+        g_queue_push_head(ctx->players, player);
+    }
+}
+
+/**
+ * Returns the newly activated player
+ */
+static struct Player *context_shift_active_player(struct PlayerctldContext *ctx) {
+    GError *error = NULL;
+    struct Player *previous, *current;
+
+    if (!(previous = current = context_get_active_player(ctx))) {
+        return NULL;
+    }
+    context_remove_player(ctx, previous);
+    context_add_player(ctx, previous);
     if ((current = context_get_active_player(ctx)) != previous) {
+        current->selected_time = g_get_monotonic_time();
         player_update_position_sync(current, ctx, &error);
         if (error != NULL) {
             g_warning("could not update player position: %s", error->message);
@@ -542,18 +1432,149 @@ static struct Player *context_unshift_active_player(struct PlayerctldContext *ct
     context_unrotate_queue(ctx);
 
     if ((current = context_get_active_player(ctx)) != previous) {
+        current->selected_time = g_get_monotonic_time();
         player_update_position_sync(current, ctx, &error);
         if (error != NULL) {
             g_warning("could not update player position: %s", error->message);
             g_clear_error(&error);
         }
-        context_emit_active_player_changed(ctx, &error);
-        if (error != NULL) {
-            g_warning("could not emit active player change: %s", error->message);
-            g_clear_error(&error);
+        context_emit_active_player_changed(ctx, &error);
+        if (error != NULL) {
+            g_warning("could not emit active player change: %s", error->message);
+            g_clear_error(&error);
+        }
+    }
+    return current;
+}
+
+/*
+ * The policy decides which player becomes active when a player changes. With
+ * the recent policy, the player that changed last is active. The score policy
+ * ranks the players by playback status, how recently their track or status
+ * changed, and the priority of their name, and only moves to a player that
+ * outranks the active player by a margin so the active player does not flap
+ * between players that change at the same time.
+ */
+struct ActivePolicy {
+    const char *name;
+    // ranks the player, or NULL to make the player that changed active
+    gint64 (*score)(struct PlayerctldContext *ctx, struct Player *player, gint64 now);
+    // how much a player must outrank the active player to take its place
+    gint64 hysteresis;
+};
+
+#define SCORE_PLAYING 1000
+#define SCORE_PAUSED 100
+// a change of track or status counts for this much, less a point for each second since
+#define SCORE_RECENT_MAX 600
+// a player the user shifted to keeps this much for a while so it is not switched away from
+#define SCORE_SELECTED 2000
+#define SCORE_SELECTED_SECONDS 60
+#define SCORE_HYSTERESIS 200
+
+static gint64 context_player_priority(struct PlayerctldContext *ctx, struct Player *player) {
+    gpointer priority = NULL;
+    const gchar *name = player->well_known + strlen("org.mpris.MediaPlayer2.");
+
+    if (ctx->priorities == NULL) {
+        return 0;
+    }
+
+    // a priority for the instance takes precedence over the priority for the player name
+    if (g_hash_table_lookup_extended(ctx->priorities, name, NULL, &priority)) {
+        return GPOINTER_TO_INT(priority);
+    }
+
+    const gchar *instance = strchr(name, '.');
+    if (instance != NULL) {
+        gchar *player_name = g_strndup(name, instance - name);
+        gboolean found =
+            g_hash_table_lookup_extended(ctx->priorities, player_name, NULL, &priority);
+        g_free(player_name);
+        if (found) {
+            return GPOINTER_TO_INT(priority);
+        }
+    }
+
+    return 0;
+}
+
+static gint64 score_policy_score(struct PlayerctldContext *ctx, struct Player *player, gint64 now) {
+    gint64 score = 0;
+
+    const gchar *status = NULL;
+    if (player->player_properties != NULL &&
+        g_variant_lookup(player->player_properties, "PlaybackStatus", "&s", &status)) {
+        if (g_strcmp0(status, "Playing") == 0) {
+            score += SCORE_PLAYING;
+        } else if (g_strcmp0(status, "Paused") == 0) {
+            score += SCORE_PAUSED;
+        }
+    }
+
+    if (player->last_activity != 0) {
+        gint64 age = (now - player->last_activity) / G_USEC_PER_SEC;
+        score += MAX(SCORE_RECENT_MAX - age, 0);
+    }
+
+    if (player->selected_time != 0 &&
+        now - player->selected_time < SCORE_SELECTED_SECONDS * G_USEC_PER_SEC) {
+        score += SCORE_SELECTED;
+    }
+
+    return score + context_player_priority(ctx, player);
+}
+
+static const struct ActivePolicy active_policies[] = {
+    {"recent", NULL, 0},
+    {"score", score_policy_score, SCORE_HYSTERESIS},
+};
+
+static const struct ActivePolicy *active_policy_find(const gchar *name) {
+    for (gsize i = 0; i < G_N_ELEMENTS(active_policies); ++i) {
+        if (g_strcmp0(active_policies[i].name, name) == 0) {
+            return &active_policies[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Returns the player that should become active after the player changed, or
+ * NULL if the active player stays.
+ */
+static struct Player *context_choose_active_player(struct PlayerctldContext *ctx,
+                                                   struct Player *changed) {
+    struct Player *active = context_get_active_player(ctx);
+
+    if (ctx->policy->score == NULL) {
+        return (changed != active ? changed : NULL);
+    }
+
+    gint64 now = g_get_monotonic_time();
+    struct Player *best = NULL;
+    gint64 best_score = 0;
+    gint64 active_score = 0;
+    for (GList *l = ctx->players->head; l != NULL; l = l->next) {
+        struct Player *player = l->data;
+        gint64 score = ctx->policy->score(ctx, player, now);
+        if (player == active) {
+            active_score = score;
+        }
+        // ties go to the player ahead in the queue
+        if (best == NULL || score > best_score) {
+            best = player;
+            best_score = score;
         }
     }
-    return current;
+
+    if (best == active || best_score < active_score + ctx->policy->hysteresis) {
+        return NULL;
+    }
+
+    g_debug("%s outranks %s: %" G_GINT64_FORMAT " > %" G_GINT64_FORMAT, best->well_known,
+            active->well_known, best_score, active_score);
+    return best;
 }
 
 static const char *playerctld_introspection_xml =
@@ -565,6 +1586,13 @@ static const char *playerctld_introspection_xml =
     "    <method name=\"Unshift\">\n"
     "        <arg name=\"Player\" type=\"s\" direction=\"out\"/>\n"
     "    </method>\n"
+    "    <method name=\"GetHistory\">\n"
+    "        <arg name=\"Since\" type=\"x\" direction=\"in\"/>\n"
+    "        <arg name=\"Events\" type=\"a(xsss)\" direction=\"out\"/>\n"
+    "    </method>\n"
+    "    <method name=\"GetStats\">\n"
+    "        <arg name=\"Stats\" type=\"a{sv}\" direction=\"out\"/>\n"
+    "    </method>\n"
     "    <property name=\"PlayerNames\" type=\"as\" access=\"read\"/>\n"
     "    <signal name=\"ActivePlayerChangeBegin\">\n"
     "        <arg name=\"Name\" type=\"s\"/>\n"
@@ -720,17 +1748,36 @@ static const char *mpris_introspection_xml =
     "  </interface>\n"
     "</node>\n";
 
-static void proxy_method_call_async_callback(GObject *source_object, GAsyncResult *res,
-                                             gpointer user_data) {
-    GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION(user_data);
-    GDBusConnection *connection = G_DBUS_CONNECTION(source_object);
-    GError *error = NULL;
-    GDBusMessage *reply = g_dbus_connection_send_message_with_reply_finish(connection, res, &error);
-    if (error != NULL) {
-        g_dbus_method_invocation_return_gerror(invocation, error);
-        g_error_free(error);
-        return;
+struct ProxyCallUserData {
+    struct PlayerctldContext *ctx;
+    // the calls answered with the reply, more than one when calls were merged
+    GSList *invocations;
+    // the player is found again by name since it may have gone away during the call
+    gchar *well_known;
+    gint64 start_time;
+};
+
+/*
+ * Counts the call to the player in the stats once it has returned.
+ */
+static void proxy_call_record(struct ProxyCallUserData *data, gboolean failed) {
+    struct PlayerctldContext *ctx = data->ctx;
+    gint64 latency = g_get_monotonic_time() - data->start_time;
+
+    ctx->stats.method_calls++;
+    if (failed) {
+        ctx->stats.method_call_errors++;
     }
+    histogram_add(&ctx->stats.call_latency, latency);
+
+    struct Player *player = context_find_player(ctx, NULL, data->well_known);
+    if (player != NULL) {
+        player->stats.method_calls++;
+        histogram_add(&player->stats.call_latency, latency);
+    }
+}
+
+static void proxy_call_return(GDBusMethodInvocation *invocation, GDBusMessage *reply) {
     GVariant *body = g_dbus_message_get_body(reply);
     GDBusMessageType message_type = g_dbus_message_get_message_type(reply);
     switch (message_type) {
@@ -754,9 +1801,246 @@ static void proxy_method_call_async_callback(GObject *source_object, GAsyncResul
         g_warning("got unexpected message type: %d (this is a dbus spec violation)", message_type);
         break;
     }
+}
+
+static void proxy_method_call_async_callback(GObject *source_object, GAsyncResult *res,
+                                             gpointer user_data) {
+    struct ProxyCallUserData *data = user_data;
+    GDBusConnection *connection = G_DBUS_CONNECTION(source_object);
+    GError *error = NULL;
+    GDBusMessage *reply = g_dbus_connection_send_message_with_reply_finish(connection, res, &error);
+    if (error != NULL) {
+        proxy_call_record(data, TRUE);
+        for (GSList *l = data->invocations; l != NULL; l = l->next) {
+            g_dbus_method_invocation_return_gerror(l->data, error);
+        }
+        g_error_free(error);
+        goto out;
+    }
+    proxy_call_record(data,
+                      g_dbus_message_get_message_type(reply) != G_DBUS_MESSAGE_TYPE_METHOD_RETURN);
+    for (GSList *l = data->invocations; l != NULL; l = l->next) {
+        proxy_call_return(l->data, reply);
+    }
 
-    g_object_unref(invocation);
     g_object_unref(reply);
+
+out:
+    g_slist_free(data->invocations);
+    g_free(data->well_known);
+    free(data);
+}
+
+/*
+ * Sends the message to the player and answers the invocations with its reply.
+ * Takes the invocations.
+ */
+static void context_send_to_player(struct PlayerctldContext *ctx, struct Player *player,
+                                   GDBusMessage *message, GSList *invocations) {
+    // the unique name of a restored player may belong to a player that has exited
+    g_dbus_message_set_destination(message, (player->stale ? player->well_known : player->unique));
+
+    struct ProxyCallUserData *data = calloc(1, sizeof(struct ProxyCallUserData));
+    data->ctx = ctx;
+    data->invocations = invocations;
+    data->well_known = g_strdup(player->well_known);
+    data->start_time = g_get_monotonic_time();
+    g_dbus_connection_send_message_with_reply(ctx->connection, message,
+                                              G_DBUS_SEND_MESSAGE_FLAGS_NONE, ctx->call_timeout,
+                                              NULL, NULL, proxy_method_call_async_callback, data);
+}
+
+/*
+ * The volume the player last reported, or -1 if it is not known.
+ */
+static gdouble player_cached_volume(struct Player *player) {
+    gdouble volume = -1;
+
+    if (player->player_properties != NULL &&
+        !g_variant_lookup(player->player_properties, "Volume", "d", &volume)) {
+        volume = -1;
+    }
+
+    return volume;
+}
+
+/*
+ * Sends the seek and the volume set merged from the calls of the window.
+ * Returns FALSE if there was nothing to send.
+ */
+static gboolean player_coalesce_flush(struct PlayerctldContext *ctx, struct Player *player) {
+    gboolean sent = FALSE;
+
+    if (player->coalesce.seeks != NULL) {
+        g_debug("sending %u merged seeks to player '%s'", g_slist_length(player->coalesce.seeks),
+                player->well_known);
+        GDBusMessage *message =
+            g_dbus_message_new_method_call(NULL, MPRIS_PATH, PLAYER_INTERFACE, "Seek");
+        g_dbus_message_set_body(message, g_variant_new("(x)", player->coalesce.seek_offset));
+        context_send_to_player(ctx, player, message, g_slist_reverse(player->coalesce.seeks));
+        g_object_unref(message);
+        player->coalesce.seeks = NULL;
+        player->coalesce.seek_offset = 0;
+        sent = TRUE;
+    }
+
+    if (player->coalesce.volume_sets != NULL) {
+        gdouble volume = player->coalesce.volume;
+        if (player->coalesce.volume_base >= 0) {
+            volume = MAX(player->coalesce.volume_base + player->coalesce.volume_delta, 0.0);
+        }
+        g_debug("sending %u merged volume sets to player '%s'",
+                g_slist_length(player->coalesce.volume_sets), player->well_known);
+        GDBusMessage *message =
+            g_dbus_message_new_method_call(NULL, MPRIS_PATH, PROPERTIES_INTERFACE, "Set");
+        g_dbus_message_set_body(message, g_variant_new("(ssv)", PLAYER_INTERFACE, "Volume",
+                                                       g_variant_new_double(volume)));
+        context_send_to_player(ctx, player, message, g_slist_reverse(player->coalesce.volume_sets));
+        g_object_unref(message);
+        player->coalesce.volume_base = volume;
+        player->coalesce.volume_sets = NULL;
+        sent = TRUE;
+    } else if (player->coalesce.volume_base >= 0) {
+        // a set sent when the window opened has changed the volume by now
+        player->coalesce.volume_base += player->coalesce.volume_delta;
+    }
+    player->coalesce.volume_delta = 0;
+
+    return sent;
+}
+
+struct CoalesceWindowUserData {
+    struct PlayerctldContext *ctx;
+    // the source is removed when the player is freed
+    struct Player *player;
+};
+
+static gboolean coalesce_window_callback(gpointer user_data) {
+    struct CoalesceWindowUserData *data = user_data;
+
+    if (player_coalesce_flush(data->ctx, data->player)) {
+        // keep the window open so the next calls are merged as well
+        return G_SOURCE_CONTINUE;
+    }
+
+    data->player->coalesce.source_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/*
+ * Merges a relative seek or a volume set into the calls pending for the player
+ * when one was sent within the coalesce window. The seeks are merged into one
+ * seek by the sum of their offsets. A relative volume change arrives as a set
+ * of the volume its caller computed from the volume the player reported,
+ * which does not change while the sets are held back. So each set is taken as
+ * a change from the volume at the start of the window, and the sets are merged
+ * into one set by the sum of their changes.
+ * Returns FALSE if the call must be sent to the player now, in which case the
+ * window is opened. Takes the invocation otherwise.
+ */
+static gboolean player_coalesce_call(struct PlayerctldContext *ctx, struct Player *player,
+                                     const char *interface_name, const char *method_name,
+                                     GVariant *parameters, GDBusMethodInvocation *invocation) {
+    gboolean seek = FALSE;
+    gboolean volume = FALSE;
+    gdouble requested_volume = 0;
+
+    if (g_strcmp0(interface_name, PLAYER_INTERFACE) == 0 && g_strcmp0(method_name, "Seek") == 0 &&
+        g_variant_is_of_type(parameters, G_VARIANT_TYPE("(x)"))) {
+        seek = TRUE;
+    } else if (g_strcmp0(interface_name, PROPERTIES_INTERFACE) == 0 &&
+               g_strcmp0(method_name, "Set") == 0 &&
+               g_variant_is_of_type(parameters, G_VARIANT_TYPE("(ssv)"))) {
+        const gchar *property_interface = NULL;
+        const gchar *property_name = NULL;
+        GVariant *value = NULL;
+        g_variant_get(parameters, "(&s&sv)", &property_interface, &property_name, &value);
+        if (g_strcmp0(property_interface, PLAYER_INTERFACE) == 0 &&
+            g_strcmp0(property_name, "Volume") == 0 &&
+            g_variant_is_of_type(value, G_VARIANT_TYPE_DOUBLE)) {
+            volume = TRUE;
+            requested_volume = g_variant_get_double(value);
+        }
+        g_variant_unref(value);
+    }
+
+    if (ctx->coalesce_window == 0 || (!seek && !volume)) {
+        return FALSE;
+    }
+
+    if (player->coalesce.source_id == 0) {
+        struct CoalesceWindowUserData *data = calloc(1, sizeof(struct CoalesceWindowUserData));
+        data->ctx = ctx;
+        data->player = player;
+        player->coalesce.source_id = g_timeout_add_full(
+            G_PRIORITY_DEFAULT, ctx->coalesce_window, coalesce_window_callback, data, free);
+        player->coalesce.volume_base = player_cached_volume(player);
+        player->coalesce.volume_delta = 0;
+        if (volume && player->coalesce.volume_base >= 0) {
+            player->coalesce.volume_delta = requested_volume - player->coalesce.volume_base;
+        }
+        return FALSE;
+    }
+
+    ctx->stats.method_calls_merged++;
+    if (seek) {
+        gint64 offset = 0;
+        g_variant_get(parameters, "(x)", &offset);
+        player->coalesce.seek_offset += offset;
+        player->coalesce.seeks = g_slist_prepend(player->coalesce.seeks, invocation);
+    } else {
+        if (player->coalesce.volume_base >= 0) {
+            player->coalesce.volume_delta += requested_volume - player->coalesce.volume_base;
+        }
+        player->coalesce.volume = requested_volume;
+        player->coalesce.volume_sets = g_slist_prepend(player->coalesce.volume_sets, invocation);
+    }
+
+    return TRUE;
+}
+
+/*
+ * Answers a Get or GetAll of the player or root properties from the cache.
+ * Returns FALSE if the call must go to the player.
+ */
+static gboolean player_return_cached_properties(struct Player *player, const char *method_name,
+                                                GVariant *parameters,
+                                                GDBusMethodInvocation *invocation) {
+    const gchar *interface_name = NULL;
+    const gchar *property_name = NULL;
+
+    if (g_strcmp0(method_name, "GetAll") == 0 &&
+        g_variant_is_of_type(parameters, G_VARIANT_TYPE("(s)"))) {
+        g_variant_get(parameters, "(&s)", &interface_name);
+    } else if (g_strcmp0(method_name, "Get") == 0 &&
+               g_variant_is_of_type(parameters, G_VARIANT_TYPE("(ss)"))) {
+        g_variant_get(parameters, "(&s&s)", &interface_name, &property_name);
+    } else {
+        return FALSE;
+    }
+
+    GVariant *cached = NULL;
+    if (g_strcmp0(interface_name, PLAYER_INTERFACE) == 0) {
+        cached = player->player_properties;
+    } else if (g_strcmp0(interface_name, ROOT_INTERFACE) == 0) {
+        cached = player->root_properties;
+    }
+    if (cached == NULL) {
+        return FALSE;
+    }
+
+    if (property_name == NULL) {
+        g_dbus_method_invocation_return_value(invocation, g_variant_new("(@a{sv})", cached));
+        return TRUE;
+    }
+
+    GVariant *value = g_variant_lookup_value(cached, property_name, NULL);
+    if (value == NULL) {
+        return FALSE;
+    }
+    g_dbus_method_invocation_return_value(invocation, g_variant_new("(v)", value));
+    g_variant_unref(value);
+    return TRUE;
 }
 
 /**
@@ -781,6 +2065,19 @@ static void player_method_call_proxy_callback(GDBusConnection *connection, const
         return;
     }
 
+    if (active_player->stale && g_strcmp0(interface_name, PROPERTIES_INTERFACE) == 0 &&
+        player_return_cached_properties(active_player, method_name, parameters, invocation)) {
+        g_debug("returned stale properties of restored player '%s'", active_player->well_known);
+        return;
+    }
+
+    if (player_coalesce_call(ctx, active_player, interface_name, method_name, parameters,
+                             invocation)) {
+        g_debug("merged command '%s.%s' for player '%s'", interface_name, method_name,
+                active_player->well_known);
+        return;
+    }
+
     GDBusMessage *message =
         g_dbus_message_copy(g_dbus_method_invocation_get_message(invocation), &error);
     if (error != NULL) {
@@ -792,12 +2089,7 @@ static void player_method_call_proxy_callback(GDBusConnection *connection, const
     g_debug("sending command '%s.%s' to player '%s'", interface_name, method_name,
             active_player->well_known);
 
-    g_dbus_message_set_destination(message, active_player->unique);
-
-    g_object_ref(invocation);
-    g_dbus_connection_send_message_with_reply(ctx->connection, message,
-                                              G_DBUS_SEND_MESSAGE_FLAGS_NONE, -1, NULL, NULL,
-                                              proxy_method_call_async_callback, invocation);
+    context_send_to_player(ctx, active_player, message, g_slist_prepend(NULL, invocation));
 
     g_object_unref(message);
 }
@@ -845,6 +2137,24 @@ static void playerctld_method_call_func(GDBusConnection *connection, const char
                 invocation, "com.github.altdesktop.playerctld.NoActivePlayer",
                 "No player is being controlled by playerctld");
         }
+    } else if (strcmp(method_name, "GetHistory") == 0) {
+        /**
+         * com.github.altdesktop.playerctld.GetHistory
+         * Return the recorded player activity after the CLOCK_MONOTONIC time
+         * in microseconds, oldest first, as (time, kind, player, detail)
+         */
+        gint64 since = 0;
+        g_variant_get(parameters, "(x)", &since);
+        g_dbus_method_invocation_return_value(
+            invocation, g_variant_new("(@a(xsss))", history_to_gvariant(ctx->history, since)));
+    } else if (strcmp(method_name, "GetStats") == 0) {
+        /**
+         * com.github.altdesktop.playerctld.GetStats
+         * Return the counters and latency histograms of the daemon and its
+         * players
+         */
+        g_dbus_method_invocation_return_value(
+            invocation, g_variant_new("(@a{sv})", context_stats_to_gvariant(ctx)));
     } else {
         /**
          * Fail on unknown methods.
@@ -946,10 +2256,322 @@ static bool well_known_name_is_managed(const char *name) {
            !g_str_has_prefix(name, "org.mpris.MediaPlayer2.playerctld");
 }
 
+/*
+ * Restores the players from the state file, marked stale. Returns TRUE if any
+ * players were restored. The state is only used if it was saved for the same
+ * bus.
+ */
+static gboolean context_load_state(struct PlayerctldContext *ctx) {
+    GError *error = NULL;
+
+    if (ctx->state.path == NULL) {
+        return FALSE;
+    }
+
+    GMappedFile *file = g_mapped_file_new(ctx->state.path, FALSE, &error);
+    if (error != NULL) {
+        if (!g_error_matches(error, G_FILE_ERROR, G_FILE_ERROR_NOENT)) {
+            g_warning("could not read state from %s: %s", ctx->state.path, error->message);
+        }
+        g_clear_error(&error);
+        return FALSE;
+    }
+
+    GBytes *bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    // the contents are checked as they are read since the file is not trusted
+    GVariant *state =
+        g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(STATE_TYPE), bytes, FALSE));
+    g_bytes_unref(bytes);
+    if (G_BYTE_ORDER == G_BIG_ENDIAN) {
+        GVariant *swapped = g_variant_byteswap(state);
+        g_variant_unref(state);
+        state = swapped;
+    }
+
+    guint32 version = 0;
+    const gchar *bus_address = NULL;
+    GVariantIter *players = NULL;
+    g_variant_get(state, "(u&sa(sxa{sv}a{sv}))", &version, &bus_address, &players);
+
+    if (version != STATE_VERSION || g_strcmp0(bus_address, ctx->bus_address) != 0) {
+        g_debug("ignoring state saved for another bus or version: %s", ctx->state.path);
+        g_variant_iter_free(players);
+        g_variant_unref(state);
+        return FALSE;
+    }
+
+    const gchar *well_known = NULL;
+    gint64 last_activity = 0;
+    GVariant *player_properties = NULL;
+    GVariant *root_properties = NULL;
+    gint64 monotonic_now = g_get_monotonic_time();
+    gint64 real_now = g_get_real_time();
+    while (g_variant_iter_next(players, "(&sx@a{sv}@a{sv})", &well_known, &last_activity,
+                               &player_properties, &root_properties)) {
+        if (!well_known_name_is_managed(well_known) ||
+            context_find_player(ctx, NULL, well_known) != NULL) {
+            g_variant_unref(player_properties);
+            g_variant_unref(root_properties);
+            continue;
+        }
+
+        g_debug("restored player: %s", well_known);
+        // the unique name is looked up again since unique names are not kept across bus restarts
+        struct Player *player = player_new(NULL, well_known);
+        player->player_properties = player_properties;
+        player->root_properties = root_properties;
+        player->last_activity =
+            (last_activity != 0 ? monotonic_now - MAX(real_now - last_activity, 0) : 0);
+        player->stale = true;
+        g_queue_push_tail(ctx->players, player);
+    }
+
+    g_variant_iter_free(players);
+    g_variant_unref(state);
+    return !g_queue_is_empty(ctx->players);
+}
+
+static bool names_contain(const gchar *const *names, const gchar *name) {
+    for (gsize i = 0; names[i] != NULL; ++i) {
+        if (g_strcmp0(names[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+struct ReconcileUserData {
+    struct PlayerctldContext *ctx;
+    // the player is found again by name since it may have gone away during the call
+    gchar *well_known;
+    const char *interface_name;
+    gint64 start_time;
+};
+
+static struct ReconcileUserData *reconcile_data_new(struct PlayerctldContext *ctx,
+                                                    const char *well_known,
+                                                    const char *interface_name) {
+    struct ReconcileUserData *data = calloc(1, sizeof(struct ReconcileUserData));
+    data->ctx = ctx;
+    data->well_known = g_strdup(well_known);
+    data->interface_name = interface_name;
+    data->start_time = g_get_monotonic_time();
+    return data;
+}
+
+static void reconcile_data_free(struct ReconcileUserData *data) {
+    g_free(data->well_known);
+    free(data);
+}
+
+static void reconcile_properties_callback(GObject *source_object, GAsyncResult *res,
+                                          gpointer user_data) {
+    struct ReconcileUserData *data = user_data;
+    struct PlayerctldContext *ctx = data->ctx;
+    GError *error = NULL;
+
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object), res, &error);
+    struct Player *player = context_find_player(ctx, NULL, data->well_known);
+    if (error != NULL) {
+        g_debug("could not get %s properties of restored player %s: %s", data->interface_name,
+                data->well_known, error->message);
+        g_clear_error(&error);
+        goto out;
+    }
+    histogram_add(&ctx->stats.get_all_latency, g_get_monotonic_time() - data->start_time);
+
+    if (player == NULL) {
+        g_variant_unref(reply);
+        goto out;
+    }
+
+    GVariant *properties = g_variant_get_child_value(reply, 0);
+    if (g_strcmp0(data->interface_name, TRACKLIST_INTERFACE) == 0) {
+        player->tracklist.supported = true;
+    } else if (g_strcmp0(data->interface_name, PLAYLISTS_INTERFACE) == 0) {
+        player->playlists.supported = true;
+    } else if (g_strcmp0(data->interface_name, PLAYER_INTERFACE) == 0) {
+        history_record_player_changes(ctx, player, properties);
+    }
+
+    gboolean changed = player_update_properties(player, data->interface_name, properties);
+    if (g_strcmp0(data->interface_name, PLAYER_INTERFACE) == 0) {
+        player->stale = false;
+    }
+    g_variant_unref(properties);
+    g_variant_unref(reply);
+
+    if (g_queue_find(ctx->pending_players, player) != NULL) {
+        // a player found on the bus that was not restored joins once it has properties
+        if (player->player_properties != NULL && player->root_properties != NULL) {
+            context_add_player(ctx, player);
+            if (player == context_get_active_player(ctx)) {
+                context_emit_active_player_changed(ctx, &error);
+                if (error != NULL) {
+                    g_warning("could not emit active player change: %s", error->message);
+                    g_clear_error(&error);
+                }
+            }
+        }
+        goto out;
+    }
+
+    if (!changed) {
+        goto out;
+    }
+    context_schedule_save(ctx);
+
+    if (player == context_get_active_player(ctx)) {
+        // clients may have read the stale properties
+        GVariant *cached = (g_strcmp0(data->interface_name, PLAYER_INTERFACE) == 0
+                                ? player->player_properties
+                                : g_strcmp0(data->interface_name, ROOT_INTERFACE) == 0
+                                      ? player->root_properties
+                                      : NULL);
+        if (cached != NULL) {
+            context_emit_signal(ctx, MPRIS_PATH, PROPERTIES_INTERFACE, "PropertiesChanged",
+                                g_variant_new("(s@a{sv}@as)", data->interface_name, cached,
+                                              g_variant_new_array(G_VARIANT_TYPE_STRING, NULL, 0)),
+                                &error);
+            if (error != NULL) {
+                g_debug("could not emit signal: %s", error->message);
+                g_clear_error(&error);
+            }
+        }
+    }
+
+out:
+    reconcile_data_free(data);
+}
+
+static void reconcile_name_owner_callback(GObject *source_object, GAsyncResult *res,
+                                          gpointer user_data) {
+    static const char *const interfaces[] = {PLAYER_INTERFACE, ROOT_INTERFACE,
+                                             TRACKLIST_INTERFACE, PLAYLISTS_INTERFACE};
+    GDBusConnection *connection = G_DBUS_CONNECTION(source_object);
+    struct ReconcileUserData *data = user_data;
+    struct PlayerctldContext *ctx = data->ctx;
+    GError *error = NULL;
+
+    GVariant *reply = g_dbus_connection_call_finish(connection, res, &error);
+    struct Player *player = context_find_player(ctx, NULL, data->well_known);
+    if (error != NULL) {
+        g_clear_error(&error);
+        // a player without an owner would never get its properties or signals
+        if (player != NULL && (player->stale || player->unique == NULL)) {
+            g_debug("player is gone: %s", player->well_known);
+            bool is_active = (player == context_get_active_player(ctx));
+            context_remove_player(ctx, player);
+            player_free(player);
+            if (is_active) {
+                context_emit_active_player_changed(ctx, &error);
+                if (error != NULL) {
+                    g_warning("could not emit active player change: %s", error->message);
+                    g_clear_error(&error);
+                }
+            }
+        }
+        goto out;
+    }
+
+    if (player != NULL) {
+        const gchar *owner = NULL;
+        g_variant_get(reply, "(&s)", &owner);
+        player_set_unique_name(player, owner);
+
+        for (gsize i = 0; i < G_N_ELEMENTS(interfaces); ++i) {
+            g_dbus_connection_call(connection, owner, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
+                                   g_variant_new("(s)", interfaces[i]), NULL,
+                                   G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL,
+                                   reconcile_properties_callback,
+                                   reconcile_data_new(ctx, data->well_known, interfaces[i]));
+        }
+    }
+    g_variant_unref(reply);
+
+out:
+    reconcile_data_free(data);
+}
+
+static void reconcile_list_names_callback(GObject *source_object, GAsyncResult *res,
+                                          gpointer user_data) {
+    GDBusConnection *connection = G_DBUS_CONNECTION(source_object);
+    struct PlayerctldContext *ctx = user_data;
+    GError *error = NULL;
+
+    GVariant *reply = g_dbus_connection_call_finish(connection, res, &error);
+    if (error != NULL) {
+        g_warning("could not list names to check the restored players: %s", error->message);
+        g_clear_error(&error);
+        return;
+    }
+
+    const gchar **names = NULL;
+    g_variant_get(reply, "(^a&s)", &names);
+
+    struct Player *active = context_get_active_player(ctx);
+    bool players_changed = false;
+
+    // restored players whose names are gone are removed
+    GList *next = NULL;
+    for (GList *l = ctx->players->head; l != NULL; l = next) {
+        next = l->next;
+        struct Player *player = l->data;
+        if (player->stale && !names_contain(names, player->well_known)) {
+            g_debug("restored player is gone: %s", player->well_known);
+            context_remove_player(ctx, player);
+            player_free(player);
+            players_changed = true;
+        }
+    }
+
+    for (gsize i = 0; names[i] != NULL; ++i) {
+        if (!well_known_name_is_managed(names[i])) {
+            continue;
+        }
+
+        if (context_find_player(ctx, NULL, names[i]) == NULL) {
+            g_debug("found player that was not restored: %s", names[i]);
+            struct Player *player = player_new(NULL, names[i]);
+            context_add_pending_player(ctx, player);
+        }
+
+        g_dbus_connection_call(connection, DBUS_NAME, DBUS_PATH, DBUS_INTERFACE, "GetNameOwner",
+                               g_variant_new("(s)", names[i]), NULL,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL,
+                               reconcile_name_owner_callback,
+                               reconcile_data_new(ctx, names[i], NULL));
+    }
+
+    if (players_changed || context_get_active_player(ctx) != active) {
+        context_emit_active_player_changed(ctx, &error);
+        if (error != NULL) {
+            g_warning("could not emit active player change: %s", error->message);
+            g_clear_error(&error);
+        }
+    }
+
+    g_free(names);
+    g_variant_unref(reply);
+}
+
+/*
+ * Checks the restored players against the players on the bus. Players that are
+ * gone are removed, the rest get their properties read again, and players that
+ * were not restored are added.
+ */
+static void context_reconcile_state_async(struct PlayerctldContext *ctx) {
+    g_dbus_connection_call(ctx->connection, DBUS_NAME, DBUS_PATH, DBUS_INTERFACE, "ListNames",
+                           NULL, NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL,
+                           reconcile_list_names_callback, ctx);
+}
+
 struct GetPropertiesUserData {
     struct PlayerctldContext *ctx;
     const char *interface_name;
     struct Player *player;
+    gint64 start_time;
 };
 
 static void active_player_get_properties_async_callback(GObject *source_object, GAsyncResult *res,
@@ -964,12 +2586,17 @@ static void active_player_get_properties_async_callback(GObject *source_object,
         g_clear_error(&error);
         goto out;
     }
+    histogram_add(&data->ctx->stats.get_all_latency, g_get_monotonic_time() - data->start_time);
 
     g_debug("got all properties response for name='%s', interface '%s'", data->player->well_known,
             data->interface_name);
     // g_debug("%s", g_variant_print(body_value, TRUE));
 
     GVariant *body_value = g_variant_get_child_value(body, 0);
+    if (g_strcmp0(data->interface_name, PLAYER_INTERFACE) == 0 &&
+        history_record_player_changes(data->ctx, data->player, body_value)) {
+        data->player->last_activity = g_get_monotonic_time();
+    }
     player_update_properties(data->player, data->interface_name, body_value);
     g_variant_unref(body_value);
     g_variant_unref(body);
@@ -981,7 +2608,17 @@ static void active_player_get_properties_async_callback(GObject *source_object,
     }
 
     if (data->player == data->ctx->pending_active) {
-        context_set_active_player(data->ctx, data->player);
+        // the new player is ranked with the others before it becomes active
+        struct Player *active = context_get_active_player(data->ctx);
+        data->ctx->pending_active = NULL;
+        context_add_player(data->ctx, data->player);
+        struct Player *next_active =
+            (active == NULL ? data->player
+                            : context_choose_active_player(data->ctx, data->player));
+        if (next_active == NULL) {
+            goto out;
+        }
+        context_set_active_player(data->ctx, next_active);
         context_emit_active_player_changed(data->ctx, &error);
         if (error != NULL) {
             g_warning("could not emit properties changed signal for active player: %s",
@@ -1048,18 +2685,20 @@ static void name_owner_changed_signal_callback(GDBusConnection *connection,
         player_data->interface_name = PLAYER_INTERFACE;
         player_data->player = player;
         player_data->ctx = ctx;
+        player_data->start_time = g_get_monotonic_time();
         g_dbus_connection_call(connection, new_owner, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
                                g_variant_new("(s)", PLAYER_INTERFACE), NULL,
-                               G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL,
                                active_player_get_properties_async_callback, player_data);
 
         struct GetPropertiesUserData *root_data = calloc(1, sizeof(struct GetPropertiesUserData));
         root_data->interface_name = ROOT_INTERFACE;
         root_data->player = player;
         root_data->ctx = ctx;
+        root_data->start_time = g_get_monotonic_time();
         g_dbus_connection_call(connection, new_owner, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
                                g_variant_new("(s)", ROOT_INTERFACE), NULL,
-                               G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL,
                                active_player_get_properties_async_callback, root_data);
 
         struct GetPropertiesUserData *tracklist_data =
@@ -1067,9 +2706,10 @@ static void name_owner_changed_signal_callback(GDBusConnection *connection,
         tracklist_data->interface_name = TRACKLIST_INTERFACE;
         tracklist_data->player = player;
         tracklist_data->ctx = ctx;
+        tracklist_data->start_time = g_get_monotonic_time();
         g_dbus_connection_call(connection, new_owner, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
                                g_variant_new("(s)", TRACKLIST_INTERFACE), NULL,
-                               G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL,
                                active_player_get_properties_async_callback, tracklist_data);
 
         struct GetPropertiesUserData *playlists_data =
@@ -1077,9 +2717,10 @@ static void name_owner_changed_signal_callback(GDBusConnection *connection,
         playlists_data->interface_name = PLAYLISTS_INTERFACE;
         playlists_data->player = player;
         playlists_data->ctx = ctx;
+        playlists_data->start_time = g_get_monotonic_time();
         g_dbus_connection_call(connection, new_owner, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
                                g_variant_new("(s)", PLAYLISTS_INTERFACE), NULL,
-                               G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL,
+                               G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout, NULL,
                                active_player_get_properties_async_callback, playlists_data);
     } else {
         struct Player *player = context_find_player(ctx, NULL, name);
@@ -1144,28 +2785,39 @@ static void player_signal_proxy_callback(GDBusConnection *connection, const gcha
     }
     g_debug("got player signal: sender=%s, object_path=%s, interface_name=%s, signal_name=%s",
             sender_name, object_path, interface_name, signal_name);
+    ctx->stats.signals_received++;
+    player->stats.signals_received++;
 
     if (player == ctx->pending_active) {
         // TODO buffer seeked signals
         return;
     }
+    PCTL_TRACE2(signal_begin, player->well_known, signal_name);
 
     bool is_properties_changed = (g_strcmp0(signal_name, "PropertiesChanged") == 0);
 
     if (is_properties_changed) {
         GVariant *interface = g_variant_get_child_value(parameters, 0);
         GVariant *properties = g_variant_get_child_value(parameters, 1);
+        if (g_strcmp0(g_variant_get_string(interface, 0), PLAYER_INTERFACE) == 0 &&
+            history_record_player_changes(ctx, player, properties)) {
+            player->last_activity = g_get_monotonic_time();
+        }
         changed = player_update_properties(player, g_variant_get_string(interface, 0), properties);
         g_variant_unref(interface);
         g_variant_unref(properties);
+        if (changed) {
+            context_schedule_save(ctx);
+        }
     }
 
-    if (changed && player != context_get_active_player(ctx)) {
-        g_debug("new active player: %s", player->well_known);
-        context_set_active_player(ctx, player);
-        player_update_position_sync(player, ctx, &error);
+    struct Player *next_active = (changed ? context_choose_active_player(ctx, player) : NULL);
+    if (next_active != NULL) {
+        g_debug("new active player: %s", next_active->well_known);
+        context_set_active_player(ctx, next_active);
+        player_update_position_sync(next_active, ctx, &error);
         if (error != NULL) {
-            player->position = 0l;
+            next_active->position = 0l;
             g_warning("could not update player position: %s", error->message);
             g_clear_error(&error);
         }
@@ -1176,17 +2828,49 @@ static void player_signal_proxy_callback(GDBusConnection *connection, const gcha
         }
     }
 
-    g_dbus_connection_emit_signal(ctx->connection, NULL, object_path, interface_name, signal_name,
-                                  parameters, &error);
+    events_emit_player_signal(ctx, player, signal_name, parameters);
+
+    context_emit_signal(ctx, object_path, interface_name, signal_name, parameters, &error);
     if (error != NULL) {
         g_debug("could not emit signal: %s", error->message);
         g_clear_error(&error);
+    } else {
+        ctx->stats.signals_forwarded++;
+        player->stats.signals_forwarded++;
     }
+    PCTL_TRACE2(signal_end, player->well_known, signal_name);
 }
 
 static gchar **command_arg = NULL;
+static gint timeout_arg = -1;
+static gint coalesce_window_arg = 0;
+static gboolean socket_arg = FALSE;
+static gchar *history_file_arg = NULL;
+static gchar *state_file_arg = NULL;
+static gchar *policy_arg = NULL;
+static gchar **priority_arg = NULL;
 
 static const GOptionEntry entries[] = {
+    {"timeout", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &timeout_arg,
+     "The time in milliseconds to wait for a player to answer a call (default: 25000)", "MS"},
+    {"coalesce-window", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT, &coalesce_window_arg,
+     "Merge the relative seeks and volume changes sent to a player within MS milliseconds of the "
+     "last one sent into one call (default: 0, off)",
+     "MS"},
+    {"socket", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE, &socket_arg,
+     "Send player events to clients of the socket playerctld.sock in the runtime directory",
+     NULL},
+    {"history-file", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &history_file_arg,
+     "Also append the history of player activity to FILE", "FILE"},
+    {"state-file", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_FILENAME, &state_file_arg,
+     "Save the players to FILE and restore them from it when started again", "FILE"},
+    {"policy", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, &policy_arg,
+     "How the active player is chosen: recent (the player that changed last) or score "
+     "(default: recent)",
+     "POLICY"},
+    {"priority", 0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING_ARRAY, &priority_arg,
+     "Add POINTS to the score of the player with the name (can be given more than once)",
+     "NAME=POINTS"},
     {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &command_arg, NULL, "COMMAND"},
     {NULL},
 };
@@ -1195,7 +2879,8 @@ static gboolean parse_setup_options(int argc, char **argv, GError **error) {
     static const gchar *description = "Available Commands:"
                                       "\n  daemon                  Activate playerctld and exit"
                                       "\n  shift                   Shift to next player"
-                                      "\n  unshift                 Unshift to previous player";
+                                      "\n  unshift                 Unshift to previous player"
+                                      "\n  stats                   Print the stats of playerctld";
 
     GOptionContext *context;
     gboolean success;
@@ -1206,9 +2891,15 @@ static gboolean parse_setup_options(int argc, char **argv, GError **error) {
 
     success = g_option_context_parse(context, &argc, &argv, error);
 
+    if (success && (timeout_arg == 0 || timeout_arg < -1)) {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                    "Timeout must be a positive number of milliseconds: %d", timeout_arg);
+        success = FALSE;
+    }
+
     if (success && command_arg &&
         (g_strcmp0(command_arg[0], "shift") != 0 && g_strcmp0(command_arg[0], "unshift") != 0 &&
-         g_strcmp0(command_arg[0], "daemon") != 0)) {
+         g_strcmp0(command_arg[0], "daemon") != 0 && g_strcmp0(command_arg[0], "stats") != 0)) {
         gchar *help = g_option_context_get_help(context, TRUE, NULL);
         printf("%s\n", help);
         g_option_context_free(context);
@@ -1220,12 +2911,53 @@ static gboolean parse_setup_options(int argc, char **argv, GError **error) {
     return success;
 }
 
+/*
+ * Sets the policy and the player priorities from the options.
+ */
+static gboolean context_init_policy(struct PlayerctldContext *ctx, GError **error) {
+    ctx->policy = active_policy_find(policy_arg != NULL ? policy_arg : "recent");
+    if (ctx->policy == NULL) {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE, "Unknown policy: %s",
+                    policy_arg);
+        return FALSE;
+    }
+
+    if (priority_arg == NULL) {
+        return TRUE;
+    }
+
+    if (ctx->policy->score == NULL) {
+        g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                    "Priorities are only used by the score policy");
+        return FALSE;
+    }
+
+    ctx->priorities = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (gsize i = 0; priority_arg[i] != NULL; ++i) {
+        const gchar *separator = strrchr(priority_arg[i], '=');
+        gchar *end = NULL;
+        gint64 points = (separator != NULL ? g_ascii_strtoll(separator + 1, &end, 10) : 0);
+        if (separator == NULL || separator == priority_arg[i] || end == separator + 1 ||
+            *end != '\0' || points < G_MININT || points > G_MAXINT) {
+            g_set_error(error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                        "Priority must be a player name and a number of points: %s",
+                        priority_arg[i]);
+            return FALSE;
+        }
+        g_hash_table_insert(ctx->priorities,
+                            g_strndup(priority_arg[i], separator - priority_arg[i]),
+                            GINT_TO_POINTER((gint)points));
+    }
+
+    return TRUE;
+}
+
 int playercmd_shift(GDBusConnection *connection) {
     GError *error = NULL;
 
     g_dbus_connection_call_sync(connection, "org.mpris.MediaPlayer2.playerctld", MPRIS_PATH,
                                 PLAYERCTLD_INTERFACE, "Shift", NULL, NULL,
-                                G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
+                                G_DBUS_CALL_FLAGS_NO_AUTO_START, timeout_arg, NULL, &error);
     g_object_unref(connection);
     if (error != NULL) {
         g_printerr("Cannot shift: %s\n", error->message);
@@ -1239,7 +2971,7 @@ int playercmd_unshift(GDBusConnection *connection) {
 
     g_dbus_connection_call_sync(connection, "org.mpris.MediaPlayer2.playerctld", MPRIS_PATH,
                                 PLAYERCTLD_INTERFACE, "Unshift", NULL, NULL,
-                                G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
+                                G_DBUS_CALL_FLAGS_NO_AUTO_START, timeout_arg, NULL, &error);
     g_object_unref(connection);
     if (error != NULL) {
         g_printerr("Cannot unshift: %s\n", error->message);
@@ -1248,6 +2980,85 @@ int playercmd_unshift(GDBusConnection *connection) {
     return 0;
 }
 
+static void print_histogram(const gchar *indent, const gchar *name, GVariant *histogram) {
+    static const guint percentiles[] = {50, 90, 99};
+    guint64 count = 0, total = 0, max = 0;
+    gsize n_buckets = 0;
+
+    g_variant_lookup(histogram, "Count", "t", &count);
+    g_variant_lookup(histogram, "Total", "t", &total);
+    g_variant_lookup(histogram, "Max", "t", &max);
+    GVariant *buckets_value = g_variant_lookup_value(histogram, "Buckets", G_VARIANT_TYPE("at"));
+    if (buckets_value == NULL) {
+        return;
+    }
+    const guint64 *buckets =
+        g_variant_get_fixed_array(buckets_value, &n_buckets, sizeof(guint64));
+
+    printf("%s%s: count %" G_GUINT64_FORMAT, indent, name, count);
+    if (count > 0 && n_buckets > 0) {
+        printf(", mean %" G_GUINT64_FORMAT "us", total / count);
+        // the buckets only bound each percentile from above
+        for (gsize p = 0; p < G_N_ELEMENTS(percentiles); ++p) {
+            guint64 rank = (count * percentiles[p] + 99) / 100;
+            guint64 seen = 0;
+            gsize i = 0;
+            while (i < n_buckets - 1 && (seen += buckets[i]) < rank) {
+                ++i;
+            }
+            guint64 bound = (i < n_buckets - 1 ? MIN((G_GUINT64_CONSTANT(2) << i) - 1, max) : max);
+            printf(", p%u <= %" G_GUINT64_FORMAT "us", percentiles[p], bound);
+        }
+        printf(", max %" G_GUINT64_FORMAT "us", max);
+    }
+    printf("\n");
+    g_variant_unref(buckets_value);
+}
+
+static void print_stats(const gchar *indent, GVariant *stats) {
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *value;
+
+    g_variant_iter_init(&iter, stats);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        if (g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT) &&
+            g_variant_lookup(value, "Buckets", "@at", NULL)) {
+            print_histogram(indent, key, value);
+        } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT)) {
+            gchar *nested_indent = g_strconcat(indent, "  ", NULL);
+            printf("%s%s:\n", indent, key);
+            print_stats(nested_indent, value);
+            g_free(nested_indent);
+        } else {
+            gchar *printed = g_variant_print(value, FALSE);
+            printf("%s%s: %s\n", indent, key, printed);
+            g_free(printed);
+        }
+        g_variant_unref(value);
+    }
+}
+
+int playercmd_stats(GDBusConnection *connection) {
+    GError *error = NULL;
+
+    GVariant *reply = g_dbus_connection_call_sync(
+        connection, "org.mpris.MediaPlayer2.playerctld", MPRIS_PATH, PLAYERCTLD_INTERFACE,
+        "GetStats", NULL, G_VARIANT_TYPE("(a{sv})"), G_DBUS_CALL_FLAGS_NO_AUTO_START, timeout_arg,
+        NULL, &error);
+    g_object_unref(connection);
+    if (error != NULL) {
+        g_printerr("Cannot get stats: %s\n", error->message);
+        return 1;
+    }
+
+    GVariant *stats = g_variant_get_child_value(reply, 0);
+    print_stats("", stats);
+    g_variant_unref(stats);
+    g_variant_unref(reply);
+    return 0;
+}
+
 enum activation_result {
     ACTIVATION_FAIL = 0,
     ACTIVATION_NOT_SUPPORTED,
@@ -1290,6 +3101,131 @@ enum activation_result start_playerctld_dbus_activation(GDBusConnection *connect
     }
 }
 
+/*
+ * Adds the players on the bus with all of their properties.
+ */
+static gboolean context_add_players_sync(struct PlayerctldContext *ctx) {
+    GError *error = NULL;
+
+    // Get all names of players (names that start with "org.mpris.MediaPlayer2.")
+    // then fetch their properties on all supported interfaces
+    GVariant *names_reply = g_dbus_connection_call_sync(
+        ctx->connection, DBUS_NAME, DBUS_PATH, DBUS_INTERFACE, "ListNames", NULL, NULL,
+        G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
+    if (error != NULL) {
+        g_warning("could not call ListNames: %s", error->message);
+        return FALSE;
+    }
+    GVariant *names_reply_value = g_variant_get_child_value(names_reply, 0);
+    gsize nnames;
+    const gchar **names = g_variant_get_strv(names_reply_value, &nnames);
+    for (int i = 0; i < nnames; ++i) {
+        if (well_known_name_is_managed(names[i])) {
+            // org.mpris.MediaPlayer2.Player properties
+            GVariant *owner_reply =
+                g_dbus_connection_call_sync(ctx->connection, DBUS_NAME, DBUS_PATH, DBUS_INTERFACE,
+                                            "GetNameOwner", g_variant_new("(s)", names[i]), NULL,
+                                            G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
+            if (error != NULL) {
+                g_warning("could not get owner for name %s: %s", names[i], error->message);
+                g_clear_error(&error);
+                continue;
+            }
+
+            GVariant *owner_reply_value = g_variant_get_child_value(owner_reply, 0);
+            const gchar *owner = g_variant_get_string(owner_reply_value, 0);
+
+            struct Player *player = player_new(owner, names[i]);
+
+            GVariant *reply = g_dbus_connection_call_sync(
+                ctx->connection, player->unique, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
+                g_variant_new("(s)", PLAYER_INTERFACE), NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                ctx->call_timeout, NULL, &error);
+            if (error != NULL) {
+                // This interface is mandatory, get rid of "players" who don't support it
+                g_warning("could not get player properties for player: %s", player->well_known);
+                player_free(player);
+                g_clear_error(&error);
+                continue;
+            }
+
+            GVariant *properties = g_variant_get_child_value(reply, 0);
+            history_record_player_changes(ctx, player, properties);
+            player_update_properties(player, PLAYER_INTERFACE, properties);
+            g_variant_unref(properties);
+            g_variant_unref(reply);
+
+            // org.mpris.MediaPlayer2 properties
+            reply = g_dbus_connection_call_sync(ctx->connection, player->unique, MPRIS_PATH,
+                                                PROPERTIES_INTERFACE, "GetAll",
+                                                g_variant_new("(s)", ROOT_INTERFACE), NULL,
+                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout,
+                                                NULL, &error);
+            if (error != NULL) {
+                // This interface is mandatory, get rid of "players" who don't support it
+                g_warning("could not get root properties for player: %s", player->well_known);
+                player_free(player);
+                g_clear_error(&error);
+                continue;
+            }
+
+            properties = g_variant_get_child_value(reply, 0);
+            player_update_properties(player, ROOT_INTERFACE, properties);
+            g_variant_unref(properties);
+            g_variant_unref(reply);
+
+            // org.mpris.MediaPlayer2.TrackList properties
+            player->tracklist.supported = true;  // Or so we hope
+            reply = g_dbus_connection_call_sync(ctx->connection, player->unique, MPRIS_PATH,
+                                                PROPERTIES_INTERFACE, "GetAll",
+                                                g_variant_new("(s)", TRACKLIST_INTERFACE), NULL,
+                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout,
+                                                NULL, &error);
+            if (error != NULL) {
+                // This interface is optional, so we can keep the player around
+                player->tracklist.supported = false;
+                g_warning("could not get tracklist properties for player: %s", player->well_known);
+                g_clear_error(&error);
+            } else {
+                properties = g_variant_get_child_value(reply, 0);
+                player_update_properties(player, TRACKLIST_INTERFACE, properties);
+                g_variant_unref(properties);
+                g_variant_unref(reply);
+            }
+
+            // org.mpris.MediaPlayer2.Playlists properties
+            player->playlists.supported = true;  // Or so we hope
+            reply = g_dbus_connection_call_sync(ctx->connection, player->unique, MPRIS_PATH,
+                                                PROPERTIES_INTERFACE, "GetAll",
+                                                g_variant_new("(s)", PLAYLISTS_INTERFACE), NULL,
+                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, ctx->call_timeout,
+                                                NULL, &error);
+            if (error != NULL) {
+                // This interface is optional, so we can keep the player around
+                player->playlists.supported = false;
+                g_warning("could not get playlists properties for player: %s", player->well_known);
+                g_clear_error(&error);
+            } else {
+                properties = g_variant_get_child_value(reply, 0);
+                player_update_properties(player, PLAYLISTS_INTERFACE, properties);
+                g_variant_unref(properties);
+                g_variant_unref(reply);
+            }
+
+            g_debug("found player: %s", player->well_known);
+            g_queue_push_head(ctx->players, player);
+            g_variant_unref(owner_reply_value);
+            g_variant_unref(owner_reply);
+        }
+    }
+
+    g_free(names);
+    g_variant_unref(names_reply_value);
+    g_variant_unref(names_reply);
+
+    return TRUE;
+}
+
 int main(int argc, char *argv[]) {
     struct PlayerctldContext ctx = {0};
     GError *error = NULL;
@@ -1299,6 +3235,13 @@ int main(int argc, char *argv[]) {
         g_clear_error(&error);
         exit(0);
     }
+    ctx.call_timeout = timeout_arg;
+    ctx.coalesce_window = MAX(coalesce_window_arg, 0);
+    if (!context_init_policy(&ctx, &error)) {
+        g_printerr("%s\n", error->message);
+        g_clear_error(&error);
+        return 1;
+    }
 
     // Setup DBus connection
     GDBusConnectionFlags connection_flags = G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
@@ -1356,10 +3299,25 @@ int main(int argc, char *argv[]) {
         return playercmd_unshift(ctx.connection);
     }
 
+    if (command_arg && g_strcmp0(command_arg[0], "stats") == 0) {
+        return playercmd_stats(ctx.connection);
+    }
+
     GDBusNodeInfo *mpris_introspection_data = NULL;
     GDBusNodeInfo *playerctld_introspection_data = NULL;
     ctx.players = g_queue_new();
     ctx.pending_players = g_queue_new();
+
+    int history_fd = -1;
+    if (history_file_arg != NULL) {
+        history_fd = open(history_file_arg, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+        if (history_fd < 0) {
+            g_printerr("could not open history file %s: %s\n", history_file_arg,
+                       g_strerror(errno));
+            return 1;
+        }
+    }
+    ctx.history = history_new(history_fd);
     ctx.loop = g_main_loop_new(NULL, FALSE);
 
     // Load introspection data and split into separate interfaces
@@ -1398,117 +3356,13 @@ int main(int argc, char *argv[]) {
     ctx.playerctld_interface_info = g_dbus_node_info_lookup_interface(
         playerctld_introspection_data, "com.github.altdesktop.playerctld");
 
-    // Get all names of players (names that start with "org.mpris.MediaPlayer2.")
-    // then fetch their properties on all supported interfaces
-    GVariant *names_reply = g_dbus_connection_call_sync(
-        ctx.connection, DBUS_NAME, DBUS_PATH, DBUS_INTERFACE, "ListNames", NULL, NULL,
-        G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
-    if (error != NULL) {
-        g_warning("could not call ListNames: %s", error->message);
+    ctx.state.path = g_strdup(state_file_arg);
+    if (context_load_state(&ctx)) {
+        // serve the restored players right away and check them against the bus after
+        context_reconcile_state_async(&ctx);
+    } else if (!context_add_players_sync(&ctx)) {
         return 1;
     }
-    GVariant *names_reply_value = g_variant_get_child_value(names_reply, 0);
-    gsize nnames;
-    const gchar **names = g_variant_get_strv(names_reply_value, &nnames);
-    for (int i = 0; i < nnames; ++i) {
-        if (well_known_name_is_managed(names[i])) {
-            // org.mpris.MediaPlayer2.Player properties
-            GVariant *owner_reply =
-                g_dbus_connection_call_sync(ctx.connection, DBUS_NAME, DBUS_PATH, DBUS_INTERFACE,
-                                            "GetNameOwner", g_variant_new("(s)", names[i]), NULL,
-                                            G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
-            if (error != NULL) {
-                g_warning("could not get owner for name %s: %s", names[i], error->message);
-                g_clear_error(&error);
-                continue;
-            }
-
-            GVariant *owner_reply_value = g_variant_get_child_value(owner_reply, 0);
-            const gchar *owner = g_variant_get_string(owner_reply_value, 0);
-
-            struct Player *player = player_new(owner, names[i]);
-
-            GVariant *reply = g_dbus_connection_call_sync(
-                ctx.connection, player->unique, MPRIS_PATH, PROPERTIES_INTERFACE, "GetAll",
-                g_variant_new("(s)", PLAYER_INTERFACE), NULL, G_DBUS_CALL_FLAGS_NO_AUTO_START, -1,
-                NULL, &error);
-            if (error != NULL) {
-                // This interface is mandatory, get rid of "players" who don't support it
-                g_warning("could not get player properties for player: %s", player->well_known);
-                player_free(player);
-                g_clear_error(&error);
-                continue;
-            }
-
-            GVariant *properties = g_variant_get_child_value(reply, 0);
-            player_update_properties(player, PLAYER_INTERFACE, properties);
-            g_variant_unref(properties);
-            g_variant_unref(reply);
-
-            // org.mpris.MediaPlayer2 properties
-            reply = g_dbus_connection_call_sync(ctx.connection, player->unique, MPRIS_PATH,
-                                                PROPERTIES_INTERFACE, "GetAll",
-                                                g_variant_new("(s)", ROOT_INTERFACE), NULL,
-                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
-            if (error != NULL) {
-                // This interface is mandatory, get rid of "players" who don't support it
-                g_warning("could not get root properties for player: %s", player->well_known);
-                player_free(player);
-                g_clear_error(&error);
-                continue;
-            }
-
-            properties = g_variant_get_child_value(reply, 0);
-            player_update_properties(player, ROOT_INTERFACE, properties);
-            g_variant_unref(properties);
-            g_variant_unref(reply);
-
-            // org.mpris.MediaPlayer2.TrackList properties
-            player->tracklist.supported = true;  // Or so we hope
-            reply = g_dbus_connection_call_sync(ctx.connection, player->unique, MPRIS_PATH,
-                                                PROPERTIES_INTERFACE, "GetAll",
-                                                g_variant_new("(s)", TRACKLIST_INTERFACE), NULL,
-                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
-            if (error != NULL) {
-                // This interface is optional, so we can keep the player around
-                player->tracklist.supported = false;
-                g_warning("could not get tracklist properties for player: %s", player->well_known);
-                g_clear_error(&error);
-            } else {
-                properties = g_variant_get_child_value(reply, 0);
-                player_update_properties(player, TRACKLIST_INTERFACE, properties);
-                g_variant_unref(properties);
-                g_variant_unref(reply);
-            }
-
-            // org.mpris.MediaPlayer2.Playlists properties
-            player->playlists.supported = true;  // Or so we hope
-            reply = g_dbus_connection_call_sync(ctx.connection, player->unique, MPRIS_PATH,
-                                                PROPERTIES_INTERFACE, "GetAll",
-                                                g_variant_new("(s)", PLAYLISTS_INTERFACE), NULL,
-                                                G_DBUS_CALL_FLAGS_NO_AUTO_START, -1, NULL, &error);
-            if (error != NULL) {
-                // This interface is optional, so we can keep the player around
-                player->playlists.supported = false;
-                g_warning("could not get playlists properties for player: %s", player->well_known);
-                g_clear_error(&error);
-            } else {
-                properties = g_variant_get_child_value(reply, 0);
-                player_update_properties(player, PLAYLISTS_INTERFACE, properties);
-                g_variant_unref(properties);
-                g_variant_unref(reply);
-            }
-
-            g_debug("found player: %s", player->well_known);
-            g_queue_push_head(ctx.players, player);
-            g_variant_unref(owner_reply_value);
-            g_variant_unref(owner_reply);
-        }
-    }
-
-    g_free(names);
-    g_variant_unref(names_reply_value);
-    g_variant_unref(names_reply);
 
     g_dbus_connection_signal_subscribe(
         ctx.connection, DBUS_NAME, DBUS_INTERFACE, "NameOwnerChanged", DBUS_PATH, NULL,
@@ -1518,16 +3372,39 @@ int main(int argc, char *argv[]) {
                                        G_DBUS_SIGNAL_FLAGS_NONE, player_signal_proxy_callback, &ctx,
                                        NULL);
 
+    if (socket_arg && !events_listen(&ctx, &error)) {
+        g_printerr("could not open the event socket: %s\n", error->message);
+        g_clear_error(&error);
+        return 1;
+    }
+    if (socket_arg || ctx.state.path != NULL) {
+        // quit the loop on the usual signals so the socket is removed and the state is saved
+        g_unix_signal_add(SIGINT, quit_signal_callback, &ctx);
+        g_unix_signal_add(SIGTERM, quit_signal_callback, &ctx);
+    }
+
     ctx.bus_id = g_bus_own_name_on_connection(ctx.connection, "org.mpris.MediaPlayer2.playerctld",
                                               G_BUS_NAME_OWNER_FLAGS_DO_NOT_QUEUE, on_bus_acquired,
                                               on_name_lost, &ctx, NULL);
 
     g_main_loop_run(ctx.loop);
+    events_close(&ctx);
+    if (ctx.state.path != NULL) {
+        if (ctx.state.save_source_id != 0) {
+            g_source_remove(ctx.state.save_source_id);
+        }
+        context_save_state(&ctx);
+        g_free(ctx.state.path);
+    }
     g_bus_unown_name(ctx.bus_id);
     g_main_loop_unref(ctx.loop);
     g_dbus_node_info_unref(mpris_introspection_data);
     g_dbus_node_info_unref(playerctld_introspection_data);
     g_queue_free_full(ctx.players, (GDestroyNotify)player_free);
+    history_free(ctx.history);
+    if (ctx.priorities != NULL) {
+        g_hash_table_unref(ctx.priorities);
+    }
     g_object_unref(ctx.connection);
     g_free(ctx.bus_address);
 
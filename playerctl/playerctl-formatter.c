@@ -5,8 +5,11 @@
 #include <inttypes.h>
 #include <playerctl/playerctl-player.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "playerctl/playerctl-common.h"
+#include "playerctl/playerctl-metadata.h"
+#include "playerctl/playerctl-trace.h"
 
 #define LENGTH(array) (sizeof array / sizeof array[0])
 
@@ -28,11 +31,17 @@ enum token_type {
     TOKEN_NUMBER,
 };
 
+/*
+ * A token tree and its strings are allocated from an arena that is owned by
+ * the formatter, so a formatter is freed all at once.
+ */
 struct token {
     enum token_type type;
-    gchar *data;
+    // interned in the arena
+    const gchar *data;
     gdouble numeric_data;
-    GList *args;
+    struct token **args;
+    guint nargs;
 };
 
 enum parser_state {
@@ -48,44 +57,105 @@ enum parse_level {
     PARSE_MULT_DIV,
 };
 
-struct _PlayerctlFormatterPrivate {
-    GList *tokens;
+/* Room for the tokens of a typical template, which then fit in one block */
+#define ARENA_BLOCK_SIZE 2048
+#define ARENA_ALIGNMENT MAX(sizeof(gdouble), sizeof(gpointer))
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+struct arena_block {
+    struct arena_block *next;
+    gsize size;
+    gsize used;
 };
 
-static struct token *token_create(enum token_type type) {
-    struct token *token = calloc(1, sizeof(struct token));
-    token->type = type;
-    return token;
-}
+#define ARENA_BLOCK_HEADER_SIZE ARENA_ROUND(sizeof(struct arena_block))
 
-static void token_list_destroy(GList *tokens);
+/* A string in the arena, which is kept in a list so equal strings are stored once */
+struct arena_string {
+    struct arena_string *next;
+    gchar str[];
+};
 
-static void token_destroy(struct token *token) {
-    if (token == NULL) {
-        return;
+struct arena {
+    struct arena_block *blocks;
+    struct arena_string *strings;
+};
+
+struct _PlayerctlFormatterPrivate {
+    struct arena arena;
+    struct token **tokens;
+    guint n_tokens;
+    // the distinct variable names in the template, NULL terminated
+    const gchar **variables;
+};
+
+/* Returns zeroed memory that lives until the arena is cleared */
+static gpointer arena_alloc(struct arena *arena, gsize size) {
+    struct arena_block *block = arena->blocks;
+
+    size = ARENA_ROUND(size);
+    if (block == NULL || block->size - block->used < size) {
+        gsize block_size = MAX(ARENA_BLOCK_SIZE, size);
+        block = g_malloc0(ARENA_BLOCK_HEADER_SIZE + block_size);
+        block->size = block_size;
+        block->next = arena->blocks;
+        arena->blocks = block;
     }
 
-    token_list_destroy(token->args);
-    g_free(token->data);
-    free(token);
+    gpointer memory = (guint8 *)block + ARENA_BLOCK_HEADER_SIZE + block->used;
+    block->used += size;
+    return memory;
 }
 
-static void token_list_destroy(GList *tokens) {
-    if (tokens == NULL) {
-        return;
+static void arena_clear(struct arena *arena) {
+    struct arena_block *block = arena->blocks;
+    while (block != NULL) {
+        struct arena_block *next = block->next;
+        g_free(block);
+        block = next;
     }
-
-    g_list_free_full(tokens, (GDestroyNotify)token_destroy);
+    arena->blocks = NULL;
+    arena->strings = NULL;
 }
 
-static gboolean token_list_contains_key(GList *tokens, const gchar *key) {
-    if (tokens == NULL) {
-        return FALSE;
+/*
+ * Returns the copy of the string in the arena. A template has few distinct
+ * strings, so they are found by a scan rather than a hash table.
+ */
+static const gchar *arena_intern(struct arena *arena, const gchar *str) {
+    struct arena_string *string;
+
+    for (string = arena->strings; string != NULL; string = string->next) {
+        if (strcmp(string->str, str) == 0) {
+            return string->str;
+        }
     }
 
-    GList *t = NULL;
-    for (t = tokens; t != NULL; t = t->next) {
-        struct token *token = t->data;
+    gsize len = strlen(str);
+    string = arena_alloc(arena, sizeof(struct arena_string) + len + 1);
+    memcpy(string->str, str, len + 1);
+    string->next = arena->strings;
+    arena->strings = string;
+    return string->str;
+}
+
+static struct token *token_create(struct arena *arena, enum token_type type) {
+    struct token *token = arena_alloc(arena, sizeof(struct token));
+    token->type = type;
+    return token;
+}
+
+/* Copies the args into the arena as the args of the token */
+static void token_set_args(struct arena *arena, struct token *token, struct token **args,
+                           guint nargs) {
+    token->args = arena_alloc(arena, nargs * sizeof(struct token *));
+    memcpy(token->args, args, nargs * sizeof(struct token *));
+    token->nargs = nargs;
+}
+
+static gboolean token_list_contains_key(struct token **tokens, guint n_tokens, const gchar *key) {
+    for (guint i = 0; i < n_tokens; ++i) {
+        struct token *token = tokens[i];
         switch (token->type) {
         case TOKEN_VARIABLE:
             if (g_strcmp0(token->data, key) == 0) {
@@ -93,7 +163,7 @@ static gboolean token_list_contains_key(GList *tokens, const gchar *key) {
             }
             break;
         case TOKEN_FUNCTION:
-            if (token_list_contains_key(token->args, key)) {
+            if (token_list_contains_key(token->args, token->nargs, key)) {
                 return TRUE;
             }
         default:
@@ -103,6 +173,34 @@ static gboolean token_list_contains_key(GList *tokens, const gchar *key) {
     return FALSE;
 }
 
+/* The names are interned, so equal names are the same pointer */
+static void token_list_collect_variables(struct token **tokens, guint n_tokens,
+                                         GPtrArray *variables) {
+    for (guint i = 0; i < n_tokens; ++i) {
+        struct token *token = tokens[i];
+        switch (token->type) {
+        case TOKEN_VARIABLE: {
+            gboolean found = FALSE;
+            for (guint j = 0; j < variables->len; ++j) {
+                if (g_ptr_array_index(variables, j) == token->data) {
+                    found = TRUE;
+                    break;
+                }
+            }
+            if (!found) {
+                g_ptr_array_add(variables, (gpointer)token->data);
+            }
+            break;
+        }
+        case TOKEN_FUNCTION:
+            token_list_collect_variables(token->args, token->nargs, variables);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static gboolean is_identifier_start_char(gchar c) {
     return g_ascii_isalpha(c) || c == '_';
 }
@@ -115,25 +213,39 @@ static gboolean is_numeric_char(gchar c) {
     return g_ascii_isdigit(c) || c == '.';
 }
 
-static gchar *infix_to_identifier(gchar infix) {
+static const gchar *infix_to_identifier(gchar infix) {
     switch (infix) {
     case '+':
-        return g_strdup(INFIX_ADD);
+        return INFIX_ADD;
     case '-':
-        return g_strdup(INFIX_SUB);
+        return INFIX_SUB;
     case '*':
-        return g_strdup(INFIX_MUL);
+        return INFIX_MUL;
     case '/':
-        return g_strdup(INFIX_DIV);
+        return INFIX_DIV;
     default:
         assert(false && "not reached");
     }
 }
 
-static struct token *tokenize_expression(const gchar *format, gint pos, gint *end,
-                                         enum parse_level level, GError **error) {
+/* The token for the infix operation on the left and right operands */
+static struct token *token_operation_create(struct arena *arena, gchar infix, struct token *left,
+                                            struct token *right) {
+    struct token *args[] = {left, right};
+    struct token *operation = token_create(arena, TOKEN_FUNCTION);
+    operation->data = infix_to_identifier(infix);
+    token_set_args(arena, operation, args, G_N_ELEMENTS(args));
+    return operation;
+}
+
+/*
+ * The tokens are allocated from the arena, so on errors they are left for the
+ * caller to free with the arena.
+ */
+static struct token *tokenize_expression(struct arena *arena, const gchar *format, gint len,
+                                         gint pos, gint *end, enum parse_level level,
+                                         GError **error) {
     GError *tmp_error = NULL;
-    int len = strlen(format);
     char buf[1028];
     int buf_len = 0;
     struct token *tok = NULL;
@@ -152,7 +264,7 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
                 continue;
             } else if (format[i] == '(') {
                 // ordering parens
-                tok = tokenize_expression(format, i + 1, end, PARSE_FULL, &tmp_error);
+                tok = tokenize_expression(arena, format, len, i + 1, end, PARSE_FULL, &tmp_error);
                 if (tmp_error != NULL) {
                     g_propagate_error(error, tmp_error);
                     return NULL;
@@ -161,7 +273,6 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
                 if (*end > len - 1 || format[*end] != ')') {
                     g_set_error(error, playerctl_formatter_error_quark(), 1,
                                 "expected \")\" (position  %d)", *end);
-                    token_destroy(tok);
                     return NULL;
                 }
                 *end += 1;
@@ -169,15 +280,15 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
                 goto loop_out;
             } else if (format[i] == '+' || format[i] == '-') {
                 // unary + or -
-                struct token *operand =
-                    tokenize_expression(format, i + 1, end, PARSE_NEXT_IDENT, &tmp_error);
+                struct token *operand = tokenize_expression(arena, format, len, i + 1, end,
+                                                            PARSE_NEXT_IDENT, &tmp_error);
                 if (tmp_error != NULL) {
                     g_propagate_error(error, tmp_error);
                     return NULL;
                 }
-                tok = token_create(TOKEN_FUNCTION);
+                tok = token_create(arena, TOKEN_FUNCTION);
                 tok->data = infix_to_identifier(format[i]);
-                tok->args = g_list_append(tok->args, operand);
+                token_set_args(arena, tok, &operand, 1);
                 goto loop_out;
             } else if (format[i] == '"') {
                 state = STATE_STRING;
@@ -199,9 +310,9 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
 
         case STATE_STRING:
             if (format[i] == '"') {
-                tok = token_create(TOKEN_STRING);
+                tok = token_create(arena, TOKEN_STRING);
                 buf[buf_len] = '\0';
-                tok->data = g_strdup(buf);
+                tok->data = arena_intern(arena, buf);
 
                 i++;
                 while (i < len && format[i] == ' ') {
@@ -217,15 +328,14 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
 
         case STATE_NUMBER:
             if (!is_numeric_char(format[i]) || i == len - 2) {
-                tok = token_create(TOKEN_NUMBER);
+                tok = token_create(arena, TOKEN_NUMBER);
                 buf[buf_len] = '\0';
-                tok->data = g_strdup(buf);
+                tok->data = arena_intern(arena, buf);
                 char *endptr = NULL;
                 gdouble number = strtod(tok->data, &endptr);
                 if (endptr == NULL || *endptr != '\0') {
                     g_set_error(error, playerctl_formatter_error_quark(), 1,
                                 "invalid number: \"%s\" (position %d)", tok->data, i);
-                    token_destroy(tok);
                     return NULL;
                 }
                 tok->numeric_data = number;
@@ -242,29 +352,27 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
 
         case STATE_IDENTIFIER:
             if (format[i] == '(') {
-                tok = token_create(TOKEN_FUNCTION);
+                tok = token_create(arena, TOKEN_FUNCTION);
                 buf[buf_len] = '\0';
-                tok->data = g_strdup(buf);
+                tok->data = arena_intern(arena, buf);
                 i += 1;
                 // printf("function: '%s'\n", tok->data);
 
+                // the args are collected here and then copied to the arena at once
+                struct token *args[MAX_ARGS + 1];
                 int nargs = 0;
                 while (TRUE) {
-                    tok->args = g_list_append(
-                        tok->args, tokenize_expression(format, i, end, PARSE_FULL, &tmp_error));
+                    args[nargs++] =
+                        tokenize_expression(arena, format, len, i, end, PARSE_FULL, &tmp_error);
 
-                    nargs++;
+                    if (tmp_error != NULL) {
+                        g_propagate_error(error, tmp_error);
+                        return NULL;
+                    }
 
                     if (nargs > MAX_ARGS) {
                         g_set_error(error, playerctl_formatter_error_quark(), 1,
                                     "maximum args of %d exceeded", MAX_ARGS);
-                        token_destroy(tok);
-                        return NULL;
-                    }
-
-                    if (tmp_error != NULL) {
-                        token_destroy(tok);
-                        g_propagate_error(error, tmp_error);
                         return NULL;
                     }
 
@@ -281,15 +389,15 @@ static struct token *tokenize_expression(const gchar *format, gint pos, gint *en
                     } else {
                         g_set_error(error, playerctl_formatter_error_quark(), 1,
                                     "expecting \")\" (position %d)", *end);
-                        token_destroy(tok);
                         return NULL;
                     }
                 }
+                token_set_args(arena, tok, args, nargs);
                 goto loop_out;
             } else if (!is_identifier_char(format[i])) {
-                tok = token_create(TOKEN_VARIABLE);
+                tok = token_create(arena, TOKEN_VARIABLE);
                 buf[buf_len] = '\0';
-                tok->data = g_strdup(buf);
+                tok->data = arena_intern(arena, buf);
                 while (i < len && format[i] == ' ') {
                     i++;
                 }
@@ -320,20 +428,14 @@ loop_out:
     gchar infix_id = format[*end];
     while (infix_id == '*' || infix_id == '/' || infix_id == '+' || infix_id == '-') {
         while (infix_id == '*' || infix_id == '/') {
-            struct token *operand =
-                tokenize_expression(format, *end + 1, end, PARSE_NEXT_IDENT, &tmp_error);
+            struct token *operand = tokenize_expression(arena, format, len, *end + 1, end,
+                                                        PARSE_NEXT_IDENT, &tmp_error);
             if (tmp_error != NULL) {
-                token_destroy(tok);
                 g_propagate_error(error, tmp_error);
                 return NULL;
             }
 
-            struct token *operation = token_create(TOKEN_FUNCTION);
-            operation->data = infix_to_identifier(infix_id);
-            operation->args = g_list_append(operation->args, tok);
-            operation->args = g_list_append(operation->args, operand);
-
-            tok = operation;
+            tok = token_operation_create(arena, infix_id, tok, operand);
             infix_id = format[*end];
         }
 
@@ -342,20 +444,14 @@ loop_out:
         }
 
         if (infix_id == '+' || infix_id == '-') {
-            struct token *operand =
-                tokenize_expression(format, *end + 1, end, PARSE_MULT_DIV, &tmp_error);
+            struct token *operand = tokenize_expression(arena, format, len, *end + 1, end,
+                                                        PARSE_MULT_DIV, &tmp_error);
             if (tmp_error != NULL) {
-                token_destroy(tok);
                 g_propagate_error(error, tmp_error);
                 return NULL;
             }
 
-            struct token *operation = token_create(TOKEN_FUNCTION);
-            operation->data = infix_to_identifier(infix_id);
-            operation->args = g_list_append(operation->args, tok);
-            operation->args = g_list_append(operation->args, operand);
-
-            tok = operation;
+            tok = token_operation_create(arena, infix_id, tok, operand);
             infix_id = format[*end];
         }
     }
@@ -363,12 +459,13 @@ loop_out:
     return tok;
 }
 
-static GList *tokenize_format(const char *format, GError **error) {
+/* Appends the tokens of the format to the array. They are allocated from the arena. */
+static gboolean tokenize_format(struct arena *arena, const char *format, GPtrArray *tokens,
+                                GError **error) {
     GError *tmp_error = NULL;
-    GList *tokens = NULL;
 
     if (format == NULL) {
-        return NULL;
+        return TRUE;
     }
 
     int len = strlen(format);
@@ -378,7 +475,7 @@ static GList *tokenize_format(const char *format, GError **error) {
     if (len >= 1028) {
         g_set_error(error, playerctl_formatter_error_quark(), 1,
                     "the maximum format string length is 1028");
-        return NULL;
+        return FALSE;
     }
 
     for (int i = 0; i < len; ++i) {
@@ -386,21 +483,21 @@ static GList *tokenize_format(const char *format, GError **error) {
             if (buf_len > 0) {
                 buf[buf_len] = '\0';
                 buf_len = 0;
-                struct token *token = token_create(TOKEN_STRING);
-                token->data = g_strdup(buf);
+                struct token *token = token_create(arena, TOKEN_STRING);
+                token->data = arena_intern(arena, buf);
                 // printf("passthrough: '%s'\n", token->data);
-                tokens = g_list_append(tokens, token);
+                g_ptr_array_add(tokens, token);
             }
 
             i += 2;
             int end = 0;
-            struct token *token = tokenize_expression(format, i, &end, PARSE_FULL, &tmp_error);
+            struct token *token =
+                tokenize_expression(arena, format, len, i, &end, PARSE_FULL, &tmp_error);
             if (tmp_error != NULL) {
-                token_list_destroy(tokens);
                 g_propagate_error(error, tmp_error);
-                return NULL;
+                return FALSE;
             }
-            tokens = g_list_append(tokens, token);
+            g_ptr_array_add(tokens, token);
             i = end;
 
             while (i < len && format[i] == ' ') {
@@ -408,10 +505,9 @@ static GList *tokenize_format(const char *format, GError **error) {
             }
 
             if (i >= len || format[i] != '}' || format[i + 1] != '}') {
-                token_list_destroy(tokens);
                 g_set_error(error, playerctl_formatter_error_quark(), 1,
                             "expecting \"}}\" (position %d)", i);
-                return NULL;
+                return FALSE;
             }
             i += 1;
 
@@ -422,12 +518,12 @@ static GList *tokenize_format(const char *format, GError **error) {
 
     if (buf_len > 0) {
         buf[buf_len] = '\0';
-        struct token *token = token_create(TOKEN_STRING);
-        token->data = g_strdup(buf);
-        tokens = g_list_append(tokens, token);
+        struct token *token = token_create(arena, TOKEN_STRING);
+        token->data = arena_intern(arena, buf);
+        g_ptr_array_add(tokens, token);
     }
 
-    return tokens;
+    return TRUE;
 }
 
 static GVariant *helperfn_lc(struct token *token, GVariant **args, int nargs, GError **error) {
@@ -580,7 +676,7 @@ static GVariant *helperfn_emoji(struct token *token, GVariant **args, int nargs,
         return g_variant_new("s", "");
     }
 
-    struct token *arg_token = g_list_first(token->args)->data;
+    struct token *arg_token = token->args[0];
 
     if (arg_token->type != TOKEN_VARIABLE) {
         g_set_error(error, playerctl_formatter_error_quark(), 1,
@@ -588,7 +684,7 @@ static GVariant *helperfn_emoji(struct token *token, GVariant **args, int nargs,
         return NULL;
     }
 
-    gchar *key = arg_token->data;
+    const gchar *key = arg_token->data;
 
     if (g_strcmp0(key, "status") == 0 && g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
         const gchar *status_str = g_variant_get_string(value, NULL);
@@ -911,17 +1007,15 @@ static GVariant *expand_token(struct token *token, GVariantDict *context, GError
 
     case TOKEN_FUNCTION: {
         // TODO lift required arg assumption
-        assert(token->args != NULL);
+        assert(token->nargs > 0);
 
         GVariant *ret = NULL;
         int nargs = 0;
         GVariant *args[MAX_ARGS + 1];
 
-        GList *t;
-        for (t = token->args; t != NULL; t = t->next) {
-            struct token *arg_token = t->data;
+        for (guint i = 0; i < token->nargs; ++i) {
             assert(nargs < MAX_ARGS);
-            args[nargs++] = expand_token(arg_token, context, &tmp_error);
+            args[nargs++] = expand_token(token->args[i], context, &tmp_error);
             if (tmp_error != NULL) {
                 g_propagate_error(error, tmp_error);
                 goto func_out;
@@ -955,16 +1049,17 @@ static GVariant *expand_token(struct token *token, GVariantDict *context, GError
     return NULL;
 }
 
-static gchar *expand_format(GList *tokens, GVariantDict *context, GError **error) {
+static gchar *expand_format(struct token **tokens, guint n_tokens, GVariantDict *context,
+                            gsize *length, GError **error) {
     GError *tmp_error = NULL;
     GString *expanded;
 
     expanded = g_string_new("");
-    GList *t = tokens;
-    for (t = tokens; t != NULL; t = t->next) {
-        GVariant *value = expand_token(t->data, context, &tmp_error);
+    for (guint i = 0; i < n_tokens; ++i) {
+        GVariant *value = expand_token(tokens[i], context, &tmp_error);
         if (tmp_error != NULL) {
             g_propagate_error(error, tmp_error);
+            g_string_free(expanded, TRUE);
             return NULL;
         }
 
@@ -975,91 +1070,121 @@ static gchar *expand_format(GList *tokens, GVariantDict *context, GError **error
             g_variant_unref(value);
         }
     }
+    *length = expanded->len;
     return g_string_free(expanded, FALSE);
 }
 
-static GVariantDict *get_default_template_context(PlayerctlPlayer *player, GVariant *base) {
-    GVariantDict *context = g_variant_dict_new(base);
-    if (!g_variant_dict_contains(context, "artist") &&
-        g_variant_dict_contains(context, "xesam:artist")) {
-        GVariant *artist = g_variant_dict_lookup_value(context, "xesam:artist", NULL);
-        g_variant_dict_insert_value(context, "artist", artist);
-        g_variant_unref(artist);
-    }
-    if (!g_variant_dict_contains(context, "album") &&
-        g_variant_dict_contains(context, "xesam:album")) {
-        GVariant *album = g_variant_dict_lookup_value(context, "xesam:album", NULL);
-        g_variant_dict_insert_value(context, "album", album);
-        g_variant_unref(album);
-    }
-    if (!g_variant_dict_contains(context, "title") &&
-        g_variant_dict_contains(context, "xesam:title")) {
-        GVariant *title = g_variant_dict_lookup_value(context, "xesam:title", NULL);
-        g_variant_dict_insert_value(context, "title", title);
-        g_variant_unref(title);
-    }
-    if (!g_variant_dict_contains(context, "playerName")) {
+static GVariant *get_default_template_value(PlayerctlPlayer *player,
+                                           struct pctl_metadata *metadata, const gchar *key) {
+    if (metadata != NULL) {
+        GVariant *value = pctl_metadata_lookup(metadata, key);
+        if (value == NULL) {
+            if (g_strcmp0(key, "artist") == 0) {
+                value = pctl_metadata_get_field(metadata, PCTL_METADATA_ARTIST);
+            } else if (g_strcmp0(key, "album") == 0) {
+                value = pctl_metadata_get_field(metadata, PCTL_METADATA_ALBUM);
+            } else if (g_strcmp0(key, "title") == 0) {
+                value = pctl_metadata_get_field(metadata, PCTL_METADATA_TITLE);
+            }
+        }
+        if (value != NULL) {
+            return g_variant_ref(value);
+        }
+    }
+
+    GVariant *value = NULL;
+    if (g_strcmp0(key, "playerName") == 0) {
         gchar *player_name = NULL;
         g_object_get(player, "player-name", &player_name, NULL);
-        GVariant *player_name_variant = g_variant_new_string(player_name);
-        g_variant_dict_insert_value(context, "playerName", player_name_variant);
+        value = g_variant_new_string(player_name);
         g_free(player_name);
-    }
-    if (!g_variant_dict_contains(context, "playerInstance")) {
+    } else if (g_strcmp0(key, "playerInstance") == 0) {
         gchar *instance = NULL;
         g_object_get(player, "player-instance", &instance, NULL);
-        GVariant *player_instance_variant = g_variant_new_string(instance);
-        g_variant_dict_insert_value(context, "playerInstance", player_instance_variant);
+        value = g_variant_new_string(instance);
         g_free(instance);
-    }
-    if (!g_variant_dict_contains(context, "shuffle")) {
+    } else if (g_strcmp0(key, "shuffle") == 0) {
         gboolean shuffle = FALSE;
         g_object_get(player, "shuffle", &shuffle, NULL);
-        GVariant *shuffle_variant = g_variant_new_boolean(shuffle);
-        g_variant_dict_insert_value(context, "shuffle", shuffle_variant);
-    }
-    if (!g_variant_dict_contains(context, "status")) {
+        value = g_variant_new_boolean(shuffle);
+    } else if (g_strcmp0(key, "status") == 0) {
         PlayerctlPlaybackStatus status = 0;
         g_object_get(player, "playback-status", &status, NULL);
-        const gchar *status_str = pctl_playback_status_to_string(status);
-        GVariant *status_variant = g_variant_new_string(status_str);
-        g_variant_dict_insert_value(context, "status", status_variant);
-    }
-    if (!g_variant_dict_contains(context, "loop")) {
+        value = g_variant_new_string(pctl_playback_status_to_string(status));
+    } else if (g_strcmp0(key, "loop") == 0) {
         PlayerctlLoopStatus status = 0;
         g_object_get(player, "loop-status", &status, NULL);
-        const gchar *status_str = pctl_loop_status_to_string(status);
-        GVariant *status_variant = g_variant_new_string(status_str);
-        g_variant_dict_insert_value(context, "loop", status_variant);
-    }
-    if (!g_variant_dict_contains(context, "volume")) {
+        value = g_variant_new_string(pctl_loop_status_to_string(status));
+    } else if (g_strcmp0(key, "volume") == 0) {
         gdouble level = 0.0;
         g_object_get(player, "volume", &level, NULL);
-        GVariant *volume_variant = g_variant_new_double(level);
-        g_variant_dict_insert_value(context, "volume", volume_variant);
-    }
-    if (!g_variant_dict_contains(context, "position")) {
+        value = g_variant_new_double(level);
+    } else if (g_strcmp0(key, "position") == 0) {
         gint64 position = 0;
         g_object_get(player, "position", &position, NULL);
-        GVariant *position_variant = g_variant_new_int64(position);
-        g_variant_dict_insert_value(context, "position", position_variant);
+        value = g_variant_new_int64(position);
+    }
+
+    return value != NULL ? g_variant_ref_sink(value) : NULL;
+}
+
+/*
+ * Only the variables the template refers to are put in the context, so the
+ * cost does not depend on the size of the metadata.
+ */
+static GVariantDict *get_default_template_context(const gchar **variables,
+                                                  PlayerctlPlayer *player,
+                                                  struct pctl_metadata *metadata) {
+    GVariantDict *context = g_variant_dict_new(NULL);
+
+    for (guint i = 0; variables[i] != NULL; ++i) {
+        const gchar *key = variables[i];
+        GVariant *value = get_default_template_value(player, metadata, key);
+        if (value != NULL) {
+            g_variant_dict_insert_value(context, key, value);
+            g_variant_unref(value);
+        }
     }
 
     return context;
 }
 
+/* Copies the pointers in the array into the arena */
+static gpointer arena_copy_pointers(struct arena *arena, GPtrArray *array) {
+    gpointer copy = arena_alloc(arena, array->len * sizeof(gpointer));
+    if (array->len > 0) {
+        memcpy(copy, array->pdata, array->len * sizeof(gpointer));
+    }
+    return copy;
+}
+
 PlayerctlFormatter *playerctl_formatter_new(const gchar *format, GError **error) {
     GError *tmp_error = NULL;
-    GList *tokens = tokenize_format(format, &tmp_error);
-    if (tmp_error != NULL) {
+    struct arena arena = {NULL, NULL};
+    GPtrArray *tokens = g_ptr_array_new();
+
+    if (!tokenize_format(&arena, format, tokens, &tmp_error)) {
         g_propagate_error(error, tmp_error);
+        g_ptr_array_unref(tokens);
+        arena_clear(&arena);
         return NULL;
     }
 
-    PlayerctlFormatter *formatter = calloc(1, sizeof(PlayerctlFormatter));
-    formatter->priv = calloc(1, sizeof(PlayerctlFormatterPrivate));
-    formatter->priv->tokens = tokens;
+    GPtrArray *variables = g_ptr_array_new();
+    token_list_collect_variables((struct token **)tokens->pdata, tokens->len, variables);
+    g_ptr_array_add(variables, NULL);
+
+    // the formatter is kept in its own arena with the tokens
+    PlayerctlFormatter *formatter = arena_alloc(&arena, sizeof(PlayerctlFormatter));
+    PlayerctlFormatterPrivate *priv = arena_alloc(&arena, sizeof(PlayerctlFormatterPrivate));
+    priv->tokens = arena_copy_pointers(&arena, tokens);
+    priv->n_tokens = tokens->len;
+    priv->variables = arena_copy_pointers(&arena, variables);
+    priv->arena = arena;
+    formatter->priv = priv;
 
+    g_ptr_array_unref(variables);
+    g_ptr_array_unref(tokens);
     return formatter;
 }
 
@@ -1068,25 +1193,29 @@ void playerctl_formatter_destroy(PlayerctlFormatter *formatter) {
         return;
     }
 
-    token_list_destroy(formatter->priv->tokens);
-    free(formatter->priv);
-    free(formatter);
+    // the arena is copied out first because the formatter is in it
+    struct arena arena = formatter->priv->arena;
+    arena_clear(&arena);
 }
 
 gboolean playerctl_formatter_contains_key(PlayerctlFormatter *formatter, const gchar *key) {
-    return token_list_contains_key(formatter->priv->tokens, key);
+    return token_list_contains_key(formatter->priv->tokens, formatter->priv->n_tokens, key);
 }
 
 GVariantDict *playerctl_formatter_default_template_context(PlayerctlFormatter *formatter,
                                                            PlayerctlPlayer *player,
-                                                           GVariant *base) {
-    return get_default_template_context(player, base);
+                                                           struct pctl_metadata *metadata) {
+    return get_default_template_context(formatter->priv->variables, player, metadata);
 }
 
 gchar *playerctl_formatter_expand_format(PlayerctlFormatter *formatter, GVariantDict *context,
                                          GError **error) {
     GError *tmp_error = NULL;
-    gchar *expanded = expand_format(formatter->priv->tokens, context, &tmp_error);
+    gsize length = 0;
+    PCTL_TRACE1(format_begin, formatter);
+    gchar *expanded = expand_format(formatter->priv->tokens, formatter->priv->n_tokens, context,
+                                    &length, &tmp_error);
+    PCTL_TRACE2(format_end, formatter, length);
     if (tmp_error != NULL) {
         g_propagate_error(error, tmp_error);
         return NULL;
@@ -23,6 +23,8 @@
 #include <glib.h>
 #include <playerctl/playerctl.h>
 
+#include "playerctl-metadata.h"
+
 typedef struct _PlayerctlFormatter PlayerctlFormatter;
 typedef struct _PlayerctlFormatterPrivate PlayerctlFormatterPrivate;
 
@@ -37,7 +39,8 @@ void playerctl_formatter_destroy(PlayerctlFormatter *formatter);
 gboolean playerctl_formatter_contains_key(PlayerctlFormatter *formatter, const gchar *key);
 
 GVariantDict *playerctl_formatter_default_template_context(PlayerctlFormatter *formatter,
-                                                           PlayerctlPlayer *player, GVariant *base);
+                                                           PlayerctlPlayer *player,
+                                                           struct pctl_metadata *metadata);
 
 gchar *playerctl_formatter_expand_format(PlayerctlFormatter *formatter, GVariantDict *context,
                                          GError **error);
@@ -0,0 +1,273 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#include "playerctl-json.h"
+
+#include <glib.h>
+#include <math.h>
+
+void pctl_json_writer_init(struct pctl_json_writer *writer, GString *buffer) {
+    writer->buffer = buffer;
+    writer->depth = 0;
+    writer->after_key = FALSE;
+}
+
+/* Places the comma before a value in a container */
+static void json_begin_value(struct pctl_json_writer *writer) {
+    if (writer->after_key) {
+        writer->after_key = FALSE;
+        return;
+    }
+
+    if (writer->depth > 0) {
+        if (writer->has_value[writer->depth - 1]) {
+            g_string_append_c(writer->buffer, ',');
+        }
+        writer->has_value[writer->depth - 1] = TRUE;
+    }
+}
+
+/* Appends the string as a quoted JSON string. Runs that need no escaping are copied at once. */
+static void json_append_quoted(GString *buffer, const gchar *value) {
+    const gchar *run = value;
+    const gchar *c = value;
+
+    g_string_append_c(buffer, '"');
+
+    for (; *c != '\0'; ++c) {
+        guchar byte = *c;
+        if (byte >= 0x20 && byte != '"' && byte != '\\') {
+            continue;
+        }
+
+        g_string_append_len(buffer, run, c - run);
+        run = c + 1;
+
+        switch (byte) {
+        case '"':
+            g_string_append(buffer, "\\\"");
+            break;
+        case '\\':
+            g_string_append(buffer, "\\\\");
+            break;
+        case '\n':
+            g_string_append(buffer, "\\n");
+            break;
+        case '\r':
+            g_string_append(buffer, "\\r");
+            break;
+        case '\t':
+            g_string_append(buffer, "\\t");
+            break;
+        default:
+            g_string_append_printf(buffer, "\\u%04x", byte);
+            break;
+        }
+    }
+
+    g_string_append_len(buffer, run, c - run);
+    g_string_append_c(buffer, '"');
+}
+
+void pctl_json_begin_object(struct pctl_json_writer *writer) {
+    g_return_if_fail(writer->depth < PCTL_JSON_MAX_DEPTH);
+    json_begin_value(writer);
+    g_string_append_c(writer->buffer, '{');
+    writer->has_value[writer->depth++] = FALSE;
+}
+
+void pctl_json_end_object(struct pctl_json_writer *writer) {
+    g_return_if_fail(writer->depth > 0);
+    writer->depth--;
+    g_string_append_c(writer->buffer, '}');
+}
+
+void pctl_json_begin_array(struct pctl_json_writer *writer) {
+    g_return_if_fail(writer->depth < PCTL_JSON_MAX_DEPTH);
+    json_begin_value(writer);
+    g_string_append_c(writer->buffer, '[');
+    writer->has_value[writer->depth++] = FALSE;
+}
+
+void pctl_json_end_array(struct pctl_json_writer *writer) {
+    g_return_if_fail(writer->depth > 0);
+    writer->depth--;
+    g_string_append_c(writer->buffer, ']');
+}
+
+void pctl_json_key(struct pctl_json_writer *writer, const gchar *key) {
+    json_begin_value(writer);
+    json_append_quoted(writer->buffer, key);
+    g_string_append_c(writer->buffer, ':');
+    writer->after_key = TRUE;
+}
+
+void pctl_json_string(struct pctl_json_writer *writer, const gchar *value) {
+    if (value == NULL) {
+        pctl_json_null(writer);
+        return;
+    }
+
+    json_begin_value(writer);
+    json_append_quoted(writer->buffer, value);
+}
+
+void pctl_json_int64(struct pctl_json_writer *writer, gint64 value) {
+    json_begin_value(writer);
+    g_string_append_printf(writer->buffer, "%" G_GINT64_FORMAT, value);
+}
+
+void pctl_json_uint64(struct pctl_json_writer *writer, guint64 value) {
+    json_begin_value(writer);
+    g_string_append_printf(writer->buffer, "%" G_GUINT64_FORMAT, value);
+}
+
+void pctl_json_double(struct pctl_json_writer *writer, gdouble value) {
+    gchar formatted[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if (!isfinite(value)) {
+        // JSON has no representation for infinities and NaN
+        pctl_json_null(writer);
+        return;
+    }
+
+    json_begin_value(writer);
+    g_string_append(writer->buffer, g_ascii_dtostr(formatted, sizeof(formatted), value));
+}
+
+void pctl_json_boolean(struct pctl_json_writer *writer, gboolean value) {
+    json_begin_value(writer);
+    g_string_append(writer->buffer, value ? "true" : "false");
+}
+
+void pctl_json_null(struct pctl_json_writer *writer) {
+    json_begin_value(writer);
+    g_string_append(writer->buffer, "null");
+}
+
+static gboolean variant_is_string_dict(GVariant *value) {
+    const GVariantType *element = g_variant_type_element(g_variant_get_type(value));
+    return g_variant_type_is_dict_entry(element) &&
+           g_variant_type_equal(g_variant_type_key(element), G_VARIANT_TYPE_STRING);
+}
+
+static void json_variant_children(struct pctl_json_writer *writer, GVariant *value) {
+    GVariantIter iter;
+    GVariant *child;
+
+    g_variant_iter_init(&iter, value);
+    while ((child = g_variant_iter_next_value(&iter)) != NULL) {
+        pctl_json_variant(writer, child);
+        g_variant_unref(child);
+    }
+}
+
+void pctl_json_variant(struct pctl_json_writer *writer, GVariant *value) {
+    if (value == NULL) {
+        pctl_json_null(writer);
+        return;
+    }
+
+    switch (g_variant_classify(value)) {
+    case G_VARIANT_CLASS_BOOLEAN:
+        pctl_json_boolean(writer, g_variant_get_boolean(value));
+        return;
+    case G_VARIANT_CLASS_BYTE:
+        pctl_json_uint64(writer, g_variant_get_byte(value));
+        return;
+    case G_VARIANT_CLASS_INT16:
+        pctl_json_int64(writer, g_variant_get_int16(value));
+        return;
+    case G_VARIANT_CLASS_UINT16:
+        pctl_json_uint64(writer, g_variant_get_uint16(value));
+        return;
+    case G_VARIANT_CLASS_INT32:
+        pctl_json_int64(writer, g_variant_get_int32(value));
+        return;
+    case G_VARIANT_CLASS_UINT32:
+        pctl_json_uint64(writer, g_variant_get_uint32(value));
+        return;
+    case G_VARIANT_CLASS_INT64:
+        pctl_json_int64(writer, g_variant_get_int64(value));
+        return;
+    case G_VARIANT_CLASS_UINT64:
+        pctl_json_uint64(writer, g_variant_get_uint64(value));
+        return;
+    case G_VARIANT_CLASS_HANDLE:
+        pctl_json_int64(writer, g_variant_get_handle(value));
+        return;
+    case G_VARIANT_CLASS_DOUBLE:
+        pctl_json_double(writer, g_variant_get_double(value));
+        return;
+    case G_VARIANT_CLASS_STRING:
+    case G_VARIANT_CLASS_OBJECT_PATH:
+    case G_VARIANT_CLASS_SIGNATURE:
+        pctl_json_string(writer, g_variant_get_string(value, NULL));
+        return;
+    case G_VARIANT_CLASS_VARIANT: {
+        GVariant *inner = g_variant_get_variant(value);
+        pctl_json_variant(writer, inner);
+        g_variant_unref(inner);
+        return;
+    }
+    case G_VARIANT_CLASS_MAYBE: {
+        GVariant *inner = g_variant_get_maybe(value);
+        pctl_json_variant(writer, inner);
+        if (inner != NULL) {
+            g_variant_unref(inner);
+        }
+        return;
+    }
+    default:
+        break;
+    }
+
+    if (writer->depth >= PCTL_JSON_MAX_DEPTH) {
+        pctl_json_null(writer);
+        return;
+    }
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_ARRAY) && variant_is_string_dict(value)) {
+        GVariantIter iter;
+        const gchar *key;
+        GVariant *child;
+
+        pctl_json_begin_object(writer);
+        g_variant_iter_init(&iter, value);
+        while (g_variant_iter_next(&iter, "{&s@*}", &key, &child)) {
+            pctl_json_key(writer, key);
+            pctl_json_variant(writer, child);
+            g_variant_unref(child);
+        }
+        pctl_json_end_object(writer);
+        return;
+    }
+
+    if (g_variant_is_container(value)) {
+        // other arrays, tuples, and dict entries
+        pctl_json_begin_array(writer);
+        json_variant_children(writer, value);
+        pctl_json_end_array(writer);
+        return;
+    }
+
+    gchar *printed = g_variant_print(value, FALSE);
+    pctl_json_string(writer, printed);
+    g_free(printed);
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#ifndef __PLAYERCTL_JSON_H__
+#define __PLAYERCTL_JSON_H__
+
+#include <glib.h>
+
+#define PCTL_JSON_MAX_DEPTH 32
+
+/*
+ * A streaming JSON encoder. Values are appended to the buffer as they are
+ * written, and the writer only tracks where commas go. The buffer is not
+ * cleared, so it can be reused for each document.
+ */
+struct pctl_json_writer {
+    GString *buffer;
+    guint depth;
+    // whether the container at each depth has a value yet
+    gboolean has_value[PCTL_JSON_MAX_DEPTH];
+    // whether a key was just written so the value follows without a comma
+    gboolean after_key;
+};
+
+void pctl_json_writer_init(struct pctl_json_writer *writer, GString *buffer);
+
+void pctl_json_begin_object(struct pctl_json_writer *writer);
+
+void pctl_json_end_object(struct pctl_json_writer *writer);
+
+void pctl_json_begin_array(struct pctl_json_writer *writer);
+
+void pctl_json_end_array(struct pctl_json_writer *writer);
+
+void pctl_json_key(struct pctl_json_writer *writer, const gchar *key);
+
+void pctl_json_string(struct pctl_json_writer *writer, const gchar *value);
+
+void pctl_json_int64(struct pctl_json_writer *writer, gint64 value);
+
+void pctl_json_uint64(struct pctl_json_writer *writer, guint64 value);
+
+void pctl_json_double(struct pctl_json_writer *writer, gdouble value);
+
+void pctl_json_boolean(struct pctl_json_writer *writer, gboolean value);
+
+void pctl_json_null(struct pctl_json_writer *writer);
+
+/*
+ * Writes the value with the JSON type that matches its GVariant type. Integers
+ * are written as numbers, string arrays as arrays, and a{sv} dictionaries as
+ * objects. Types without a JSON equivalent are written in GVariant text form.
+ */
+void pctl_json_variant(struct pctl_json_writer *writer, GVariant *value);
+
+#endif /* __PLAYERCTL_JSON_H__ */
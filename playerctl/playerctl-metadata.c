@@ -0,0 +1,218 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#include "playerctl-metadata.h"
+
+#include <glib.h>
+#include <stdlib.h>
+
+struct metadata_entry {
+    GQuark key;
+    GVariant *value;
+};
+
+struct pctl_metadata {
+    GVariant *raw;
+    gsize n_entries;
+    GVariant *fields[PCTL_METADATA_N_FIELDS];
+    struct metadata_entry *extras;
+    gsize n_extras;
+    gchar *track_id;
+};
+
+static const gchar *const field_keys[PCTL_METADATA_N_FIELDS] = {
+    [PCTL_METADATA_TRACKID] = "mpris:trackid",
+    [PCTL_METADATA_LENGTH] = "mpris:length",
+    [PCTL_METADATA_ART_URL] = "mpris:artUrl",
+    [PCTL_METADATA_ALBUM] = "xesam:album",
+    [PCTL_METADATA_ALBUM_ARTIST] = "xesam:albumArtist",
+    [PCTL_METADATA_ARTIST] = "xesam:artist",
+    [PCTL_METADATA_AS_TEXT] = "xesam:asText",
+    [PCTL_METADATA_AUDIO_BPM] = "xesam:audioBPM",
+    [PCTL_METADATA_AUTO_RATING] = "xesam:autoRating",
+    [PCTL_METADATA_COMMENT] = "xesam:comment",
+    [PCTL_METADATA_COMPOSER] = "xesam:composer",
+    [PCTL_METADATA_CONTENT_CREATED] = "xesam:contentCreated",
+    [PCTL_METADATA_DISC_NUMBER] = "xesam:discNumber",
+    [PCTL_METADATA_FIRST_USED] = "xesam:firstUsed",
+    [PCTL_METADATA_GENRE] = "xesam:genre",
+    [PCTL_METADATA_LAST_USED] = "xesam:lastUsed",
+    [PCTL_METADATA_LYRICIST] = "xesam:lyricist",
+    [PCTL_METADATA_TITLE] = "xesam:title",
+    [PCTL_METADATA_TRACK_NUMBER] = "xesam:trackNumber",
+    [PCTL_METADATA_URL] = "xesam:url",
+    [PCTL_METADATA_USE_COUNT] = "xesam:useCount",
+    [PCTL_METADATA_USER_RATING] = "xesam:userRating",
+};
+
+// maps the quark of a well-known key to its field index + 1
+static GHashTable *field_index = NULL;
+
+static void metadata_fields_init(void) {
+    static gsize initialized = 0;
+
+    if (g_once_init_enter(&initialized)) {
+        field_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+        for (gsize i = 0; i < PCTL_METADATA_N_FIELDS; ++i) {
+            GQuark quark = g_quark_from_static_string(field_keys[i]);
+            g_hash_table_insert(field_index, GUINT_TO_POINTER(quark), GSIZE_TO_POINTER(i + 1));
+        }
+        g_once_init_leave(&initialized, 1);
+    }
+}
+
+static gint field_for_quark(GQuark key) {
+    gsize index = GPOINTER_TO_SIZE(g_hash_table_lookup(field_index, GUINT_TO_POINTER(key)));
+    return (gint)index - 1;
+}
+
+static int metadata_entry_compare(const void *a, const void *b) {
+    GQuark key_a = ((const struct metadata_entry *)a)->key;
+    GQuark key_b = ((const struct metadata_entry *)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+static gchar *track_id_from_variant(GVariant *track_id_variant) {
+    if (track_id_variant == NULL) {
+        return NULL;
+    }
+
+    if (g_variant_is_of_type(track_id_variant, G_VARIANT_TYPE_OBJECT_PATH)) {
+        return g_variant_dup_string(track_id_variant, NULL);
+    } else if (g_variant_is_of_type(track_id_variant, G_VARIANT_TYPE_STRING)) {
+        // XXX some players set this as a string, which is against the protocol,
+        // but a lot of them do it and I don't feel like fixing it on all the
+        // players in the world.
+        g_debug("mpris:trackid is a string, not a D-Bus object reference");
+        return g_variant_dup_string(track_id_variant, NULL);
+    }
+
+    return NULL;
+}
+
+struct pctl_metadata *pctl_metadata_new(GVariant *metadata) {
+    g_return_val_if_fail(metadata != NULL, NULL);
+
+    if (!g_variant_is_of_type(metadata, G_VARIANT_TYPE_VARDICT)) {
+        g_debug("metadata is not a dictionary: %s", g_variant_get_type_string(metadata));
+        return NULL;
+    }
+
+    metadata_fields_init();
+
+    struct pctl_metadata *parsed = g_slice_new0(struct pctl_metadata);
+    parsed->raw = g_variant_ref_sink(metadata);
+
+    gsize n_children = g_variant_n_children(metadata);
+    parsed->extras = g_new(struct metadata_entry, n_children);
+
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *value;
+    g_variant_iter_init(&iter, metadata);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        GQuark quark = g_quark_from_string(key);
+        gint field = field_for_quark(quark);
+
+        if (field >= 0) {
+            if (parsed->fields[field] != NULL) {
+                // duplicate key, keep the first like g_variant_lookup_value()
+                g_variant_unref(value);
+                continue;
+            }
+            parsed->fields[field] = value;
+        } else {
+            parsed->extras[parsed->n_extras].key = quark;
+            parsed->extras[parsed->n_extras].value = value;
+            parsed->n_extras++;
+        }
+        parsed->n_entries++;
+    }
+
+    qsort(parsed->extras, parsed->n_extras, sizeof(struct metadata_entry), metadata_entry_compare);
+
+    parsed->track_id = track_id_from_variant(parsed->fields[PCTL_METADATA_TRACKID]);
+
+    return parsed;
+}
+
+void pctl_metadata_free(struct pctl_metadata *metadata) {
+    if (metadata == NULL) {
+        return;
+    }
+
+    for (gsize i = 0; i < PCTL_METADATA_N_FIELDS; ++i) {
+        if (metadata->fields[i] != NULL) {
+            g_variant_unref(metadata->fields[i]);
+        }
+    }
+    for (gsize i = 0; i < metadata->n_extras; ++i) {
+        g_variant_unref(metadata->extras[i].value);
+    }
+
+    g_free(metadata->extras);
+    g_free(metadata->track_id);
+    g_variant_unref(metadata->raw);
+    g_slice_free(struct pctl_metadata, metadata);
+}
+
+GVariant *pctl_metadata_get_raw(struct pctl_metadata *metadata) {
+    g_return_val_if_fail(metadata != NULL, NULL);
+    return metadata->raw;
+}
+
+gsize pctl_metadata_get_n_entries(struct pctl_metadata *metadata) {
+    g_return_val_if_fail(metadata != NULL, 0);
+    return metadata->n_entries;
+}
+
+GVariant *pctl_metadata_get_field(struct pctl_metadata *metadata, enum pctl_metadata_field field) {
+    g_return_val_if_fail(metadata != NULL, NULL);
+    g_return_val_if_fail(field < PCTL_METADATA_N_FIELDS, NULL);
+    return metadata->fields[field];
+}
+
+GVariant *pctl_metadata_lookup_quark(struct pctl_metadata *metadata, GQuark key) {
+    g_return_val_if_fail(metadata != NULL, NULL);
+
+    if (key == 0) {
+        return NULL;
+    }
+
+    gint field = field_for_quark(key);
+    if (field >= 0) {
+        return metadata->fields[field];
+    }
+
+    struct metadata_entry needle = {.key = key};
+    struct metadata_entry *entry = bsearch(&needle, metadata->extras, metadata->n_extras,
+                                           sizeof(struct metadata_entry), metadata_entry_compare);
+
+    return entry != NULL ? entry->value : NULL;
+}
+
+GVariant *pctl_metadata_lookup(struct pctl_metadata *metadata, const gchar *key) {
+    // a key that was never interned cannot be in any parsed metadata
+    return pctl_metadata_lookup_quark(metadata, g_quark_try_string(key));
+}
+
+const gchar *pctl_metadata_get_track_id(struct pctl_metadata *metadata) {
+    g_return_val_if_fail(metadata != NULL, NULL);
+    return metadata->track_id;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#ifndef __PLAYERCTL_METADATA_H__
+#define __PLAYERCTL_METADATA_H__
+
+#include <glib.h>
+
+/*
+ * The well-known keys from the MPRIS metadata specification. These are parsed
+ * into fixed slots so they can be read without a lookup.
+ */
+enum pctl_metadata_field {
+    PCTL_METADATA_TRACKID = 0,
+    PCTL_METADATA_LENGTH,
+    PCTL_METADATA_ART_URL,
+    PCTL_METADATA_ALBUM,
+    PCTL_METADATA_ALBUM_ARTIST,
+    PCTL_METADATA_ARTIST,
+    PCTL_METADATA_AS_TEXT,
+    PCTL_METADATA_AUDIO_BPM,
+    PCTL_METADATA_AUTO_RATING,
+    PCTL_METADATA_COMMENT,
+    PCTL_METADATA_COMPOSER,
+    PCTL_METADATA_CONTENT_CREATED,
+    PCTL_METADATA_DISC_NUMBER,
+    PCTL_METADATA_FIRST_USED,
+    PCTL_METADATA_GENRE,
+    PCTL_METADATA_LAST_USED,
+    PCTL_METADATA_LYRICIST,
+    PCTL_METADATA_TITLE,
+    PCTL_METADATA_TRACK_NUMBER,
+    PCTL_METADATA_URL,
+    PCTL_METADATA_USE_COUNT,
+    PCTL_METADATA_USER_RATING,
+    PCTL_METADATA_N_FIELDS,
+};
+
+/*
+ * A parsed view of an MPRIS Metadata `a{sv}` dictionary. It is built once each
+ * time the metadata changes. Keys are interned as quarks, well-known keys are
+ * kept in fixed slots, and all other keys are kept in an array sorted by quark.
+ */
+struct pctl_metadata;
+
+struct pctl_metadata *pctl_metadata_new(GVariant *metadata);
+
+void pctl_metadata_free(struct pctl_metadata *metadata);
+
+GVariant *pctl_metadata_get_raw(struct pctl_metadata *metadata);
+
+gsize pctl_metadata_get_n_entries(struct pctl_metadata *metadata);
+
+GVariant *pctl_metadata_get_field(struct pctl_metadata *metadata, enum pctl_metadata_field field);
+
+GVariant *pctl_metadata_lookup_quark(struct pctl_metadata *metadata, GQuark key);
+
+GVariant *pctl_metadata_lookup(struct pctl_metadata *metadata, const gchar *key);
+
+const gchar *pctl_metadata_get_track_id(struct pctl_metadata *metadata);
+
+#endif /* __PLAYERCTL_METADATA_H__ */
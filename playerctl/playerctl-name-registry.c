@@ -0,0 +1,352 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors.
+ */
+
+#include "playerctl-name-registry.h"
+
+#include <gio/gio.h>
+#include <glib.h>
+#include <string.h>
+
+#include "playerctl-common.h"
+
+#define PLAYERCTLD_INSTANCE "playerctld"
+#define PLAYERCTLD_BUS_NAME MPRIS_PREFIX PLAYERCTLD_INSTANCE
+
+struct name_registry {
+    GBusType bus_type;
+    // the signals of the registry are dispatched here at each listing, so the
+    // names do not depend on a main loop of the caller
+    GMainContext *context;
+    GDBusConnection *connection;
+    guint subscription_id;
+    gulong closed_handler_id;
+    // the instances of the MPRIS names owned on the bus
+    GHashTable *instances;
+    GDBusProxy *playerctld_proxy;
+};
+
+/* Guards the registries. It is never held while waiting for the bus. */
+G_LOCK_DEFINE_STATIC(registry);
+
+static struct name_registry session_registry = {
+    .bus_type = G_BUS_TYPE_SESSION,
+};
+
+static struct name_registry system_registry = {
+    .bus_type = G_BUS_TYPE_SYSTEM,
+};
+
+static struct name_registry *registry_for_bus_type(GBusType bus_type) {
+    switch (bus_type) {
+    case G_BUS_TYPE_SESSION:
+        return &session_registry;
+    case G_BUS_TYPE_SYSTEM:
+        return &system_registry;
+    default:
+        return NULL;
+    }
+}
+
+static void registry_reset(struct name_registry *registry) {
+    if (registry->connection == NULL) {
+        return;
+    }
+
+    g_dbus_connection_signal_unsubscribe(registry->connection, registry->subscription_id);
+    g_signal_handler_disconnect(registry->connection, registry->closed_handler_id);
+    g_clear_object(&registry->connection);
+    g_clear_object(&registry->playerctld_proxy);
+    g_hash_table_destroy(registry->instances);
+    registry->instances = NULL;
+    registry->subscription_id = 0;
+    registry->closed_handler_id = 0;
+}
+
+static void registry_name_owner_changed_callback(GDBusConnection *connection,
+                                                 const gchar *sender_name,
+                                                 const gchar *object_path,
+                                                 const gchar *interface_name,
+                                                 const gchar *signal_name, GVariant *parameters,
+                                                 gpointer user_data) {
+    struct name_registry *registry = user_data;
+
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(sss)"))) {
+        return;
+    }
+
+    const gchar *name = NULL;
+    const gchar *previous_owner = NULL;
+    const gchar *new_owner = NULL;
+    g_variant_get(parameters, "(&s&s&s)", &name, &previous_owner, &new_owner);
+
+    if (!g_str_has_prefix(name, MPRIS_PREFIX) || strlen(name) <= strlen(MPRIS_PREFIX)) {
+        return;
+    }
+    const gchar *instance = name + strlen(MPRIS_PREFIX);
+
+    G_LOCK(registry);
+    if (registry->connection == connection) {
+        if (strlen(new_owner) == 0) {
+            g_hash_table_remove(registry->instances, instance);
+            if (g_strcmp0(instance, PLAYERCTLD_INSTANCE) == 0) {
+                g_clear_object(&registry->playerctld_proxy);
+            }
+        } else {
+            g_hash_table_add(registry->instances, g_strdup(instance));
+        }
+    }
+    G_UNLOCK(registry);
+}
+
+static void registry_connection_closed_callback(GDBusConnection *connection,
+                                                gboolean remote_peer_vanished, GError *error,
+                                                gpointer user_data) {
+    struct name_registry *registry = user_data;
+
+    // the next listing gets the names from the new connection
+    G_LOCK(registry);
+    if (registry->connection == connection) {
+        registry_reset(registry);
+    }
+    G_UNLOCK(registry);
+}
+
+/*
+ * Lists the names on the bus and subscribes to their changes if that is not
+ * done yet. Returns the context the changes are dispatched on.
+ */
+static GMainContext *registry_ensure(struct name_registry *registry, gint timeout,
+                                     GError **err) {
+    GError *tmp_error = NULL;
+
+    G_LOCK(registry);
+    if (registry->context == NULL) {
+        registry->context = g_main_context_new();
+    }
+    GMainContext *context = registry->context;
+    gboolean listed = (registry->connection != NULL);
+    G_UNLOCK(registry);
+
+    if (listed) {
+        return context;
+    }
+
+    GDBusConnection *connection = g_bus_get_sync(registry->bus_type, NULL, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    // subscribe before listing so no change is missed in between
+    g_main_context_push_thread_default(context);
+    guint subscription_id = g_dbus_connection_signal_subscribe(
+        connection, "org.freedesktop.DBus", "org.freedesktop.DBus", "NameOwnerChanged",
+        "/org/freedesktop/DBus", "org.mpris.MediaPlayer2",
+        G_DBUS_SIGNAL_FLAGS_MATCH_ARG0_NAMESPACE, registry_name_owner_changed_callback, registry,
+        NULL);
+    g_main_context_pop_thread_default(context);
+
+    g_debug("Getting list of player names from D-Bus");
+    GVariant *reply = g_dbus_connection_call_sync(
+        connection, "org.freedesktop.DBus", "/org/freedesktop/DBus", "org.freedesktop.DBus",
+        "ListNames", NULL, G_VARIANT_TYPE("(as)"), G_DBUS_CALL_FLAGS_NONE, timeout, NULL,
+        &tmp_error);
+    if (tmp_error != NULL) {
+        g_dbus_connection_signal_unsubscribe(connection, subscription_id);
+        g_object_unref(connection);
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    GHashTable *instances = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    GVariantIter *names = NULL;
+    const gchar *name = NULL;
+    g_variant_get(reply, "(as)", &names);
+    while (g_variant_iter_next(names, "&s", &name)) {
+        if (g_str_has_prefix(name, MPRIS_PREFIX) && strlen(name) > strlen(MPRIS_PREFIX)) {
+            g_hash_table_add(instances, g_strdup(name + strlen(MPRIS_PREFIX)));
+        }
+    }
+    g_variant_iter_free(names);
+    g_variant_unref(reply);
+
+    G_LOCK(registry);
+    if (registry->connection != NULL) {
+        // another thread listed the names in the meantime
+        G_UNLOCK(registry);
+        g_dbus_connection_signal_unsubscribe(connection, subscription_id);
+        g_hash_table_destroy(instances);
+        g_object_unref(connection);
+        return context;
+    }
+
+    registry->connection = connection;
+    registry->subscription_id = subscription_id;
+    registry->instances = instances;
+    registry->closed_handler_id = g_signal_connect(
+        connection, "closed", G_CALLBACK(registry_connection_closed_callback), registry);
+    G_UNLOCK(registry);
+
+    return context;
+}
+
+/*
+ * Applies the changes the bus has sent since the last listing. If another
+ * thread is applying them already, the names are read as they are.
+ */
+static void registry_dispatch(GMainContext *context) {
+    if (!g_main_context_acquire(context)) {
+        return;
+    }
+
+    while (g_main_context_iteration(context, FALSE)) {
+    }
+
+    g_main_context_release(context);
+}
+
+/*
+ * Gets the player names from playerctld because they are in order of
+ * activity. Returns NULL if they cannot be read.
+ */
+static GVariant *registry_get_playerctld_names(struct name_registry *registry,
+                                               GMainContext *context) {
+    GError *tmp_error = NULL;
+
+    G_LOCK(registry);
+    GDBusConnection *connection =
+        (registry->connection != NULL ? g_object_ref(registry->connection) : NULL);
+    GDBusProxy *proxy =
+        (registry->playerctld_proxy != NULL ? g_object_ref(registry->playerctld_proxy) : NULL);
+    G_UNLOCK(registry);
+
+    if (connection == NULL) {
+        return NULL;
+    }
+
+    if (proxy == NULL) {
+        // the proxy keeps the property current from PropertiesChanged on the context
+        g_main_context_push_thread_default(context);
+        proxy = g_dbus_proxy_new_sync(connection, G_DBUS_PROXY_FLAGS_NONE, NULL,
+                                      PLAYERCTLD_BUS_NAME, "/org/mpris/MediaPlayer2",
+                                      "com.github.altdesktop.playerctld", NULL, &tmp_error);
+        g_main_context_pop_thread_default(context);
+        if (tmp_error != NULL) {
+            g_warning("Could not get player names from playerctld: %s", tmp_error->message);
+            g_clear_error(&tmp_error);
+            g_object_unref(connection);
+            return NULL;
+        }
+
+        G_LOCK(registry);
+        if (registry->connection == connection && registry->playerctld_proxy == NULL) {
+            registry->playerctld_proxy = g_object_ref(proxy);
+        }
+        G_UNLOCK(registry);
+    }
+
+    GVariant *player_names = g_dbus_proxy_get_cached_property(proxy, "PlayerNames");
+    if (player_names == NULL) {
+        g_warning("%s",
+                  "Could not get player names from playerctld: PlayerNames property not found");
+        G_LOCK(registry);
+        if (registry->playerctld_proxy == proxy) {
+            g_clear_object(&registry->playerctld_proxy);
+        }
+        G_UNLOCK(registry);
+    }
+
+    g_object_unref(proxy);
+    g_object_unref(connection);
+    return player_names;
+}
+
+GList *pctl_name_registry_list_player_names(GBusType bus_type, gint timeout, GError **err) {
+    GError *tmp_error = NULL;
+    GList *players = NULL;
+    struct name_registry *registry = registry_for_bus_type(bus_type);
+
+    g_return_val_if_fail(registry != NULL, NULL);
+
+    GMainContext *context = registry_ensure(registry, timeout, &tmp_error);
+    if (context == NULL) {
+        if (tmp_error->domain == G_IO_ERROR && tmp_error->code == G_IO_ERROR_NOT_FOUND) {
+            // XXX: This means the dbus socket address is not found which may
+            // mean that the bus is not running or the address was set
+            // incorrectly. I think we can pass through here because it is true
+            // that there are no names on the bus that is supposed to be at
+            // this socket path. But we need a better way of dealing with this case.
+            const gchar *message = "D-Bus socket address not found, unable to list player names";
+            if (bus_type == G_BUS_TYPE_SESSION) {
+                g_warning("%s", message);
+            } else {
+                g_debug("%s", message);
+            }
+
+            g_clear_error(&tmp_error);
+            return NULL;
+        }
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    registry_dispatch(context);
+
+    PlayerctlSource source = pctl_bus_type_to_source(bus_type);
+
+    G_LOCK(registry);
+    gboolean playerctld_running = (registry->instances != NULL &&
+                                   g_hash_table_contains(registry->instances, PLAYERCTLD_INSTANCE));
+    G_UNLOCK(registry);
+
+    GVariant *playerctld_names = NULL;
+    if (playerctld_running) {
+        g_debug("%s", "Playerctld is running. Getting names from there.");
+        playerctld_names = registry_get_playerctld_names(registry, context);
+    }
+
+    if (playerctld_names != NULL) {
+        GVariantIter iter;
+        const gchar *name = NULL;
+        g_variant_iter_init(&iter, playerctld_names);
+        while (g_variant_iter_next(&iter, "&s", &name)) {
+            if (g_str_has_prefix(name, MPRIS_PREFIX)) {
+                players = g_list_prepend(players,
+                                         pctl_player_name_new(name + strlen(MPRIS_PREFIX), source));
+            }
+        }
+        players = g_list_reverse(players);
+        g_variant_unref(playerctld_names);
+    } else {
+        G_LOCK(registry);
+        if (registry->instances != NULL) {
+            GHashTableIter iter;
+            gpointer instance = NULL;
+            g_hash_table_iter_init(&iter, registry->instances);
+            while (g_hash_table_iter_next(&iter, &instance, NULL)) {
+                players = g_list_prepend(players, pctl_player_name_new(instance, source));
+            }
+        }
+        G_UNLOCK(registry);
+        players = g_list_sort(players, (GCompareFunc)pctl_player_name_compare);
+    }
+
+    return players;
+}
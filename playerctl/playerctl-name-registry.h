@@ -0,0 +1,40 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#ifndef __PLAYERCTL_NAME_REGISTRY_H__
+#define __PLAYERCTL_NAME_REGISTRY_H__
+
+#include <gio/gio.h>
+#include <glib.h>
+
+/*
+ * A process-wide registry of the MPRIS names on each bus. The names are listed
+ * once per bus with ListNames and then kept current from the NameOwnerChanged
+ * signal. The signal is dispatched on a main context of the registry at each
+ * listing, so the names stay current whether or not the caller runs a main
+ * loop.
+ *
+ * Returns a list of PlayerctlPlayerName in the order of activity when
+ * playerctld is running, or sorted by instance otherwise. The timeout in
+ * milliseconds (-1 for the default) bounds the listing when the names are not
+ * known yet.
+ */
+GList *pctl_name_registry_list_player_names(GBusType bus_type, gint timeout, GError **err);
+
+#endif /* __PLAYERCTL_NAME_REGISTRY_H__ */
@@ -31,6 +31,8 @@ enum {
     PROP_0,
     PROP_PLAYERS,
     PROP_PLAYER_NAMES,
+    PROP_SOURCE,
+    PROP_TIMEOUT,
     N_PROPERTIES,
 };
 
@@ -51,13 +53,33 @@ static guint connection_signals[LAST_SIGNAL] = {0};
 struct _PlayerctlPlayerManagerPrivate {
     gboolean initted;
     GError *init_error;
+    PlayerctlSource source;
+    gint timeout;
     GDBusProxy *session_proxy;
     GDBusProxy *system_proxy;
     GList *player_names;
     GList *players;
+    // indexes into the lists above so lookups don't have to scan them
+    GHashTable *player_names_index;  // PlayerctlPlayerName -> link in player_names
+    GHashTable *players_index;       // PlayerctlPlayer -> link in players
+    GHashTable *players_by_name;     // PlayerctlPlayerName -> link in players
     GCompareDataFunc sort_func;
     gpointer sort_data;
     GDestroyNotify sort_notify;
+    PlayerctlPlayerRankFunc rank_func;
+    gpointer rank_data;
+    GDestroyNotify rank_notify;
+    GHashTable *player_ranks;  // PlayerctlPlayer -> rank
+    GArray *rank_buckets;      // struct rank_bucket sorted by rank
+};
+
+/*
+ * The first link in the players list of each rank. Players of the same rank
+ * are contiguous in the list, so a player can be placed by finding its bucket.
+ */
+struct rank_bucket {
+    gint rank;
+    GList *head;
 };
 
 static void playerctl_player_manager_initable_iface_init(GInitableIface *iface);
@@ -69,9 +91,15 @@ G_DEFINE_TYPE_WITH_CODE(PlayerctlPlayerManager, playerctl_player_manager, G_TYPE
 
 static void playerctl_player_manager_set_property(GObject *object, guint property_id,
                                                   const GValue *value, GParamSpec *pspec) {
-    // PlayerctlPlayerManager *manager = PLAYERCTL_PLAYER_MANAGER(object);
+    PlayerctlPlayerManager *manager = PLAYERCTL_PLAYER_MANAGER(object);
 
     switch (property_id) {
+    case PROP_SOURCE:
+        manager->priv->source = g_value_get_enum(value);
+        break;
+    case PROP_TIMEOUT:
+        manager->priv->timeout = g_value_get_int(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -88,6 +116,12 @@ static void playerctl_player_manager_get_property(GObject *object, guint propert
     case PROP_PLAYER_NAMES:
         g_value_set_pointer(value, manager->priv->player_names);
         break;
+    case PROP_SOURCE:
+        g_value_set_enum(value, manager->priv->source);
+        break;
+    case PROP_TIMEOUT:
+        g_value_set_int(value, manager->priv->timeout);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -113,6 +147,14 @@ static void playerctl_player_manager_dispose(GObject *gobject) {
 static void playerctl_player_manager_finalize(GObject *gobject) {
     PlayerctlPlayerManager *manager = PLAYERCTL_PLAYER_MANAGER(gobject);
 
+    g_hash_table_destroy(manager->priv->player_names_index);
+    g_hash_table_destroy(manager->priv->players_index);
+    g_hash_table_destroy(manager->priv->players_by_name);
+    g_hash_table_destroy(manager->priv->player_ranks);
+    g_array_unref(manager->priv->rank_buckets);
+    if (manager->priv->rank_notify != NULL) {
+        manager->priv->rank_notify(manager->priv->rank_data);
+    }
     g_list_free_full(manager->priv->player_names, (GDestroyNotify)playerctl_player_name_free);
     g_list_free_full(manager->priv->players, g_object_unref);
 
@@ -147,6 +189,32 @@ static void playerctl_player_manager_class_init(PlayerctlPlayerManagerClass *kla
                              "A list of player names that are currently available to control.",
                              G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+    /**
+     * PlayerctlPlayerManager:source:
+     *
+     * The source of the players this manager watches. If the source is
+     * %PLAYERCTL_SOURCE_NONE, players are watched on all sources. Otherwise the
+     * manager does not connect to the other sources at all.
+     */
+    obj_properties[PROP_SOURCE] =
+        g_param_spec_enum("source", "Player source", "The source of the players to watch",
+                          playerctl_source_get_type(), PLAYERCTL_SOURCE_NONE,
+                          G_PARAM_CONSTRUCT_ONLY | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * PlayerctlPlayerManager:timeout:
+     *
+     * The timeout in milliseconds for listing the players, or -1 to use the
+     * default D-Bus timeout. Managed players that do not have a
+     * #PlayerctlPlayer:timeout of their own are given this timeout.
+     */
+    obj_properties[PROP_TIMEOUT] =
+        g_param_spec_int("timeout", "Timeout",
+                         "The timeout in milliseconds for calls made for the manager, or -1 for "
+                         "the default timeout",
+                         -1, G_MAXINT, -1,
+                         G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
     g_object_class_install_properties(gobject_class, N_PROPERTIES, obj_properties);
 
     /**
@@ -209,6 +277,224 @@ static void playerctl_player_manager_class_init(PlayerctlPlayerManagerClass *kla
 
 static void playerctl_player_manager_init(PlayerctlPlayerManager *manager) {
     manager->priv = playerctl_player_manager_get_instance_private(manager);
+    // the keys of the names index are owned by the player_names list
+    manager->priv->player_names_index =
+        g_hash_table_new(pctl_player_name_hash, pctl_player_name_equal);
+    manager->priv->players_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+    manager->priv->players_by_name =
+        g_hash_table_new_full(pctl_player_name_hash, pctl_player_name_equal,
+                              (GDestroyNotify)playerctl_player_name_free, NULL);
+    manager->priv->player_ranks = g_hash_table_new(g_direct_hash, g_direct_equal);
+    manager->priv->rank_buckets = g_array_new(FALSE, FALSE, sizeof(struct rank_bucket));
+}
+
+static gint manager_player_rank(PlayerctlPlayerManager *manager, PlayerctlPlayer *player) {
+    return GPOINTER_TO_INT(g_hash_table_lookup(manager->priv->player_ranks, player));
+}
+
+/*
+ * Binary search for the bucket of the rank. Returns TRUE if it exists, and
+ * sets index to its position or to the position it would be inserted at.
+ */
+static gboolean manager_find_rank_bucket(PlayerctlPlayerManager *manager, gint rank,
+                                         guint *index) {
+    GArray *buckets = manager->priv->rank_buckets;
+    guint low = 0;
+    guint high = buckets->len;
+
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+        gint mid_rank = g_array_index(buckets, struct rank_bucket, mid).rank;
+        if (mid_rank == rank) {
+            *index = mid;
+            return TRUE;
+        } else if (mid_rank < rank) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    *index = low;
+    return FALSE;
+}
+
+static void list_insert_link_before(GList **list, GList *sibling, GList *link) {
+    link->next = sibling;
+    link->prev = sibling->prev;
+    if (sibling->prev != NULL) {
+        sibling->prev->next = link;
+    } else {
+        *list = link;
+    }
+    sibling->prev = link;
+}
+
+static void list_append_link(GList **list, GList *last, GList *link) {
+    link->next = NULL;
+    link->prev = last;
+    if (last != NULL) {
+        last->next = link;
+    } else {
+        *list = link;
+    }
+}
+
+/*
+ * Places a detached link for a player in the players list so it is on top of
+ * the players that are equal to it in the sorted order.
+ */
+static void manager_insert_player_link(PlayerctlPlayerManager *manager, GList *link) {
+    PlayerctlPlayer *player = PLAYERCTL_PLAYER(link->data);
+
+    if (manager->priv->rank_func != NULL) {
+        gint rank = manager_player_rank(manager, player);
+        guint index = 0;
+        if (manager_find_rank_bucket(manager, rank, &index)) {
+            struct rank_bucket *bucket =
+                &g_array_index(manager->priv->rank_buckets, struct rank_bucket, index);
+            list_insert_link_before(&manager->priv->players, bucket->head, link);
+            bucket->head = link;
+            return;
+        }
+
+        if (index < manager->priv->rank_buckets->len) {
+            GList *sibling =
+                g_array_index(manager->priv->rank_buckets, struct rank_bucket, index).head;
+            list_insert_link_before(&manager->priv->players, sibling, link);
+        } else {
+            list_append_link(&manager->priv->players, g_list_last(manager->priv->players), link);
+        }
+
+        struct rank_bucket bucket = {
+            .rank = rank,
+            .head = link,
+        };
+        g_array_insert_val(manager->priv->rank_buckets, index, bucket);
+    } else if (manager->priv->sort_func != NULL) {
+        // insert before the first player that does not sort before it
+        GList *last = NULL;
+        GList *sibling = manager->priv->players;
+        while (sibling != NULL &&
+               manager->priv->sort_func(player, sibling->data, manager->priv->sort_data) > 0) {
+            last = sibling;
+            sibling = sibling->next;
+        }
+
+        if (sibling != NULL) {
+            list_insert_link_before(&manager->priv->players, sibling, link);
+        } else {
+            list_append_link(&manager->priv->players, last, link);
+        }
+    } else {
+        manager->priv->players = g_list_concat(link, manager->priv->players);
+    }
+}
+
+static void manager_unlink_player_link(PlayerctlPlayerManager *manager, GList *link) {
+    if (manager->priv->rank_func != NULL) {
+        gint rank = manager_player_rank(manager, PLAYERCTL_PLAYER(link->data));
+        guint index = 0;
+        if (manager_find_rank_bucket(manager, rank, &index)) {
+            struct rank_bucket *bucket =
+                &g_array_index(manager->priv->rank_buckets, struct rank_bucket, index);
+            if (bucket->head == link) {
+                if (link->next != NULL &&
+                    manager_player_rank(manager, PLAYERCTL_PLAYER(link->next->data)) == rank) {
+                    bucket->head = link->next;
+                } else {
+                    g_array_remove_index(manager->priv->rank_buckets, index);
+                }
+            }
+        }
+    }
+
+    manager->priv->players = g_list_remove_link(manager->priv->players, link);
+}
+
+static gint player_rank_compare_func(gconstpointer a, gconstpointer b, gpointer user_data) {
+    PlayerctlPlayerManager *manager = user_data;
+    gint rank_a = manager_player_rank(manager, PLAYERCTL_PLAYER(a));
+    gint rank_b = manager_player_rank(manager, PLAYERCTL_PLAYER(b));
+    return (rank_a > rank_b) - (rank_a < rank_b);
+}
+
+/*
+ * Sorts the whole list by rank and rebuilds the buckets. Only needed when
+ * the rank function changes.
+ */
+static void manager_rebuild_ranks(PlayerctlPlayerManager *manager) {
+    g_array_set_size(manager->priv->rank_buckets, 0);
+
+    if (manager->priv->rank_func == NULL) {
+        g_hash_table_remove_all(manager->priv->player_ranks);
+        if (manager->priv->sort_func != NULL) {
+            manager->priv->players = g_list_sort_with_data(
+                manager->priv->players, manager->priv->sort_func, manager->priv->sort_data);
+        }
+        return;
+    }
+
+    for (GList *l = manager->priv->players; l != NULL; l = l->next) {
+        gint rank = manager->priv->rank_func(PLAYERCTL_PLAYER(l->data), manager->priv->rank_data);
+        g_hash_table_insert(manager->priv->player_ranks, l->data, GINT_TO_POINTER(rank));
+    }
+
+    // the sort is stable so players keep their order within a rank
+    manager->priv->players =
+        g_list_sort_with_data(manager->priv->players, player_rank_compare_func, manager);
+
+    for (GList *l = manager->priv->players; l != NULL; l = l->next) {
+        gint rank = manager_player_rank(manager, PLAYERCTL_PLAYER(l->data));
+        if (l->prev == NULL ||
+            manager_player_rank(manager, PLAYERCTL_PLAYER(l->prev->data)) != rank) {
+            struct rank_bucket bucket = {
+                .rank = rank,
+                .head = l,
+            };
+            g_array_append_val(manager->priv->rank_buckets, bucket);
+        }
+    }
+}
+
+static void manager_index_player_name(PlayerctlPlayerManager *manager, GList *link) {
+    g_hash_table_insert(manager->priv->player_names_index, link->data, link);
+}
+
+static void manager_index_player(PlayerctlPlayerManager *manager, GList *link) {
+    PlayerctlPlayer *player = PLAYERCTL_PLAYER(link->data);
+    g_hash_table_insert(manager->priv->players_index, player, link);
+
+    const gchar *instance = pctl_player_get_instance(player);
+    if (instance != NULL) {
+        g_hash_table_insert(manager->priv->players_by_name,
+                            pctl_player_name_new(instance, pctl_player_get_source(player)), link);
+    }
+}
+
+static void manager_unindex_player(PlayerctlPlayerManager *manager, PlayerctlPlayer *player) {
+    g_hash_table_remove(manager->priv->players_index, player);
+
+    const gchar *instance = pctl_player_get_instance(player);
+    if (instance != NULL) {
+        PlayerctlPlayerName key = {
+            .instance = (gchar *)instance,
+            .source = pctl_player_get_source(player),
+        };
+        GList *l = g_hash_table_lookup(manager->priv->players_by_name, &key);
+        if (l != NULL && l->data == player) {
+            g_hash_table_remove(manager->priv->players_by_name, &key);
+        }
+    }
+}
+
+static GList *manager_find_player_name(PlayerctlPlayerManager *manager, gchar *instance,
+                                       PlayerctlSource source) {
+    PlayerctlPlayerName key = {
+        .instance = instance,
+        .source = source,
+    };
+    return g_hash_table_lookup(manager->priv->player_names_index, &key);
 }
 
 static gchar *player_id_from_bus_name(const gchar *bus_name) {
@@ -224,19 +510,18 @@ static gchar *player_id_from_bus_name(const gchar *bus_name) {
 
 static void manager_remove_managed_player_by_name(PlayerctlPlayerManager *manager,
                                                   PlayerctlPlayerName *player_name) {
-    GList *l = NULL;
-    for (l = manager->priv->players; l != NULL; l = l->next) {
-        PlayerctlPlayer *player = PLAYERCTL_PLAYER(l->data);
-        gchar *instance = pctl_player_get_instance(player);
-        // TODO match bus type
-        if (g_strcmp0(instance, player_name->instance) == 0) {
-            manager->priv->players = g_list_remove_link(manager->priv->players, l);
-            g_debug("removing managed player: %s", instance);
-            g_signal_emit(manager, connection_signals[PLAYER_VANISHED], 0, player);
-            g_list_free_full(l, g_object_unref);
-            break;
-        }
+    GList *l = g_hash_table_lookup(manager->priv->players_by_name, player_name);
+    if (l == NULL) {
+        return;
     }
+
+    PlayerctlPlayer *player = PLAYERCTL_PLAYER(l->data);
+    manager_unlink_player_link(manager, l);
+    manager_unindex_player(manager, player);
+    g_hash_table_remove(manager->priv->player_ranks, player);
+    g_debug("removing managed player: %s", player_name->instance);
+    g_signal_emit(manager, connection_signals[PLAYER_VANISHED], 0, player);
+    g_list_free_full(l, g_object_unref);
 }
 
 static void dbus_name_owner_changed_callback(GDBusProxy *proxy, gchar *sender_name,
@@ -284,10 +569,11 @@ static void dbus_name_owner_changed_callback(GDBusProxy *proxy, gchar *sender_na
     GList *player_entry = NULL;
     if (strlen(new_owner) == 0 && strlen(previous_owner) != 0) {
         // the name has vanished
-        player_entry = pctl_player_name_find(manager->priv->player_names, player_id,
-                                             pctl_bus_type_to_source(bus_type));
+        player_entry =
+            manager_find_player_name(manager, player_id, pctl_bus_type_to_source(bus_type));
         if (player_entry != NULL) {
             PlayerctlPlayerName *player_name = player_entry->data;
+            g_hash_table_remove(manager->priv->player_names_index, player_name);
             manager->priv->player_names =
                 g_list_remove_link(manager->priv->player_names, player_entry);
             manager_remove_managed_player_by_name(manager, player_name);
@@ -297,13 +583,14 @@ static void dbus_name_owner_changed_callback(GDBusProxy *proxy, gchar *sender_na
         }
     } else if (strlen(previous_owner) == 0 && strlen(new_owner) != 0) {
         // the name has appeared
-        player_entry = pctl_player_name_find(manager->priv->players, player_id,
-                                             pctl_bus_type_to_source(bus_type));
+        player_entry =
+            manager_find_player_name(manager, player_id, pctl_bus_type_to_source(bus_type));
         if (player_entry == NULL) {
             PlayerctlPlayerName *player_name =
                 pctl_player_name_new(player_id, pctl_bus_type_to_source(bus_type));
 
             manager->priv->player_names = g_list_prepend(manager->priv->player_names, player_name);
+            manager_index_player_name(manager, manager->priv->player_names);
             g_debug("player name appeared: %s", player_name->instance);
             g_signal_emit(manager, connection_signals[NAME_APPEARED], 0, player_name);
         }
@@ -315,6 +602,26 @@ static void dbus_name_owner_changed_callback(GDBusProxy *proxy, gchar *sender_na
     g_variant_unref(new_owner_variant);
 }
 
+static GDBusProxy *manager_bus_proxy_new(GBusType bus_type, GError **err) {
+    GError *tmp_error = NULL;
+
+    // only the NameOwnerChanged signal is used, so don't load the properties
+    GDBusProxy *proxy = g_dbus_proxy_new_for_bus_sync(
+        bus_type, G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES, NULL, "org.freedesktop.DBus",
+        "/org/freedesktop/DBus", "org.freedesktop.DBus", NULL, &tmp_error);
+    if (tmp_error != NULL) {
+        if (tmp_error->domain == G_IO_ERROR && tmp_error->code == G_IO_ERROR_NOT_FOUND) {
+            // TODO the bus address was set incorrectly so log a warning
+            g_clear_error(&tmp_error);
+        } else {
+            g_propagate_error(err, tmp_error);
+        }
+        return NULL;
+    }
+
+    return proxy;
+}
+
 static gboolean playerctl_player_manager_initable_init(GInitable *initable,
                                                        GCancellable *cancellable, GError **error) {
     GError *tmp_error = NULL;
@@ -324,37 +631,34 @@ static gboolean playerctl_player_manager_initable_init(GInitable *initable,
         return TRUE;
     }
 
-    manager->priv->session_proxy = g_dbus_proxy_new_for_bus_sync(
-        G_BUS_TYPE_SESSION, G_DBUS_PROXY_FLAGS_NONE, NULL, "org.freedesktop.DBus",
-        "/org/freedesktop/DBus", "org.freedesktop.DBus", NULL, &tmp_error);
-    if (tmp_error != NULL) {
-        if (tmp_error->domain == G_IO_ERROR && tmp_error->code == G_IO_ERROR_NOT_FOUND) {
-            // TODO the bus address was set incorrectly so log a warning
-            g_clear_error(&tmp_error);
-        } else {
+    PlayerctlSource source = manager->priv->source;
+
+    if (source == PLAYERCTL_SOURCE_NONE || source == PLAYERCTL_SOURCE_DBUS_SESSION) {
+        manager->priv->session_proxy = manager_bus_proxy_new(G_BUS_TYPE_SESSION, &tmp_error);
+        if (tmp_error != NULL) {
             g_propagate_error(error, tmp_error);
             return FALSE;
         }
     }
-    manager->priv->system_proxy = g_dbus_proxy_new_for_bus_sync(
-        G_BUS_TYPE_SYSTEM, G_DBUS_PROXY_FLAGS_NONE, NULL, "org.freedesktop.DBus",
-        "/org/freedesktop/DBus", "org.freedesktop.DBus", NULL, &tmp_error);
-    if (tmp_error != NULL) {
-        if (tmp_error->domain == G_IO_ERROR && tmp_error->code == G_IO_ERROR_NOT_FOUND) {
-            // TODO the bus address was set incorrectly so log a warning
-            g_clear_error(&tmp_error);
-        } else {
+
+    if (source == PLAYERCTL_SOURCE_NONE || source == PLAYERCTL_SOURCE_DBUS_SYSTEM) {
+        manager->priv->system_proxy = manager_bus_proxy_new(G_BUS_TYPE_SYSTEM, &tmp_error);
+        if (tmp_error != NULL) {
             g_propagate_error(error, tmp_error);
             return FALSE;
         }
     }
 
-    manager->priv->player_names = playerctl_list_players(&tmp_error);
+    manager->priv->player_names = pctl_list_players(source, manager->priv->timeout, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(error, tmp_error);
         return FALSE;
     }
 
+    for (GList *l = manager->priv->player_names; l != NULL; l = l->next) {
+        manager_index_player_name(manager, l);
+    }
+
     if (manager->priv->session_proxy) {
         g_signal_connect(G_DBUS_PROXY(manager->priv->session_proxy), "g-signal",
                          G_CALLBACK(dbus_name_owner_changed_callback), manager);
@@ -387,10 +691,27 @@ static void playerctl_player_manager_initable_iface_init(GInitableIface *iface)
  * Returns:(transfer full): A new #PlayerctlPlayerManager.
  */
 PlayerctlPlayerManager *playerctl_player_manager_new(GError **err) {
+    return playerctl_player_manager_new_for_source(PLAYERCTL_SOURCE_NONE, err);
+}
+
+/**
+ * playerctl_player_manager_new_for_source:
+ * @source: The source of the players to watch, or %PLAYERCTL_SOURCE_NONE to
+ * watch all sources.
+ * @err:(allow-none): The location of a GError or NULL.
+ *
+ * Create a new player manager that only watches the players on the given
+ * source. This avoids connecting to buses that are not needed, such as the
+ * system bus, which few players use.
+ *
+ * Returns:(transfer full): A new #PlayerctlPlayerManager.
+ */
+PlayerctlPlayerManager *playerctl_player_manager_new_for_source(PlayerctlSource source,
+                                                                GError **err) {
     GError *tmp_error = NULL;
 
     PlayerctlPlayerManager *manager =
-        g_initable_new(PLAYERCTL_TYPE_PLAYER_MANAGER, NULL, &tmp_error, NULL);
+        g_initable_new(PLAYERCTL_TYPE_PLAYER_MANAGER, NULL, &tmp_error, "source", source, NULL);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
         return NULL;
@@ -409,7 +730,8 @@ PlayerctlPlayerManager *playerctl_player_manager_new(GError **err) {
  * longer be used.
  *
  * Keeps the #PlayerctlPlayerManager:players list of this manager in sorted order which is useful
- * for using this list as a priority queue.
+ * for using this list as a priority queue. A rank function set with
+ * playerctl_player_manager_set_rank_func() takes precedence over the sort function.
  */
 void playerctl_player_manager_set_sort_func(PlayerctlPlayerManager *manager,
                                             GCompareDataFunc sort_func, gpointer sort_data,
@@ -419,7 +741,39 @@ void playerctl_player_manager_set_sort_func(PlayerctlPlayerManager *manager,
     manager->priv->sort_data = sort_data;
     manager->priv->sort_notify = notify;
 
-    manager->priv->players = g_list_sort_with_data(manager->priv->players, sort_func, sort_data);
+    if (manager->priv->rank_func == NULL) {
+        manager->priv->players =
+            g_list_sort_with_data(manager->priv->players, sort_func, sort_data);
+    }
+}
+
+/**
+ * playerctl_player_manager_set_rank_func:
+ * @manager: A #PlayerctlPlayerManager.
+ * @rank_func:(allow-none): The function that gives the rank of a player, or
+ * NULL to stop ordering the players by rank.
+ * @rank_data:(allow-none): User data for the rank function.
+ * @notify:(allow-none): A function to notify when the rank function will no
+ * longer be used.
+ *
+ * Keeps the #PlayerctlPlayerManager:players list of this manager ordered by
+ * rank with the lowest rank first. The rank of a player is computed once when
+ * it is managed, so moving a player to the top does not sort the list again.
+ * Use this instead of playerctl_player_manager_set_sort_func() when the
+ * priority of a player does not change while it is managed.
+ */
+void playerctl_player_manager_set_rank_func(PlayerctlPlayerManager *manager,
+                                            PlayerctlPlayerRankFunc rank_func,
+                                            gpointer rank_data, GDestroyNotify notify) {
+    if (manager->priv->rank_notify != NULL) {
+        manager->priv->rank_notify(manager->priv->rank_data);
+    }
+
+    manager->priv->rank_func = rank_func;
+    manager->priv->rank_data = rank_data;
+    manager->priv->rank_notify = notify;
+
+    manager_rebuild_ranks(manager);
 }
 
 /**
@@ -428,27 +782,47 @@ void playerctl_player_manager_set_sort_func(PlayerctlPlayerManager *manager,
  * @player: A #PlayerctlPlayer in the list of #PlayerctlPlayerManager:players
  *
  * Moves the player to the top of the list of #PlayerctlPlayerManager:players. If this manager has a
- * sort function set with playerctl_player_manager_set_sort_func(), the list of
- * players will be sorted afterward, but will be on top of equal players in the
- * sorted order.
+ * sort function set with playerctl_player_manager_set_sort_func() or a rank
+ * function set with playerctl_player_manager_set_rank_func(), the player will
+ * be on top of equal players in the sorted order.
  */
 void playerctl_player_manager_move_player_to_top(PlayerctlPlayerManager *manager,
                                                  PlayerctlPlayer *player) {
-    GList *l;
-    for (l = manager->priv->players; l != NULL; l = l->next) {
-        PlayerctlPlayer *current = PLAYERCTL_PLAYER(l->data);
-        if (current == player) {
-            manager->priv->players = g_list_remove_link(manager->priv->players, l);
-            manager->priv->players = g_list_concat(l, manager->priv->players);
-
-            if (manager->priv->sort_func) {
-                manager->priv->players = g_list_sort_with_data(
-                    manager->priv->players, manager->priv->sort_func, manager->priv->sort_data);
-            }
+    GList *l = g_hash_table_lookup(manager->priv->players_index, player);
+    if (l == NULL || l == manager->priv->players) {
+        return;
+    }
 
-            break;
+    if (manager->priv->rank_func != NULL) {
+        guint index = 0;
+        if (manager_find_rank_bucket(manager, manager_player_rank(manager, player), &index) &&
+            g_array_index(manager->priv->rank_buckets, struct rank_bucket, index).head == l) {
+            // already on top of its rank
+            return;
         }
     }
+
+    manager_unlink_player_link(manager, l);
+    manager_insert_player_link(manager, l);
+}
+
+/**
+ * playerctl_player_manager_lookup_player:
+ * @manager: A #PlayerctlPlayerManager
+ * @player_name: The #PlayerctlPlayerName of the player to look up
+ *
+ * Looks up the managed player with the instance and source of the given name.
+ *
+ * Returns:(transfer none)(nullable): The managed #PlayerctlPlayer for the
+ * name, or NULL if no player with that name is managed.
+ */
+PlayerctlPlayer *playerctl_player_manager_lookup_player(PlayerctlPlayerManager *manager,
+                                                        PlayerctlPlayerName *player_name) {
+    g_return_val_if_fail(manager != NULL, NULL);
+    g_return_val_if_fail(player_name != NULL, NULL);
+
+    GList *l = g_hash_table_lookup(manager->priv->players_by_name, player_name);
+    return l != NULL ? PLAYERCTL_PLAYER(l->data) : NULL;
 }
 
 /**
@@ -469,21 +843,28 @@ void playerctl_player_manager_manage_player(PlayerctlPlayerManager *manager,
         return;
     }
 
-    GList *l = NULL;
-    for (l = manager->priv->players; l != NULL; l = l->next) {
-        PlayerctlPlayer *current = PLAYERCTL_PLAYER(l->data);
-        if (player == current) {
-            return;
-        }
+    if (g_hash_table_contains(manager->priv->players_index, player)) {
+        return;
     }
 
-    if (manager->priv->sort_func) {
-        manager->priv->players = g_list_insert_sorted_with_data(
-            manager->priv->players, player, manager->priv->sort_func, manager->priv->sort_data);
-    } else {
-        manager->priv->players = g_list_prepend(manager->priv->players, player);
+    if (manager->priv->rank_func != NULL) {
+        gint rank = manager->priv->rank_func(player, manager->priv->rank_data);
+        g_hash_table_insert(manager->priv->player_ranks, player, GINT_TO_POINTER(rank));
     }
 
+    if (manager->priv->timeout >= 0) {
+        gint timeout = -1;
+        g_object_get(player, "timeout", &timeout, NULL);
+        if (timeout < 0) {
+            g_object_set(player, "timeout", manager->priv->timeout, NULL);
+        }
+    }
+
+    GList *link = g_list_alloc();
+    link->data = player;
+    manager_insert_player_link(manager, link);
+    manager_index_player(manager, link);
+
     g_object_ref(player);
     g_debug("player appeared: %s", pctl_player_get_instance(player));
     g_signal_emit(manager, connection_signals[PLAYER_APPEARED], 0, player);
@@ -85,10 +85,25 @@ struct _PlayerctlPlayerManagerClass {
     GObjectClass parent_class;
 };
 
+/**
+ * PlayerctlPlayerRankFunc:
+ * @player: The #PlayerctlPlayer to rank
+ * @user_data: The user data passed to playerctl_player_manager_set_rank_func()
+ *
+ * Gets the priority of a player for ordering the
+ * #PlayerctlPlayerManager:players. Players with a lower rank come first.
+ *
+ * Returns: The rank of the player
+ */
+typedef gint (*PlayerctlPlayerRankFunc)(PlayerctlPlayer *player, gpointer user_data);
+
 GType playerctl_player_manager_get_type(void);
 
 PlayerctlPlayerManager *playerctl_player_manager_new(GError **err);
 
+PlayerctlPlayerManager *playerctl_player_manager_new_for_source(PlayerctlSource source,
+                                                                GError **err);
+
 void playerctl_player_manager_manage_player(PlayerctlPlayerManager *manager,
                                             PlayerctlPlayer *player);
 
@@ -96,7 +111,14 @@ void playerctl_player_manager_set_sort_func(PlayerctlPlayerManager *manager,
                                             GCompareDataFunc sort_func, gpointer sort_data,
                                             GDestroyNotify notify);
 
+void playerctl_player_manager_set_rank_func(PlayerctlPlayerManager *manager,
+                                            PlayerctlPlayerRankFunc rank_func,
+                                            gpointer rank_data, GDestroyNotify notify);
+
 void playerctl_player_manager_move_player_to_top(PlayerctlPlayerManager *manager,
                                                  PlayerctlPlayer *player);
 
+PlayerctlPlayer *playerctl_player_manager_lookup_player(PlayerctlPlayerManager *manager,
+                                                        PlayerctlPlayerName *player_name);
+
 #endif /* __PLAYERCTL_PLAYER_MANAGER_H__ */
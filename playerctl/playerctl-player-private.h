@@ -20,10 +20,31 @@
 #ifndef __PLAYERCTL_PLAYER_PRIVATE_H__
 #define __PLAYERCTL_PLAYER_PRIVATE_H__
 
+#include "playerctl-metadata.h"
 #include "playerctl-player.h"
 
 char *pctl_player_get_instance(PlayerctlPlayer *player);
 
+PlayerctlSource pctl_player_get_source(PlayerctlPlayer *player);
+
+/*
+ * Gets the cached position in microseconds along with the CLOCK_MONOTONIC time
+ * in microseconds at which the player was at that position. While the player
+ * is playing, the position advances from the anchor at the playback rate.
+ */
+gint64 pctl_player_get_position_anchor(PlayerctlPlayer *player, gint64 *monotonic_time);
+
+struct pctl_metadata *pctl_player_get_metadata_model(PlayerctlPlayer *player, GError **err);
+
+gboolean pctl_player_write_metadata_table(PlayerctlPlayer *player, gint fd, GError **err);
+
+/*
+ * Lists the players like playerctl_list_players_for_source(), giving up on a
+ * bus that does not answer within the timeout in milliseconds (-1 for the
+ * default).
+ */
+GList *pctl_list_players(PlayerctlSource source, gint timeout, GError **err);
+
 gint player_name_string_compare_func(gconstpointer a, gconstpointer b, gpointer user_data);
 
 gint player_name_compare_func(gconstpointer a, gconstpointer b, gpointer user_data);
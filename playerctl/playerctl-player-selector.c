@@ -0,0 +1,245 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors.
+ */
+
+#include "playerctl-player-selector.h"
+
+#include <string.h>
+
+#define ANY_PLAYER_NAME "%any"
+
+/*
+ * A compiled list of player names. Each name maps to the position of its first
+ * occurrence in the list so an instance can be matched by looking up the
+ * instance and each of its prefixes that end before a dot.
+ */
+struct name_patterns {
+    GHashTable *positions;  // name -> position + 1
+    gint any_position;      // position of the first "%any", or G_MAXINT
+    gboolean empty;
+};
+
+struct _PlayerctlPlayerSelector {
+    struct name_patterns players;
+    struct name_patterns ignored;
+    gint ref_count;
+};
+
+static void name_patterns_init(struct name_patterns *patterns, const gchar *const *names) {
+    patterns->positions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    patterns->any_position = G_MAXINT;
+    patterns->empty = TRUE;
+
+    if (names == NULL) {
+        return;
+    }
+
+    for (gint i = 0; names[i] != NULL; ++i) {
+        patterns->empty = FALSE;
+
+        if (g_strcmp0(names[i], ANY_PLAYER_NAME) == 0) {
+            if (patterns->any_position == G_MAXINT) {
+                patterns->any_position = i;
+            }
+            continue;
+        }
+
+        if (!g_hash_table_contains(patterns->positions, names[i])) {
+            g_hash_table_insert(patterns->positions, g_strdup(names[i]), GINT_TO_POINTER(i + 1));
+        }
+    }
+}
+
+static void name_patterns_clear(struct name_patterns *patterns) {
+    g_hash_table_destroy(patterns->positions);
+}
+
+static gint name_patterns_lookup_one(const struct name_patterns *patterns, const gchar *name) {
+    return GPOINTER_TO_INT(g_hash_table_lookup(patterns->positions, name)) - 1;
+}
+
+/*
+ * Returns the first position of a name that matches the instance exactly or
+ * as a prefix followed by a dot, not counting "%any", or -1 if there is none.
+ */
+static gint name_patterns_lookup(const struct name_patterns *patterns, const gchar *instance) {
+    if (g_hash_table_size(patterns->positions) == 0) {
+        return -1;
+    }
+
+    gint position = name_patterns_lookup_one(patterns, instance);
+
+    const gchar *dot = strchr(instance, '.');
+    if (dot == NULL) {
+        return position;
+    }
+
+    gchar *prefix = g_strdup(instance);
+    for (; dot != NULL; dot = strchr(dot + 1, '.')) {
+        prefix[dot - instance] = '\0';
+        gint prefix_position = name_patterns_lookup_one(patterns, prefix);
+        if (prefix_position >= 0 && (position < 0 || prefix_position < position)) {
+            position = prefix_position;
+        }
+        prefix[dot - instance] = '.';
+    }
+    g_free(prefix);
+
+    return position;
+}
+
+static gboolean name_patterns_match(const struct name_patterns *patterns,
+                                    const gchar *instance) {
+    return patterns->any_position != G_MAXINT ||
+           g_strcmp0(instance, ANY_PLAYER_NAME) == 0 ||
+           name_patterns_lookup(patterns, instance) >= 0;
+}
+
+/**
+ * playerctl_player_selector_new:
+ * @player_names:(array zero-terminated=1)(allow-none): The names of the
+ * players to select in order of priority, or %NULL to select all players.
+ * @ignored_player_names:(array zero-terminated=1)(allow-none): The names of
+ * the players to ignore, or %NULL to not ignore any players.
+ *
+ * Compiles the lists of names into a selector that can match and rank player
+ * instances without walking the lists.
+ *
+ * Returns:(transfer full): A new #PlayerctlPlayerSelector.
+ */
+PlayerctlPlayerSelector *playerctl_player_selector_new(const gchar *const *player_names,
+                                                       const gchar *const *ignored_player_names) {
+    PlayerctlPlayerSelector *selector = g_slice_new0(PlayerctlPlayerSelector);
+    name_patterns_init(&selector->players, player_names);
+    name_patterns_init(&selector->ignored, ignored_player_names);
+    selector->ref_count = 1;
+    return selector;
+}
+
+/**
+ * playerctl_player_selector_ref:
+ * @selector: A #PlayerctlPlayerSelector
+ *
+ * Increases the reference count of @selector by one.
+ *
+ * Returns:(transfer full): The @selector that was passed in.
+ */
+PlayerctlPlayerSelector *playerctl_player_selector_ref(PlayerctlPlayerSelector *selector) {
+    g_return_val_if_fail(selector != NULL, NULL);
+    g_atomic_int_inc(&selector->ref_count);
+    return selector;
+}
+
+/**
+ * playerctl_player_selector_unref:
+ * @selector:(allow-none): A #PlayerctlPlayerSelector
+ *
+ * Decreases the reference count of @selector by one and frees it when the
+ * count drops to zero. If @selector is %NULL, it simply returns.
+ */
+void playerctl_player_selector_unref(PlayerctlPlayerSelector *selector) {
+    if (selector == NULL) {
+        return;
+    }
+
+    if (g_atomic_int_dec_and_test(&selector->ref_count)) {
+        name_patterns_clear(&selector->players);
+        name_patterns_clear(&selector->ignored);
+        g_slice_free(PlayerctlPlayerSelector, selector);
+    }
+}
+
+/**
+ * playerctl_player_selector_matches:
+ * @selector: A #PlayerctlPlayerSelector
+ * @instance: The instance name of a player such as "vlc.instance123"
+ *
+ * Checks whether the player is selected. A player is selected when it is not
+ * matched by a name in the ignored list and, if the list of players to select
+ * is not empty, it is matched by a name in that list.
+ *
+ * Returns: Whether the player is selected.
+ */
+gboolean playerctl_player_selector_matches(PlayerctlPlayerSelector *selector,
+                                           const gchar *instance) {
+    g_return_val_if_fail(selector != NULL, FALSE);
+    g_return_val_if_fail(instance != NULL, FALSE);
+
+    if (!selector->ignored.empty && name_patterns_match(&selector->ignored, instance)) {
+        return FALSE;
+    }
+
+    if (!selector->players.empty && !name_patterns_match(&selector->players, instance)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ * playerctl_player_selector_get_rank:
+ * @selector: A #PlayerctlPlayerSelector
+ * @instance: The instance name of a player such as "vlc.instance123"
+ *
+ * Gets the priority of the player, which is the position of the first name in
+ * the list of players to select that matches it. Players that are not matched
+ * by a name have the position of the first "%any" in the list, or %G_MAXINT if
+ * there is none. A lower rank means a higher priority.
+ *
+ * Returns: The rank of the player.
+ */
+gint playerctl_player_selector_get_rank(PlayerctlPlayerSelector *selector,
+                                        const gchar *instance) {
+    g_return_val_if_fail(selector != NULL, G_MAXINT);
+    g_return_val_if_fail(instance != NULL, G_MAXINT);
+
+    gint position = name_patterns_lookup(&selector->players, instance);
+    if (position < 0) {
+        return selector->players.any_position;
+    }
+
+    return position;
+}
+
+/**
+ * playerctl_player_selector_compare:
+ * @selector: A #PlayerctlPlayerSelector
+ * @instance_a: The instance name of a player
+ * @instance_b: The instance name of another player
+ *
+ * Compares two players by their rank. See
+ * playerctl_player_selector_get_rank().
+ *
+ * Returns: A negative value if the first player has a higher priority, a
+ * positive value if the second player has a higher priority, or zero if they
+ * have the same priority.
+ */
+gint playerctl_player_selector_compare(PlayerctlPlayerSelector *selector,
+                                       const gchar *instance_a, const gchar *instance_b) {
+    if (g_strcmp0(instance_a, instance_b) == 0) {
+        return 0;
+    }
+
+    gint rank_a = playerctl_player_selector_get_rank(selector, instance_a);
+    gint rank_b = playerctl_player_selector_get_rank(selector, instance_b);
+
+    return (rank_a > rank_b) - (rank_a < rank_b);
+}
+
+G_DEFINE_BOXED_TYPE(PlayerctlPlayerSelector, playerctl_player_selector,
+                    playerctl_player_selector_ref, playerctl_player_selector_unref);
@@ -0,0 +1,66 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#ifndef __PLAYERCTL_PLAYER_SELECTOR_H__
+#define __PLAYERCTL_PLAYER_SELECTOR_H__
+
+#include <glib-object.h>
+#include <glib.h>
+
+/**
+ * SECTION: playerctl-player-selector
+ * @short_description: Selects and orders players by name.
+ *
+ * A #PlayerctlPlayerSelector is compiled from a list of player names to select
+ * and a list of player names to ignore, in the same form as the `--player` and
+ * `--ignore-player` arguments of the playerctl command line program.
+ *
+ * A name in either list matches a player instance when it is equal to the
+ * instance or when the instance starts with the name followed by a dot, so
+ * "vlc" matches "vlc" and "vlc.instance123". The special name "%any" matches
+ * every player.
+ *
+ * Use playerctl_player_selector_matches() to check whether a player is
+ * selected and playerctl_player_selector_get_rank() to order the selected
+ * players by the position of their name in the list of selected players.
+ */
+
+typedef struct _PlayerctlPlayerSelector PlayerctlPlayerSelector;
+
+#define PLAYERCTL_TYPE_PLAYER_SELECTOR (playerctl_player_selector_get_type())
+
+GType playerctl_player_selector_get_type(void);
+
+PlayerctlPlayerSelector *playerctl_player_selector_new(const gchar *const *player_names,
+                                                       const gchar *const *ignored_player_names);
+
+PlayerctlPlayerSelector *playerctl_player_selector_ref(PlayerctlPlayerSelector *selector);
+
+void playerctl_player_selector_unref(PlayerctlPlayerSelector *selector);
+
+gboolean playerctl_player_selector_matches(PlayerctlPlayerSelector *selector,
+                                           const gchar *instance);
+
+gint playerctl_player_selector_get_rank(PlayerctlPlayerSelector *selector,
+                                        const gchar *instance);
+
+gint playerctl_player_selector_compare(PlayerctlPlayerSelector *selector,
+                                       const gchar *instance_a, const gchar *instance_b);
+
+#endif /* __PLAYERCTL_PLAYER_SELECTOR_H__ */
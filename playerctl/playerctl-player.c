@@ -23,12 +23,18 @@
 #include <glib-object.h>
 #include <playerctl/playerctl-enum-types.h>
 #include <playerctl/playerctl-player-manager.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "playerctl-common.h"
 #include "playerctl-generated.h"
+#include "playerctl-metadata.h"
+#include "playerctl-name-registry.h"
+#include "playerctl-player-private.h"
+#include "playerctl-trace.h"
 
 #define LENGTH(array) (sizeof array / sizeof array[0])
 
@@ -50,6 +56,7 @@ enum {
     PROP_VOLUME,
     PROP_METADATA,
     PROP_POSITION,
+    PROP_RATE,
 
     PROP_CAN_CONTROL,
     PROP_CAN_PLAY,
@@ -58,11 +65,18 @@ enum {
     PROP_CAN_GO_NEXT,
     PROP_CAN_GO_PREVIOUS,
 
+    PROP_COALESCE_WINDOW,
+    PROP_COMMANDS_SENT,
+    PROP_COMMANDS_MERGED,
+
+    PROP_TIMEOUT,
+    PROP_DEADLINE,
+
     N_PROPERTIES
 };
 
 enum {
-    // PROPERTIES_CHANGED,
+    PROPERTIES_CHANGED,
     PLAYBACK_STATUS,
     LOOP_STATUS,
     SHUFFLE,
@@ -82,6 +96,30 @@ static GParamSpec *obj_properties[N_PROPERTIES] = {
 
 static guint connection_signals[LAST_SIGNAL] = {0};
 
+/*
+ * Seeks and volume changes made with the coalescing functions. The first
+ * command is sent right away and opens a window. Commands that arrive during
+ * the window are merged into a target which is sent as one absolute command
+ * when the window ends. The window ends on the thread-default main context of
+ * the caller that opened it.
+ */
+struct coalesce_state {
+    guint window;
+    GSource *source;
+    gboolean has_position;
+    gboolean position_pending;
+    // the expected position at position_monotonic
+    gint64 position;
+    struct timespec position_monotonic;
+    // the sum of the offsets of the pending seeks, sent as one seek without a track id
+    gint64 offset;
+    gboolean has_volume;
+    gboolean volume_pending;
+    gdouble volume;
+    guint sent;
+    guint merged;
+};
+
 struct _PlayerctlPlayerPrivate {
     OrgMprisMediaPlayer2Player *proxy;
     gchar *player_name;
@@ -94,14 +132,30 @@ struct _PlayerctlPlayerPrivate {
     gint64 cached_position;
     gchar *cached_track_id;
     struct timespec cached_position_monotonic;
+    gdouble cached_rate;
+    struct pctl_metadata *metadata;
+    // metadata read from the player when the proxy does not cache it, read again on each use
+    struct pctl_metadata *uncached_metadata;
+    struct coalesce_state coalesce;
+    gint timeout;
+    gint64 deadline;
 };
 
 static inline int64_t timespec_to_usec(const struct timespec *a) {
     return (int64_t)a->tv_sec * 1e+6 + a->tv_nsec / 1000;
 }
 
+/*
+ * Players should not report a rate of zero since they would be paused, so
+ * treat that and a missing rate as normal playback.
+ */
+static gdouble rate_or_default(gdouble rate) {
+    return rate > 0 ? rate : 1.0;
+}
+
 static gint64 calculate_cached_position(PlayerctlPlaybackStatus status,
-                                        struct timespec *position_monotonic, gint64 position) {
+                                        struct timespec *position_monotonic, gint64 position,
+                                        gdouble rate) {
     gint64 offset = 0;
     struct timespec current_time;
 
@@ -109,7 +163,7 @@ static gint64 calculate_cached_position(PlayerctlPlaybackStatus status,
     case PLAYERCTL_PLAYBACK_STATUS_PLAYING:
         clock_gettime(CLOCK_MONOTONIC, &current_time);
         offset = timespec_to_usec(&current_time) - timespec_to_usec(position_monotonic);
-        return position + offset;
+        return position + (gint64)(offset * rate);
     case PLAYERCTL_PLAYBACK_STATUS_PAUSED:
         return position;
     default:
@@ -117,25 +171,7 @@ static gint64 calculate_cached_position(PlayerctlPlaybackStatus status,
     }
 }
 
-static gchar *metadata_get_track_id(GVariant *metadata) {
-    GVariant *track_id_variant =
-        g_variant_lookup_value(metadata, "mpris:trackid", G_VARIANT_TYPE_OBJECT_PATH);
-    if (track_id_variant == NULL) {
-        // XXX some players set this as a string, which is against the protocol,
-        // but a lot of them do it and I don't feel like fixing it on all the
-        // players in the world.
-        g_debug("mpris:trackid is a string, not a D-Bus object reference");
-        track_id_variant = g_variant_lookup_value(metadata, "mpris:trackid", G_VARIANT_TYPE_STRING);
-    }
-
-    if (track_id_variant != NULL) {
-        const gchar *track_id = g_variant_get_string(track_id_variant, NULL);
-        g_variant_unref(track_id_variant);
-        return g_strdup(track_id);
-    }
-
-    return NULL;
-}
+static gboolean player_call_timeout(PlayerctlPlayer *self, gint *timeout, GError **err);
 
 static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
                                                          GVariant *changed_properties,
@@ -144,19 +180,54 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
     g_debug("%s", g_variant_print(changed_properties, TRUE));
     PlayerctlPlayer *self = user_data;
     gchar *instance = self->priv->instance;
+    PCTL_TRACE1(properties_changed_begin, instance);
     g_debug("%s: properties changed", instance);
 
-    // TODO probably need to replace this with an iterator
-    GVariant *metadata = g_variant_lookup_value(changed_properties, "Metadata", NULL);
-    GVariant *playback_status = g_variant_lookup_value(changed_properties, "PlaybackStatus", NULL);
-    GVariant *loop_status = g_variant_lookup_value(changed_properties, "LoopStatus", NULL);
-    GVariant *volume = g_variant_lookup_value(changed_properties, "Volume", NULL);
-    GVariant *shuffle = g_variant_lookup_value(changed_properties, "Shuffle", NULL);
+    GVariant *metadata = NULL;
+    GVariant *playback_status = NULL;
+    GVariant *loop_status = NULL;
+    GVariant *volume = NULL;
+    GVariant *shuffle = NULL;
+    GVariant *rate = NULL;
+
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *value;
+    g_variant_iter_init(&iter, changed_properties);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        GVariant **slot = NULL;
+        if (g_strcmp0(key, "Metadata") == 0) {
+            slot = &metadata;
+        } else if (g_strcmp0(key, "PlaybackStatus") == 0) {
+            slot = &playback_status;
+        } else if (g_strcmp0(key, "LoopStatus") == 0) {
+            slot = &loop_status;
+        } else if (g_strcmp0(key, "Volume") == 0) {
+            slot = &volume;
+        } else if (g_strcmp0(key, "Shuffle") == 0) {
+            slot = &shuffle;
+        } else if (g_strcmp0(key, "Rate") == 0) {
+            slot = &rate;
+        }
+
+        if (slot != NULL && *slot == NULL) {
+            *slot = value;
+        } else {
+            g_variant_unref(value);
+        }
+    }
+
+    // collects the properties that were emitted for the properties-changed signal
+    PlayerctlPlayerPropertyFlags changed = 0;
+    GVariantDict changed_values;
+    g_variant_dict_init(&changed_values, NULL);
 
     if (shuffle != NULL) {
         gboolean shuffle_value = g_variant_get_boolean(shuffle);
         g_debug("%s: shuffle value set to %s", instance, shuffle_value ? "true" : "false");
         g_signal_emit(self, connection_signals[SHUFFLE], 0, shuffle_value);
+        changed |= PLAYERCTL_PLAYER_PROPERTY_SHUFFLE;
+        g_variant_dict_insert_value(&changed_values, "Shuffle", shuffle);
         g_variant_unref(shuffle);
     }
 
@@ -164,27 +235,58 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
         gdouble volume_value = g_variant_get_double(volume);
         g_debug("%s: volume set to %f", instance, volume_value);
         g_signal_emit(self, connection_signals[VOLUME], 0, volume_value);
+        changed |= PLAYERCTL_PLAYER_PROPERTY_VOLUME;
+        g_variant_dict_insert_value(&changed_values, "Volume", volume);
         g_variant_unref(volume);
     }
 
+    if (rate != NULL) {
+        gdouble rate_value = rate_or_default(g_variant_get_double(rate));
+        if (rate_value != self->priv->cached_rate) {
+            g_debug("%s: rate set to %f", instance, rate_value);
+            // the position so far advanced at the previous rate
+            self->priv->cached_position = calculate_cached_position(
+                self->priv->cached_status, &self->priv->cached_position_monotonic,
+                self->priv->cached_position, self->priv->cached_rate);
+            clock_gettime(CLOCK_MONOTONIC, &self->priv->cached_position_monotonic);
+            self->priv->cached_rate = rate_value;
+            changed |= PLAYERCTL_PLAYER_PROPERTY_RATE;
+            g_variant_dict_insert_value(&changed_values, "Rate", rate);
+        }
+        g_variant_unref(rate);
+    }
+
+    for (gsize i = 0; invalidated_properties != NULL && invalidated_properties[i] != NULL; ++i) {
+        if (g_strcmp0(invalidated_properties[i], "Metadata") == 0) {
+            g_clear_pointer(&self->priv->metadata, pctl_metadata_free);
+        }
+    }
+
     gboolean track_id_invalidated = FALSE;
     if (metadata != NULL) {
+        // parse the new metadata once so lookups don't have to scan it
+        pctl_metadata_free(self->priv->metadata);
+        self->priv->metadata = pctl_metadata_new(metadata);
+
         // update the cached track id
-        gchar *track_id = metadata_get_track_id(metadata);
-        if ((track_id == NULL && self->priv->cached_track_id != NULL) ||
-            (track_id != NULL && self->priv->cached_track_id == NULL) ||
-            (g_strcmp0(track_id, self->priv->cached_track_id) != 0)) {
+        const gchar *track_id =
+            self->priv->metadata ? pctl_metadata_get_track_id(self->priv->metadata) : NULL;
+        if (g_strcmp0(track_id, self->priv->cached_track_id) != 0) {
             g_free(self->priv->cached_track_id);
             g_debug("%s: track id updated to %s", instance, track_id);
-            self->priv->cached_track_id = track_id;
+            self->priv->cached_track_id = g_strdup(track_id);
             track_id_invalidated = TRUE;
-        } else {
-            g_free(track_id);
+            // a pending seek was meant for the previous track
+            self->priv->coalesce.has_position = FALSE;
+            self->priv->coalesce.position_pending = FALSE;
+            self->priv->coalesce.offset = 0;
         }
 
         g_debug("%s: metadata changed", instance);
         // g_debug("metadata: %s", g_variant_print(metadata, TRUE));
         g_signal_emit(self, connection_signals[METADATA], 0, metadata);
+        changed |= PLAYERCTL_PLAYER_PROPERTY_METADATA;
+        g_variant_dict_insert_value(&changed_values, "Metadata", metadata);
         g_variant_unref(metadata);
     }
 
@@ -198,10 +300,14 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
         // changes so we have to get it from the interface. We should
         // definitely go fix this bug on the players.
         g_debug("Playback status not set on track change; getting status from interface instead");
-        GVariant *call_reply = g_dbus_proxy_call_sync(
-            G_DBUS_PROXY(self->priv->proxy), "org.freedesktop.DBus.Properties.Get",
-            g_variant_new("(ss)", "org.mpris.MediaPlayer2.Player", "PlaybackStatus"),
-            G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL);
+        gint timeout = -1;
+        GVariant *call_reply = NULL;
+        if (player_call_timeout(self, &timeout, NULL)) {
+            call_reply = g_dbus_proxy_call_sync(
+                G_DBUS_PROXY(self->priv->proxy), "org.freedesktop.DBus.Properties.Get",
+                g_variant_new("(ss)", "org.mpris.MediaPlayer2.Player", "PlaybackStatus"),
+                G_DBUS_CALL_FLAGS_NONE, timeout, NULL, NULL);
+        }
 
         if (call_reply != NULL) {
             GVariant *call_reply_box = g_variant_get_child_value(call_reply, 0);
@@ -229,6 +335,8 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
             }
             g_debug("%s: loop status set to %s", instance, g_quark_to_string(quark));
             g_signal_emit(self, connection_signals[LOOP_STATUS], quark, status);
+            changed |= PLAYERCTL_PLAYER_PROPERTY_LOOP_STATUS;
+            g_variant_dict_insert_value(&changed_values, "LoopStatus", loop_status);
         }
 
         g_variant_unref(loop_status);
@@ -253,7 +361,7 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
                 quark = g_quark_from_string("paused");
                 self->priv->cached_position = calculate_cached_position(
                     self->priv->cached_status, &self->priv->cached_position_monotonic,
-                    self->priv->cached_position);
+                    self->priv->cached_position, self->priv->cached_rate);
                 // DEPRECATED
                 g_signal_emit(self, connection_signals[PAUSE], 0);
                 break;
@@ -268,6 +376,8 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
             if (self->priv->cached_status != status) {
                 self->priv->cached_status = status;
                 g_signal_emit(self, connection_signals[PLAYBACK_STATUS], quark, status);
+                changed |= PLAYERCTL_PLAYER_PROPERTY_PLAYBACK_STATUS;
+                g_variant_dict_insert_value(&changed_values, "PlaybackStatus", playback_status);
             }
         } else {
             g_debug("%s: got unknown playback state: %s", instance, status_str);
@@ -275,6 +385,16 @@ static void playerctl_player_properties_changed_callback(GDBusProxy *_proxy,
 
         g_variant_unref(playback_status);
     }
+
+    if (changed != 0) {
+        GVariant *values = g_variant_ref_sink(g_variant_dict_end(&changed_values));
+        g_signal_emit(self, connection_signals[PROPERTIES_CHANGED], 0, changed, values);
+        g_variant_unref(values);
+    } else {
+        g_variant_dict_clear(&changed_values);
+    }
+
+    PCTL_TRACE2(properties_changed_end, instance, changed);
 }
 
 static void playerctl_player_seeked_callback(GDBusProxy *_proxy, gint64 position,
@@ -288,6 +408,8 @@ static void playerctl_player_seeked_callback(GDBusProxy *_proxy, gint64 position
 
 static void playerctl_player_initable_iface_init(GInitableIface *iface);
 
+static gboolean coalesce_flush(PlayerctlPlayer *self);
+
 G_DEFINE_TYPE_WITH_CODE(PlayerctlPlayer, playerctl_player, G_TYPE_OBJECT,
                         G_ADD_PRIVATE(PlayerctlPlayer)
                             G_IMPLEMENT_INTERFACE(G_TYPE_INITABLE,
@@ -297,6 +419,62 @@ G_DEFINE_TYPE_WITH_CODE(PlayerctlPlayer, playerctl_player, G_TYPE_OBJECT,
 G_DEFINE_QUARK(playerctl-player-error-quark, playerctl_player_error);
 // clang-format on
 
+/*
+ * Gets the timeout for the next call to the player, which is the smaller of
+ * the timeout and the time remaining until the deadline. Fails if the
+ * deadline has passed.
+ */
+static gboolean player_call_timeout(PlayerctlPlayer *self, gint *timeout, GError **err) {
+    gint call_timeout = self->priv->timeout;
+
+    if (self->priv->deadline > 0) {
+        gint64 remaining =
+            (self->priv->deadline - g_get_monotonic_time()) / G_TIME_SPAN_MILLISECOND;
+        if (remaining <= 0) {
+            g_set_error(err, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                        "Deadline exceeded before calling the player");
+            return FALSE;
+        }
+        if (call_timeout < 0 || remaining < call_timeout) {
+            call_timeout = (gint)MIN(remaining, G_MAXINT);
+        }
+    }
+
+    if (timeout != NULL) {
+        *timeout = call_timeout;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Calls a method of the player interface with the timeout for the call. The
+ * timeout is given to the call rather than set on the proxy, which other
+ * threads may be calling through at the same time.
+ */
+static void player_call_method_sync(PlayerctlPlayer *self, const gchar *method,
+                                    GVariant *parameters, GError **err) {
+    GError *tmp_error = NULL;
+    gint timeout = -1;
+
+    if (!player_call_timeout(self, &timeout, err)) {
+        if (parameters != NULL) {
+            g_variant_unref(g_variant_ref_sink(parameters));
+        }
+        return;
+    }
+
+    GVariant *reply = g_dbus_proxy_call_sync(G_DBUS_PROXY(self->priv->proxy), method, parameters,
+                                             G_DBUS_CALL_FLAGS_NONE, timeout, NULL, &tmp_error);
+    if (reply != NULL) {
+        g_variant_unref(reply);
+    }
+
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+    }
+}
+
 static GVariant *playerctl_player_get_metadata(PlayerctlPlayer *self, GError **err) {
     GVariant *metadata;
     GError *tmp_error = NULL;
@@ -307,10 +485,14 @@ static GVariant *playerctl_player_get_metadata(PlayerctlPlayer *self, GError **e
         // XXX: Ugly spotify workaround. Spotify does not seem to use the property
         // cache. We have to get the properties directly.
         g_debug("Spotify does not use the D-Bus property cache, getting properties directly");
+        gint timeout = -1;
+        if (!player_call_timeout(self, &timeout, err)) {
+            return NULL;
+        }
         GVariant *call_reply = g_dbus_proxy_call_sync(
             G_DBUS_PROXY(self->priv->proxy), "org.freedesktop.DBus.Properties.Get",
             g_variant_new("(ss)", "org.mpris.MediaPlayer2.Player", "Metadata"),
-            G_DBUS_CALL_FLAGS_NONE, -1, NULL, &tmp_error);
+            G_DBUS_CALL_FLAGS_NONE, timeout, NULL, &tmp_error);
 
         if (tmp_error != NULL) {
             g_propagate_error(err, tmp_error);
@@ -328,6 +510,45 @@ static GVariant *playerctl_player_get_metadata(PlayerctlPlayer *self, GError **e
     return metadata;
 }
 
+/*
+ * Gets the parsed metadata of the current track. The model is only kept when
+ * the metadata came from the proxy cache or PropertiesChanged, which drop it
+ * when the track changes. Metadata read directly from the player is read
+ * again on the next call, and the model returned for it is only valid until
+ * then.
+ */
+static struct pctl_metadata *playerctl_player_get_metadata_model(PlayerctlPlayer *self,
+                                                                 GError **err) {
+    GError *tmp_error = NULL;
+
+    if (self->priv->metadata != NULL) {
+        return self->priv->metadata;
+    }
+
+    GVariant *metadata = org_mpris_media_player2_player_dup_metadata(self->priv->proxy);
+    if (metadata != NULL) {
+        self->priv->metadata = pctl_metadata_new(metadata);
+        g_variant_unref(metadata);
+        return self->priv->metadata;
+    }
+
+    metadata = playerctl_player_get_metadata(self, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    g_clear_pointer(&self->priv->uncached_metadata, pctl_metadata_free);
+    if (metadata == NULL) {
+        return NULL;
+    }
+
+    self->priv->uncached_metadata = pctl_metadata_new(metadata);
+    g_variant_unref(metadata);
+
+    return self->priv->uncached_metadata;
+}
+
 static void playerctl_player_set_property(GObject *object, guint property_id, const GValue *value,
                                           GParamSpec *pspec) {
     PlayerctlPlayer *self = PLAYERCTL_PLAYER(object);
@@ -354,6 +575,18 @@ static void playerctl_player_set_property(GObject *object, guint property_id, co
         org_mpris_media_player2_player_set_volume(self->priv->proxy, g_value_get_double(value));
         break;
 
+    case PROP_COALESCE_WINDOW:
+        self->priv->coalesce.window = g_value_get_uint(value);
+        break;
+
+    case PROP_TIMEOUT:
+        self->priv->timeout = g_value_get_int(value);
+        break;
+
+    case PROP_DEADLINE:
+        self->priv->deadline = g_value_get_int64(value);
+        break;
+
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -415,13 +648,12 @@ static void playerctl_player_get_property(GObject *object, guint property_id, GV
 
     case PROP_METADATA: {
         GError *error = NULL;
-        GVariant *metadata = NULL;
-        metadata = playerctl_player_get_metadata(self, &error);
+        struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &error);
         if (error != NULL) {
             g_error("could not get metadata: %s", error->message);
             g_clear_error(&error);
         }
-        g_value_set_variant(value, metadata);
+        g_value_set_variant(value, metadata ? pctl_metadata_get_raw(metadata) : NULL);
         break;
     }
 
@@ -434,13 +666,17 @@ static void playerctl_player_get_property(GObject *object, guint property_id, GV
         break;
 
     case PROP_POSITION: {
-        gint64 position = calculate_cached_position(self->priv->cached_status,
-                                                    &self->priv->cached_position_monotonic,
-                                                    self->priv->cached_position);
+        gint64 position = calculate_cached_position(
+            self->priv->cached_status, &self->priv->cached_position_monotonic,
+            self->priv->cached_position, self->priv->cached_rate);
         g_value_set_int64(value, position);
         break;
     }
 
+    case PROP_RATE:
+        g_value_set_double(value, self->priv->cached_rate);
+        break;
+
     case PROP_CAN_CONTROL:
         if (self->priv->proxy == NULL) {
             g_value_set_boolean(value, FALSE);
@@ -492,6 +728,26 @@ static void playerctl_player_get_property(GObject *object, guint property_id, GV
                             org_mpris_media_player2_player_get_can_go_previous(self->priv->proxy));
         break;
 
+    case PROP_COALESCE_WINDOW:
+        g_value_set_uint(value, self->priv->coalesce.window);
+        break;
+
+    case PROP_COMMANDS_SENT:
+        g_value_set_uint(value, self->priv->coalesce.sent);
+        break;
+
+    case PROP_COMMANDS_MERGED:
+        g_value_set_uint(value, self->priv->coalesce.merged);
+        break;
+
+    case PROP_TIMEOUT:
+        g_value_set_int(value, self->priv->timeout);
+        break;
+
+    case PROP_DEADLINE:
+        g_value_set_int64(value, self->priv->deadline);
+        break;
+
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -511,6 +767,13 @@ static void playerctl_player_constructed(GObject *gobject) {
 static void playerctl_player_dispose(GObject *gobject) {
     PlayerctlPlayer *self = PLAYERCTL_PLAYER(gobject);
 
+    if (self->priv->coalesce.source != NULL) {
+        // send what is left of the window without waiting for the player
+        coalesce_flush(self);
+        g_source_destroy(self->priv->coalesce.source);
+        g_clear_pointer(&self->priv->coalesce.source, g_source_unref);
+    }
+
     g_clear_error(&self->priv->init_error);
     g_clear_object(&self->priv->proxy);
 
@@ -524,6 +787,8 @@ static void playerctl_player_finalize(GObject *gobject) {
     g_free(self->priv->instance);
     g_free(self->priv->cached_track_id);
     g_free(self->priv->bus_name);
+    pctl_metadata_free(self->priv->metadata);
+    pctl_metadata_free(self->priv->uncached_metadata);
 
     G_OBJECT_CLASS(playerctl_player_parent_class)->finalize(gobject);
 }
@@ -603,6 +868,17 @@ static void playerctl_player_class_init(PlayerctlPlayerClass *klass) {
                            "The position in the current track of the player in microseconds", 0,
                            INT64_MAX, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+    /**
+     * PlayerctlPlayer:rate:
+     *
+     * The rate at which the position of the player advances, where 1.0 is
+     * normal playback. The #PlayerctlPlayer:position is extrapolated at this
+     * rate while the player is playing.
+     */
+    obj_properties[PROP_RATE] = g_param_spec_double(
+        "rate", "Player rate", "The rate at which the position of the player advances", 0,
+        G_MAXDOUBLE, 1.0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
     obj_properties[PROP_METADATA] = g_param_spec_variant(
         "metadata", "Player metadata",
         "The metadata of the currently playing track as an array of key-value "
@@ -636,8 +912,76 @@ static void playerctl_player_class_init(PlayerctlPlayerClass *klass) {
         "can-go-previous", "Can go previous", "Whether the player can go to the previous track",
         FALSE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
 
+    obj_properties[PROP_COALESCE_WINDOW] = g_param_spec_uint(
+        "coalesce-window", "Coalesce window",
+        "The time in milliseconds during which seeks and volume changes made with the "
+        "coalescing functions are merged into a single command. Zero sends every command.",
+        0, G_MAXUINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+    obj_properties[PROP_COMMANDS_SENT] = g_param_spec_uint(
+        "commands-sent", "Commands sent",
+        "The number of commands sent to the player by the coalescing functions", 0, G_MAXUINT, 0,
+        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+    obj_properties[PROP_COMMANDS_MERGED] = g_param_spec_uint(
+        "commands-merged", "Commands merged",
+        "The number of commands given to the coalescing functions that were merged into "
+        "another command instead of being sent",
+        0, G_MAXUINT, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * PlayerctlPlayer:timeout:
+     *
+     * The timeout in milliseconds for each call to the player, or -1 to use
+     * the default D-Bus timeout. When the timeout or the
+     * #PlayerctlPlayer:deadline is set, the player is pinged when it is
+     * constructed so a player that does not respond fails to construct.
+     */
+    obj_properties[PROP_TIMEOUT] =
+        g_param_spec_int("timeout", "Timeout",
+                         "The timeout in milliseconds for each call to the player, or -1 for the "
+                         "default timeout",
+                         -1, G_MAXINT, -1,
+                         G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
+    /**
+     * PlayerctlPlayer:deadline:
+     *
+     * The time as given by g_get_monotonic_time() after which calls to the
+     * player fail with %G_IO_ERROR_TIMED_OUT, or 0 for no deadline. Each call
+     * is given the time that remains until the deadline if that is less than
+     * the #PlayerctlPlayer:timeout.
+     */
+    obj_properties[PROP_DEADLINE] = g_param_spec_int64(
+        "deadline", "Deadline",
+        "The monotonic time after which calls to the player fail, or 0 for no deadline", 0,
+        G_MAXINT64, 0, G_PARAM_CONSTRUCT | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+
     g_object_class_install_properties(gobject_class, N_PROPERTIES, obj_properties);
 
+    /**
+     * PlayerctlPlayer::properties-changed:
+     * @player: the player this event was emitted on
+     * @changed: the #PlayerctlPlayerPropertyFlags that changed
+     * @values: an `a{sv}` of the new values keyed by their MPRIS property name
+     *
+     * Emitted once for each change notification from the player after the
+     * signals for the individual properties. @changed contains a flag for each
+     * of those signals that was emitted, so a listener interested in several
+     * properties only has to update once.
+     */
+    connection_signals[PROPERTIES_CHANGED] =
+        g_signal_new("properties-changed",  /* signal_name */
+                     PLAYERCTL_TYPE_PLAYER, /* itype */
+                     G_SIGNAL_RUN_FIRST,    /* signal_flags */
+                     0,                     /* class_offset */
+                     NULL,                  /* accumulator */
+                     NULL,                  /* accu_data */
+                     NULL,                  /* c_marshaller */
+                     G_TYPE_NONE,           /* return_type */
+                     2,                     /* n_params */
+                     playerctl_player_property_flags_get_type(), G_TYPE_VARIANT);
+
     /**
      * PlayerctlPlayer::playback-status:
      * @player: the player this event was emitted on
@@ -829,6 +1173,7 @@ static void playerctl_player_class_init(PlayerctlPlayerClass *klass) {
 
 static void playerctl_player_init(PlayerctlPlayer *self) {
     self->priv = playerctl_player_get_instance_private(self);
+    self->priv->cached_rate = 1.0;
 }
 
 /*
@@ -838,13 +1183,14 @@ static void playerctl_player_init(PlayerctlPlayer *self) {
  * Returns NULL if no matching bus name is found on the bus.
  * Returns an error if there was a problem listing the names on the bus.
  */
-static gchar *bus_name_for_player_name(gchar *name, GBusType bus_type, GError **err) {
+static gchar *bus_name_for_player_name(gchar *name, GBusType bus_type, gint timeout,
+                                       GError **err) {
     gchar *bus_name = NULL;
     GError *tmp_error = NULL;
 
     g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
 
-    GList *names = pctl_list_player_names_on_bus(bus_type, &tmp_error);
+    GList *names = pctl_name_registry_list_player_names(bus_type, timeout, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
         return NULL;
@@ -875,12 +1221,13 @@ static gchar *bus_name_for_player_name(gchar *name, GBusType bus_type, GError **
         pctl_player_name_find_instance(names, name, pctl_bus_type_to_source(bus_type));
     if (instance_match != NULL) {
         g_debug("Getting bus name for player %s by instance match", name);
-        gchar *name = instance_match->data;
-        bus_name = g_strdup_printf(MPRIS_PREFIX "%s", name);
+        PlayerctlPlayerName *name = instance_match->data;
+        bus_name = g_strdup_printf(MPRIS_PREFIX "%s", name->instance);
         pctl_player_name_list_destroy(names);
         return bus_name;
     }
 
+    pctl_player_name_list_destroy(names);
     return NULL;
 }
 
@@ -897,6 +1244,34 @@ static void playerctl_player_name_owner_changed_callback(GObject *object, GParam
     g_free(name_owner);
 }
 
+static gboolean player_ping(PlayerctlPlayer *self, GCancellable *cancellable, GError **err) {
+    GError *tmp_error = NULL;
+    gint timeout = -1;
+
+    if (!player_call_timeout(self, &timeout, err)) {
+        return FALSE;
+    }
+
+    GDBusConnection *connection =
+        g_bus_get_sync(pctl_source_to_bus_type(self->priv->source), NULL, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return FALSE;
+    }
+
+    GVariant *reply = g_dbus_connection_call_sync(
+        connection, self->priv->bus_name, "/org/mpris/MediaPlayer2", "org.freedesktop.DBus.Peer",
+        "Ping", NULL, NULL, G_DBUS_CALL_FLAGS_NONE, timeout, cancellable, &tmp_error);
+    g_object_unref(connection);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return FALSE;
+    }
+
+    g_variant_unref(reply);
+    return TRUE;
+}
+
 static gboolean playerctl_player_initable_init(GInitable *initable, GCancellable *cancellable,
                                                GError **err) {
     GError *tmp_error = NULL;
@@ -920,13 +1295,19 @@ static gboolean playerctl_player_initable_init(GInitable *initable, GCancellable
         return FALSE;
     }
 
+    gint timeout = -1;
+    if (!player_call_timeout(player, &timeout, err)) {
+        return FALSE;
+    }
+
     gchar *bus_name = NULL;
     if (player->priv->instance != NULL) {
         bus_name = g_strdup_printf(MPRIS_PREFIX "%s", player->priv->instance);
     } else if (player->priv->source != PLAYERCTL_SOURCE_NONE) {
         // the source was specified
-        bus_name = bus_name_for_player_name(
-            player->priv->player_name, pctl_source_to_bus_type(player->priv->source), &tmp_error);
+        bus_name = bus_name_for_player_name(player->priv->player_name,
+                                            pctl_source_to_bus_type(player->priv->source),
+                                            timeout, &tmp_error);
         if (tmp_error) {
             g_propagate_error(err, tmp_error);
             return FALSE;
@@ -935,8 +1316,8 @@ static gboolean playerctl_player_initable_init(GInitable *initable, GCancellable
         // the source was not specified
         const GBusType bus_types[] = {G_BUS_TYPE_SESSION, G_BUS_TYPE_SYSTEM};
         for (int i = 0; i < LENGTH(bus_types); ++i) {
-            bus_name =
-                bus_name_for_player_name(player->priv->player_name, bus_types[i], &tmp_error);
+            bus_name = bus_name_for_player_name(player->priv->player_name, bus_types[i], timeout,
+                                                &tmp_error);
             if (tmp_error != NULL) {
                 if (tmp_error->domain == G_IO_ERROR && tmp_error->code == G_IO_ERROR_NOT_FOUND) {
                     g_debug("Bus address set incorrectly, cannot get bus");
@@ -959,6 +1340,14 @@ static gboolean playerctl_player_initable_init(GInitable *initable, GCancellable
     }
     player->priv->bus_name = bus_name;
 
+    if (player->priv->timeout >= 0 || player->priv->deadline > 0) {
+        // loading the properties of the proxy cannot be given a timeout, so
+        // make sure the player answers in time before creating it
+        if (!player_ping(player, cancellable, err)) {
+            return FALSE;
+        }
+    }
+
     /* org.mpris.MediaPlayer2.{NAME}[.{INSTANCE}] */
     int offset = strlen(MPRIS_PREFIX);
     gchar **split = g_strsplit(bus_name + offset, ".", 2);
@@ -968,7 +1357,7 @@ static gboolean playerctl_player_initable_init(GInitable *initable, GCancellable
 
     player->priv->proxy = org_mpris_media_player2_player_proxy_new_for_bus_sync(
         pctl_source_to_bus_type(player->priv->source), G_DBUS_PROXY_FLAGS_NONE, bus_name,
-        "/org/mpris/MediaPlayer2", NULL, &tmp_error);
+        "/org/mpris/MediaPlayer2", cancellable, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
         return FALSE;
@@ -979,6 +1368,8 @@ static gboolean playerctl_player_initable_init(GInitable *initable, GCancellable
     player->priv->cached_position =
         org_mpris_media_player2_player_get_position(player->priv->proxy);
     clock_gettime(CLOCK_MONOTONIC, &player->priv->cached_position_monotonic);
+    player->priv->cached_rate =
+        rate_or_default(org_mpris_media_player2_player_get_rate(player->priv->proxy));
 
     const gchar *playback_status_str =
         org_mpris_media_player2_player_get_playback_status(player->priv->proxy);
@@ -1014,20 +1405,48 @@ static void playerctl_player_initable_iface_init(GInitableIface *iface) {
  * Returns:(transfer full) (element-type PlayerctlPlayerName): A list of player names.
  */
 GList *playerctl_list_players(GError **err) {
+    return playerctl_list_players_for_source(PLAYERCTL_SOURCE_NONE, err);
+}
+
+/**
+ * playerctl_list_players_for_source:
+ * @source: The source to list the players of, or %PLAYERCTL_SOURCE_NONE to
+ * list the players of all sources
+ * @err: The location of a GError or NULL
+ *
+ * Lists the players that can be controlled by Playerctl on the given source.
+ * Only the bus of the source is connected to.
+ *
+ * Returns:(transfer full) (element-type PlayerctlPlayerName): A list of player names.
+ */
+GList *playerctl_list_players_for_source(PlayerctlSource source, GError **err) {
+    return pctl_list_players(source, -1, err);
+}
+
+GList *pctl_list_players(PlayerctlSource source, gint timeout, GError **err) {
     GError *tmp_error = NULL;
+    GList *session_players = NULL;
+    GList *system_players = NULL;
 
     g_return_val_if_fail(err == NULL || *err == NULL, NULL);
 
-    GList *session_players = pctl_list_player_names_on_bus(G_BUS_TYPE_SESSION, &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(err, tmp_error);
-        return NULL;
+    if (source == PLAYERCTL_SOURCE_NONE || source == PLAYERCTL_SOURCE_DBUS_SESSION) {
+        session_players =
+            pctl_name_registry_list_player_names(G_BUS_TYPE_SESSION, timeout, &tmp_error);
+        if (tmp_error != NULL) {
+            g_propagate_error(err, tmp_error);
+            return NULL;
+        }
     }
 
-    GList *system_players = pctl_list_player_names_on_bus(G_BUS_TYPE_SYSTEM, &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(err, tmp_error);
-        return NULL;
+    if (source == PLAYERCTL_SOURCE_NONE || source == PLAYERCTL_SOURCE_DBUS_SYSTEM) {
+        system_players =
+            pctl_name_registry_list_player_names(G_BUS_TYPE_SYSTEM, timeout, &tmp_error);
+        if (tmp_error != NULL) {
+            pctl_player_name_list_destroy(session_players);
+            g_propagate_error(err, tmp_error);
+            return NULL;
+        }
     }
 
     GList *players = g_list_concat(session_players, system_players);
@@ -1146,22 +1565,16 @@ void playerctl_player_on(PlayerctlPlayer *self, const gchar *event, GClosure *ca
     return;
 }
 
-#define PLAYER_COMMAND_FUNC(COMMAND)                                                           \
-    GError *tmp_error = NULL;                                                                  \
-                                                                                               \
-    g_return_if_fail(self != NULL);                                                            \
-    g_return_if_fail(err == NULL || *err == NULL);                                             \
-                                                                                               \
-    if (self->priv->init_error != NULL) {                                                      \
-        g_propagate_error(err, g_error_copy(self->priv->init_error));                          \
-        return;                                                                                \
-    }                                                                                          \
-                                                                                               \
-    org_mpris_media_player2_player_call_##COMMAND##_sync(self->priv->proxy, NULL, &tmp_error); \
-                                                                                               \
-    if (tmp_error != NULL) {                                                                   \
-        g_propagate_error(err, tmp_error);                                                     \
-    }
+#define PLAYER_COMMAND_FUNC(METHOD)                                   \
+    g_return_if_fail(self != NULL);                                   \
+    g_return_if_fail(err == NULL || *err == NULL);                    \
+                                                                      \
+    if (self->priv->init_error != NULL) {                             \
+        g_propagate_error(err, g_error_copy(self->priv->init_error)); \
+        return;                                                       \
+    }                                                                 \
+                                                                      \
+    player_call_method_sync(self, METHOD, NULL, err);
 
 /**
  * playerctl_player_play_pause:
@@ -1171,7 +1584,7 @@ void playerctl_player_on(PlayerctlPlayer *self, const gchar *event, GClosure *ca
  * Command the player to play if it is paused or pause if it is playing
  */
 void playerctl_player_play_pause(PlayerctlPlayer *self, GError **err) {
-    PLAYER_COMMAND_FUNC(play_pause);
+    PLAYER_COMMAND_FUNC("PlayPause");
 }
 
 /**
@@ -1183,8 +1596,6 @@ void playerctl_player_play_pause(PlayerctlPlayer *self, GError **err) {
  * Command the player to open given URI
  */
 void playerctl_player_open(PlayerctlPlayer *self, gchar *uri, GError **err) {
-    GError *tmp_error = NULL;
-
     g_return_if_fail(self != NULL);
     g_return_if_fail(err == NULL || *err == NULL);
 
@@ -1192,14 +1603,8 @@ void playerctl_player_open(PlayerctlPlayer *self, gchar *uri, GError **err) {
         g_propagate_error(err, g_error_copy(self->priv->init_error));
         return;
     }
-    org_mpris_media_player2_player_call_open_uri_sync(self->priv->proxy, uri, NULL, &tmp_error);
-
-    if (tmp_error != NULL) {
-        g_propagate_error(err, tmp_error);
-        return;
-    }
 
-    return;
+    player_call_method_sync(self, "OpenUri", g_variant_new("(s)", uri), err);
 }
 
 /**
@@ -1210,7 +1615,7 @@ void playerctl_player_open(PlayerctlPlayer *self, gchar *uri, GError **err) {
  * Command the player to play
  */
 void playerctl_player_play(PlayerctlPlayer *self, GError **err) {
-    PLAYER_COMMAND_FUNC(play);
+    PLAYER_COMMAND_FUNC("Play");
 }
 
 /**
@@ -1221,7 +1626,7 @@ void playerctl_player_play(PlayerctlPlayer *self, GError **err) {
  * Command the player to pause
  */
 void playerctl_player_pause(PlayerctlPlayer *self, GError **err) {
-    PLAYER_COMMAND_FUNC(pause);
+    PLAYER_COMMAND_FUNC("Pause");
 }
 
 /**
@@ -1232,7 +1637,7 @@ void playerctl_player_pause(PlayerctlPlayer *self, GError **err) {
  * Command the player to stop
  */
 void playerctl_player_stop(PlayerctlPlayer *self, GError **err) {
-    PLAYER_COMMAND_FUNC(stop);
+    PLAYER_COMMAND_FUNC("Stop");
 }
 
 /**
@@ -1244,8 +1649,6 @@ void playerctl_player_stop(PlayerctlPlayer *self, GError **err) {
  * Command the player to seek forward by offset given in microseconds.
  */
 void playerctl_player_seek(PlayerctlPlayer *self, gint64 offset, GError **err) {
-    GError *tmp_error = NULL;
-
     g_return_if_fail(self != NULL);
     g_return_if_fail(err == NULL || *err == NULL);
 
@@ -1254,14 +1657,7 @@ void playerctl_player_seek(PlayerctlPlayer *self, gint64 offset, GError **err) {
         return;
     }
 
-    org_mpris_media_player2_player_call_seek_sync(self->priv->proxy, offset, NULL, &tmp_error);
-
-    if (tmp_error != NULL) {
-        g_propagate_error(err, tmp_error);
-        return;
-    }
-
-    return;
+    player_call_method_sync(self, "Seek", g_variant_new("(x)", offset), err);
 }
 
 /**
@@ -1272,7 +1668,7 @@ void playerctl_player_seek(PlayerctlPlayer *self, gint64 offset, GError **err) {
  * Command the player to go to the next track
  */
 void playerctl_player_next(PlayerctlPlayer *self, GError **err) {
-    PLAYER_COMMAND_FUNC(next);
+    PLAYER_COMMAND_FUNC("Next");
 }
 
 /**
@@ -1283,54 +1679,134 @@ void playerctl_player_next(PlayerctlPlayer *self, GError **err) {
  * Command the player to go to the previous track
  */
 void playerctl_player_previous(PlayerctlPlayer *self, GError **err) {
-    PLAYER_COMMAND_FUNC(previous);
+    PLAYER_COMMAND_FUNC("Previous");
 }
 
-static gchar *print_metadata_table(GVariant *metadata, gchar *player_name) {
+#define METADATA_TABLE_NAME_WIDTH 5
+#define METADATA_TABLE_KEY_WIDTH 25
+#define METADATA_TABLE_FLUSH_SIZE 4096
+
+/*
+ * Renders the metadata table a row at a time. With a file descriptor, the
+ * buffer is written out whenever it grows past METADATA_TABLE_FLUSH_SIZE.
+ * Otherwise the whole table is kept in the buffer.
+ */
+struct metadata_table_writer {
+    GString *buffer;
+    gint fd;
+};
+
+static void metadata_table_append_column(GString *buffer, const gchar *text, gsize width) {
+    gsize len = strlen(text);
+    g_string_append_len(buffer, text, len);
+    for (gsize i = len; i < width; ++i) {
+        g_string_append_c(buffer, ' ');
+    }
+    g_string_append_c(buffer, ' ');
+}
+
+static void metadata_table_append_row(struct metadata_table_writer *writer,
+                                      const gchar *player_name, const gchar *key, GVariant *value) {
+    gchar *value_str = pctl_print_gvariant(value);
+    metadata_table_append_column(writer->buffer, player_name, METADATA_TABLE_NAME_WIDTH);
+    metadata_table_append_column(writer->buffer, key, METADATA_TABLE_KEY_WIDTH);
+    g_string_append(writer->buffer, value_str);
+    g_string_append_c(writer->buffer, '\n');
+    g_free(value_str);
+}
+
+static gboolean metadata_table_writer_flush(struct metadata_table_writer *writer, GError **err) {
+    gsize written = 0;
+
+    while (written < writer->buffer->len) {
+        gssize ret =
+            write(writer->fd, writer->buffer->str + written, writer->buffer->len - written);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int saved_errno = errno;
+            g_set_error(err, G_IO_ERROR, g_io_error_from_errno(saved_errno),
+                        "Could not write metadata: %s", g_strerror(saved_errno));
+            return FALSE;
+        }
+        written += ret;
+    }
+
+    g_string_truncate(writer->buffer, 0);
+    return TRUE;
+}
+
+/*
+ * Writes a row for each entry of the metadata in a single pass over the
+ * dictionary. Containers are expanded one level deep with a row for each
+ * child. Returns the number of rows written.
+ */
+static gsize write_metadata_table(struct metadata_table_writer *writer, GVariant *metadata,
+                                  const gchar *player_name, GError **err) {
+    GError *tmp_error = NULL;
     GVariantIter iter;
-    GVariant *child;
-    GString *table = g_string_new("");
-    const gchar *fmt = "%-5s %-25s %s\n";
+    const gchar *key;
+    GVariant *value;
+    gsize rows = 0;
 
-    if (g_strcmp0(g_variant_get_type_string(metadata), "a{sv}") != 0) {
-        return NULL;
+    if (!g_variant_is_of_type(metadata, G_VARIANT_TYPE_VARDICT)) {
+        return 0;
     }
 
     g_variant_iter_init(&iter, metadata);
-    while ((child = g_variant_iter_next_value(&iter))) {
-        GVariant *key_variant = g_variant_get_child_value(child, 0);
-        const gchar *key = g_variant_get_string(key_variant, 0);
-        GVariant *value_variant = g_variant_lookup_value(metadata, key, NULL);
-
-        if (g_variant_is_container(value_variant)) {
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+        if (g_variant_is_container(value)) {
             // only go depth 1
-            int len = g_variant_n_children(value_variant);
-            for (int i = 0; i < len; ++i) {
-                GVariant *child_value = g_variant_get_child_value(value_variant, i);
-                gchar *child_value_str = pctl_print_gvariant(child_value);
-                g_string_append_printf(table, fmt, player_name, key, child_value_str);
-                g_free(child_value_str);
+            gsize len = g_variant_n_children(value);
+            for (gsize i = 0; i < len; ++i) {
+                GVariant *child_value = g_variant_get_child_value(value, i);
+                metadata_table_append_row(writer, player_name, key, child_value);
                 g_variant_unref(child_value);
+                rows++;
             }
         } else {
-            gchar *value = pctl_print_gvariant(value_variant);
-            g_string_append_printf(table, fmt, player_name, key, value);
-            g_free(value);
+            metadata_table_append_row(writer, player_name, key, value);
+            rows++;
+        }
+
+        g_variant_unref(value);
+
+        if (writer->fd >= 0 && writer->buffer->len >= METADATA_TABLE_FLUSH_SIZE) {
+            metadata_table_writer_flush(writer, &tmp_error);
+            if (tmp_error != NULL) {
+                g_propagate_error(err, tmp_error);
+                return rows;
+            }
         }
+    }
 
-        g_variant_unref(child);
-        g_variant_unref(key_variant);
-        g_variant_unref(value_variant);
+    if (writer->fd >= 0) {
+        metadata_table_writer_flush(writer, &tmp_error);
+        if (tmp_error != NULL) {
+            g_propagate_error(err, tmp_error);
+        }
     }
 
-    if (table->len == 0) {
-        g_string_free(table, TRUE);
+    return rows;
+}
+
+static gchar *print_metadata_table(GVariant *metadata, const gchar *player_name) {
+    struct metadata_table_writer writer = {
+        .buffer = g_string_new(""),
+        .fd = -1,
+    };
+
+    write_metadata_table(&writer, metadata, player_name, NULL);
+
+    if (writer.buffer->len == 0) {
+        g_string_free(writer.buffer, TRUE);
         return NULL;
     }
     // cut off the last newline
-    table = g_string_truncate(table, table->len - 1);
+    g_string_truncate(writer.buffer, writer.buffer->len - 1);
 
-    return g_string_free(table, FALSE);
+    return g_string_free(writer.buffer, FALSE);
 }
 
 /**
@@ -1357,7 +1833,7 @@ gchar *playerctl_player_print_metadata_prop(PlayerctlPlayer *self, const gchar *
         return NULL;
     }
 
-    GVariant *metadata = playerctl_player_get_metadata(self, &tmp_error);
+    struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &tmp_error);
 
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
@@ -1369,21 +1845,38 @@ gchar *playerctl_player_print_metadata_prop(PlayerctlPlayer *self, const gchar *
     }
 
     if (!property) {
-        gchar *res = print_metadata_table(metadata, self->priv->player_name);
-        g_variant_unref(metadata);
-        return res;
+        return print_metadata_table(pctl_metadata_get_raw(metadata), self->priv->player_name);
     }
 
-    GVariant *prop_variant = g_variant_lookup_value(metadata, property, NULL);
-    g_variant_unref(metadata);
+    GVariant *prop_variant = pctl_metadata_lookup(metadata, property);
 
     if (!prop_variant) {
         return NULL;
     }
 
-    gchar *prop = pctl_print_gvariant(prop_variant);
-    g_variant_unref(prop_variant);
-    return prop;
+    return pctl_print_gvariant(prop_variant);
+}
+
+static gchar *print_metadata_field(PlayerctlPlayer *self, enum pctl_metadata_field field,
+                                   GError **err) {
+    GError *tmp_error = NULL;
+
+    struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    if (metadata == NULL) {
+        return NULL;
+    }
+
+    GVariant *value = pctl_metadata_get_field(metadata, field);
+    if (value == NULL) {
+        return NULL;
+    }
+
+    return pctl_print_gvariant(value);
 }
 
 /**
@@ -1405,7 +1898,7 @@ gchar *playerctl_player_get_artist(PlayerctlPlayer *self, GError **err) {
         return NULL;
     }
 
-    return playerctl_player_print_metadata_prop(self, "xesam:artist", NULL);
+    return print_metadata_field(self, PCTL_METADATA_ARTIST, NULL);
 }
 
 /**
@@ -1427,7 +1920,7 @@ gchar *playerctl_player_get_title(PlayerctlPlayer *self, GError **err) {
         return NULL;
     }
 
-    return playerctl_player_print_metadata_prop(self, "xesam:title", NULL);
+    return print_metadata_field(self, PCTL_METADATA_TITLE, NULL);
 }
 
 /**
@@ -1449,7 +1942,122 @@ gchar *playerctl_player_get_album(PlayerctlPlayer *self, GError **err) {
         return NULL;
     }
 
-    return playerctl_player_print_metadata_prop(self, "xesam:album", NULL);
+    return print_metadata_field(self, PCTL_METADATA_ALBUM, NULL);
+}
+
+/**
+ * playerctl_player_lookup_metadata:
+ * @self: a #PlayerctlPlayer
+ * @key: the metadata key to look up such as "xesam:title"
+ * @err:(allow-none): the location of a GError or NULL
+ *
+ * Gets the value of the given key from the metadata of the current track
+ * without printing it. The metadata is parsed once when it changes, so this
+ * does not scan the metadata dictionary.
+ *
+ * Returns:(transfer full)(nullable): The value of the key, or NULL if it is
+ * not set
+ */
+GVariant *playerctl_player_lookup_metadata(PlayerctlPlayer *self, const gchar *key, GError **err) {
+    GError *tmp_error = NULL;
+
+    g_return_val_if_fail(self != NULL, NULL);
+    g_return_val_if_fail(key != NULL, NULL);
+    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
+
+    if (self->priv->init_error != NULL) {
+        g_propagate_error(err, g_error_copy(self->priv->init_error));
+        return NULL;
+    }
+
+    struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    if (metadata == NULL) {
+        return NULL;
+    }
+
+    GVariant *value = pctl_metadata_lookup(metadata, key);
+    return value ? g_variant_ref(value) : NULL;
+}
+
+/**
+ * playerctl_player_get_track_id:
+ * @self: a #PlayerctlPlayer
+ * @err:(allow-none): the location of a GError or NULL
+ *
+ * Gets the track id from the metadata of the current track, or NULL if no
+ * track is playing.
+ *
+ * Returns:(transfer full): The track id of the current track
+ */
+gchar *playerctl_player_get_track_id(PlayerctlPlayer *self, GError **err) {
+    GError *tmp_error = NULL;
+
+    g_return_val_if_fail(self != NULL, NULL);
+    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
+
+    if (self->priv->init_error != NULL) {
+        g_propagate_error(err, g_error_copy(self->priv->init_error));
+        return NULL;
+    }
+
+    struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return NULL;
+    }
+
+    return metadata ? g_strdup(pctl_metadata_get_track_id(metadata)) : NULL;
+}
+
+/**
+ * playerctl_player_get_length:
+ * @self: a #PlayerctlPlayer
+ * @err:(allow-none): the location of a GError or NULL
+ *
+ * Gets the length of the current track in microseconds, or 0 if it is not
+ * known.
+ *
+ * Returns: The length of the current track
+ */
+gint64 playerctl_player_get_length(PlayerctlPlayer *self, GError **err) {
+    GError *tmp_error = NULL;
+
+    g_return_val_if_fail(self != NULL, 0);
+    g_return_val_if_fail(err == NULL || *err == NULL, 0);
+
+    if (self->priv->init_error != NULL) {
+        g_propagate_error(err, g_error_copy(self->priv->init_error));
+        return 0;
+    }
+
+    struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return 0;
+    }
+
+    if (metadata == NULL) {
+        return 0;
+    }
+
+    GVariant *length = pctl_metadata_get_field(metadata, PCTL_METADATA_LENGTH);
+    if (length == NULL) {
+        return 0;
+    }
+
+    if (g_variant_is_of_type(length, G_VARIANT_TYPE_INT64)) {
+        return g_variant_get_int64(length);
+    } else if (g_variant_is_of_type(length, G_VARIANT_TYPE_UINT64)) {
+        // some players send this as unsigned
+        return (gint64)g_variant_get_uint64(length);
+    }
+
+    return 0;
 }
 
 /**
@@ -1472,6 +2080,11 @@ void playerctl_player_set_volume(PlayerctlPlayer *self, gdouble volume, GError *
         return;
     }
 
+    gint timeout = -1;
+    if (!player_call_timeout(self, &timeout, err)) {
+        return;
+    }
+
     GDBusConnection *connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
@@ -1481,7 +2094,7 @@ void playerctl_player_set_volume(PlayerctlPlayer *self, gdouble volume, GError *
     GVariant *result = g_dbus_connection_call_sync(
         connection, self->priv->bus_name, MPRIS_PATH, PROPERTIES_IFACE, SET_MEMBER,
         g_variant_new("(ssv)", PLAYER_IFACE, "Volume", g_variant_new("d", volume)), NULL,
-        G_DBUS_CALL_FLAGS_NONE, -1, NULL, &tmp_error);
+        G_DBUS_CALL_FLAGS_NONE, timeout, NULL, &tmp_error);
     if (result != NULL) {
         g_variant_unref(result);
     }
@@ -1511,10 +2124,15 @@ gint64 playerctl_player_get_position(PlayerctlPlayer *self, GError **err) {
         return 0;
     }
 
-    GVariant *call_reply = g_dbus_proxy_call_sync(G_DBUS_PROXY(self->priv->proxy),
-                                                  "org.freedesktop.DBus.Properties.Get",
-                                                  g_variant_new("(ss)", PLAYER_IFACE, "Position"),
-                                                  G_DBUS_CALL_FLAGS_NONE, -1, NULL, &tmp_error);
+    gint timeout = -1;
+    if (!player_call_timeout(self, &timeout, err)) {
+        return 0;
+    }
+
+    GVariant *call_reply = g_dbus_proxy_call_sync(
+        G_DBUS_PROXY(self->priv->proxy), "org.freedesktop.DBus.Properties.Get",
+        g_variant_new("(ss)", PLAYER_IFACE, "Position"), G_DBUS_CALL_FLAGS_NONE, timeout, NULL,
+        &tmp_error);
     if (tmp_error) {
         g_propagate_error(err, tmp_error);
         return 0;
@@ -1552,14 +2170,13 @@ void playerctl_player_set_position(PlayerctlPlayer *self, gint64 position, GErro
     }
 
     // calling the function requires the track id
-    GVariant *metadata = playerctl_player_get_metadata(self, &tmp_error);
+    struct pctl_metadata *metadata = playerctl_player_get_metadata_model(self, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
         return;
     }
 
-    gchar *track_id = metadata_get_track_id(metadata);
-    g_variant_unref(metadata);
+    const gchar *track_id = metadata ? pctl_metadata_get_track_id(metadata) : NULL;
 
     if (track_id == NULL) {
         tmp_error = g_error_new(playerctl_player_error_quark(), 2,
@@ -1568,11 +2185,7 @@ void playerctl_player_set_position(PlayerctlPlayer *self, gint64 position, GErro
         return;
     }
 
-    org_mpris_media_player2_player_call_set_position_sync(self->priv->proxy, track_id, position,
-                                                          NULL, &tmp_error);
-    if (tmp_error != NULL) {
-        g_propagate_error(err, tmp_error);
-    }
+    player_call_method_sync(self, "SetPosition", g_variant_new("(ox)", track_id, position), err);
 }
 
 /**
@@ -1597,6 +2210,11 @@ void playerctl_player_set_loop_status(PlayerctlPlayer *self, PlayerctlLoopStatus
     const gchar *status_str = pctl_loop_status_to_string(status);
     g_return_if_fail(status_str != NULL);
 
+    gint timeout = -1;
+    if (!player_call_timeout(self, &timeout, err)) {
+        return;
+    }
+
     GDBusConnection *connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
@@ -1606,7 +2224,7 @@ void playerctl_player_set_loop_status(PlayerctlPlayer *self, PlayerctlLoopStatus
     GVariant *result = g_dbus_connection_call_sync(
         connection, self->priv->bus_name, MPRIS_PATH, PROPERTIES_IFACE, SET_MEMBER,
         g_variant_new("(ssv)", PLAYER_IFACE, "LoopStatus", g_variant_new("s", status_str)), NULL,
-        G_DBUS_CALL_FLAGS_NONE, -1, NULL, &tmp_error);
+        G_DBUS_CALL_FLAGS_NONE, timeout, NULL, &tmp_error);
     if (result != NULL) {
         g_variant_unref(result);
     }
@@ -1635,6 +2253,11 @@ void playerctl_player_set_shuffle(PlayerctlPlayer *self, gboolean shuffle, GErro
         return;
     }
 
+    gint timeout = -1;
+    if (!player_call_timeout(self, &timeout, err)) {
+        return;
+    }
+
     GDBusConnection *connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &tmp_error);
     if (tmp_error != NULL) {
         g_propagate_error(err, tmp_error);
@@ -1644,7 +2267,7 @@ void playerctl_player_set_shuffle(PlayerctlPlayer *self, gboolean shuffle, GErro
     GVariant *result = g_dbus_connection_call_sync(
         connection, self->priv->bus_name, MPRIS_PATH, PROPERTIES_IFACE, SET_MEMBER,
         g_variant_new("(ssv)", PLAYER_IFACE, "Shuffle", g_variant_new("b", shuffle)), NULL,
-        G_DBUS_CALL_FLAGS_NONE, -1, NULL, &tmp_error);
+        G_DBUS_CALL_FLAGS_NONE, timeout, NULL, &tmp_error);
     if (result != NULL) {
         g_variant_unref(result);
     }
@@ -1655,10 +2278,289 @@ void playerctl_player_set_shuffle(PlayerctlPlayer *self, gboolean shuffle, GErro
     }
 }
 
+static void coalesce_call_callback(GObject *source_object, GAsyncResult *res, gpointer user_data) {
+    gchar *instance = user_data;
+    GError *tmp_error = NULL;
+
+    GVariant *result = g_dbus_proxy_call_finish(G_DBUS_PROXY(source_object), res, &tmp_error);
+    if (tmp_error != NULL) {
+        g_debug("%s: could not send coalesced command: %s", instance, tmp_error->message);
+        g_clear_error(&tmp_error);
+    } else {
+        g_variant_unref(result);
+    }
+
+    g_free(instance);
+}
+
+/*
+ * Sends a merged command without waiting for the reply, so it can be sent
+ * from the timeout of the window and from dispose.
+ */
+static void coalesce_call(PlayerctlPlayer *self, const gchar *method, GVariant *parameters) {
+    GError *tmp_error = NULL;
+    gint timeout = -1;
+
+    if (!player_call_timeout(self, &timeout, &tmp_error)) {
+        g_debug("%s: could not send coalesced command: %s", self->priv->instance,
+                tmp_error->message);
+        g_clear_error(&tmp_error);
+        g_variant_unref(g_variant_ref_sink(parameters));
+        return;
+    }
+
+    g_dbus_proxy_call(G_DBUS_PROXY(self->priv->proxy), method, parameters, G_DBUS_CALL_FLAGS_NONE,
+                      timeout, NULL, coalesce_call_callback, g_strdup(self->priv->instance));
+}
+
+static gboolean coalesce_flush(PlayerctlPlayer *self) {
+    struct coalesce_state *state = &self->priv->coalesce;
+    gboolean sent = FALSE;
+
+    if (state->position_pending) {
+        // the track id is read from the cache of the proxy so nothing blocks here
+        GVariant *metadata = org_mpris_media_player2_player_dup_metadata(self->priv->proxy);
+        struct pctl_metadata *model = (metadata != NULL ? pctl_metadata_new(metadata) : NULL);
+        const gchar *track_id = (model != NULL ? pctl_metadata_get_track_id(model) : NULL);
+
+        if (track_id != NULL) {
+            gint64 position =
+                calculate_cached_position(self->priv->cached_status, &state->position_monotonic,
+                                          state->position, self->priv->cached_rate);
+            g_debug("%s: sending coalesced position %" G_GINT64_FORMAT, self->priv->instance,
+                    position);
+            coalesce_call(self, "SetPosition", g_variant_new("(ox)", track_id, position));
+        } else {
+            // setting the position requires the track id, so seek by the merged offsets
+            g_debug("%s: sending coalesced seek %" G_GINT64_FORMAT, self->priv->instance,
+                    state->offset);
+            coalesce_call(self, "Seek", g_variant_new("(x)", state->offset));
+        }
+
+        pctl_metadata_free(model);
+        if (metadata != NULL) {
+            g_variant_unref(metadata);
+        }
+        state->position_pending = FALSE;
+        state->offset = 0;
+        state->sent++;
+        sent = TRUE;
+    }
+
+    if (state->volume_pending) {
+        g_debug("%s: sending coalesced volume %f", self->priv->instance, state->volume);
+        coalesce_call(self, PROPERTIES_IFACE "." SET_MEMBER,
+                      g_variant_new("(ssv)", PLAYER_IFACE, "Volume",
+                                    g_variant_new_double(state->volume)));
+        state->volume_pending = FALSE;
+        state->sent++;
+        sent = TRUE;
+    }
+
+    return sent;
+}
+
+static gboolean coalesce_timeout_callback(gpointer user_data) {
+    PlayerctlPlayer *self = PLAYERCTL_PLAYER(user_data);
+    struct coalesce_state *state = &self->priv->coalesce;
+
+    if (coalesce_flush(self)) {
+        // keep the window open so the next commands are merged as well
+        return G_SOURCE_CONTINUE;
+    }
+
+    // the window passed without a command, so start over from the player state
+    g_clear_pointer(&state->source, g_source_unref);
+    state->has_position = FALSE;
+    state->has_volume = FALSE;
+    return G_SOURCE_REMOVE;
+}
+
+static void coalesce_open_window(PlayerctlPlayer *self) {
+    struct coalesce_state *state = &self->priv->coalesce;
+
+    if (state->window == 0 || state->source != NULL) {
+        return;
+    }
+
+    state->source = g_timeout_source_new(state->window);
+    g_source_set_callback(state->source, coalesce_timeout_callback, self, NULL);
+    g_source_attach(state->source, g_main_context_get_thread_default());
+}
+
+/**
+ * playerctl_player_seek_coalesced:
+ * @self: a #PlayerctlPlayer
+ * @offset: the offset to seek forward to in microseconds
+ * @err:(allow-none): the location of a GError or NULL
+ *
+ * Like playerctl_player_seek(), but seeks made within the
+ * #PlayerctlPlayer:coalesce-window of the last command sent are merged and
+ * sent as a single absolute position when the window ends, or as a single
+ * seek by the sum of their offsets when the track has no track id. The window
+ * ends on the thread-default main context of the caller, which must be
+ * running for the merged seek to be sent. Only errors from commands that are
+ * sent right away are reported.
+ */
+void playerctl_player_seek_coalesced(PlayerctlPlayer *self, gint64 offset, GError **err) {
+    GError *tmp_error = NULL;
+
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(err == NULL || *err == NULL);
+
+    if (self->priv->init_error != NULL) {
+        g_propagate_error(err, g_error_copy(self->priv->init_error));
+        return;
+    }
+
+    struct coalesce_state *state = &self->priv->coalesce;
+
+    if (state->window > 0) {
+        if (state->has_position) {
+            state->position =
+                calculate_cached_position(self->priv->cached_status, &state->position_monotonic,
+                                          state->position, self->priv->cached_rate);
+        } else {
+            state->position = calculate_cached_position(
+                self->priv->cached_status, &self->priv->cached_position_monotonic,
+                self->priv->cached_position, self->priv->cached_rate);
+            state->has_position = TRUE;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &state->position_monotonic);
+        state->position = MAX(state->position + offset, 0);
+
+        if (state->source != NULL) {
+            state->offset += offset;
+            state->position_pending = TRUE;
+            state->merged++;
+            return;
+        }
+    }
+
+    state->sent++;
+    playerctl_player_seek(self, offset, &tmp_error);
+    if (tmp_error != NULL) {
+        state->has_position = FALSE;
+        g_propagate_error(err, tmp_error);
+        return;
+    }
+
+    coalesce_open_window(self);
+}
+
+/**
+ * playerctl_player_change_volume_coalesced:
+ * @self: a #PlayerctlPlayer
+ * @delta: the amount to change the volume by
+ * @err:(allow-none): the location of a GError or NULL
+ *
+ * Changes the volume of the player by @delta. Changes made within the
+ * #PlayerctlPlayer:coalesce-window of the last command sent are merged and
+ * sent as a single volume level when the window ends. The window ends on the
+ * thread-default main context of the caller, which must be running for the
+ * merged volume to be sent. Only errors from commands that are sent right
+ * away are reported.
+ */
+void playerctl_player_change_volume_coalesced(PlayerctlPlayer *self, gdouble delta,
+                                              GError **err) {
+    GError *tmp_error = NULL;
+
+    g_return_if_fail(self != NULL);
+    g_return_if_fail(err == NULL || *err == NULL);
+
+    if (self->priv->init_error != NULL) {
+        g_propagate_error(err, g_error_copy(self->priv->init_error));
+        return;
+    }
+
+    struct coalesce_state *state = &self->priv->coalesce;
+
+    if (!state->has_volume || state->window == 0) {
+        state->volume = org_mpris_media_player2_player_get_volume(self->priv->proxy);
+        state->has_volume = state->window > 0;
+    }
+    state->volume = MAX(state->volume + delta, 0.0);
+
+    if (state->source != NULL) {
+        state->volume_pending = TRUE;
+        state->merged++;
+        return;
+    }
+
+    state->sent++;
+    playerctl_player_set_volume(self, state->volume, &tmp_error);
+    if (tmp_error != NULL) {
+        state->has_volume = FALSE;
+        g_propagate_error(err, tmp_error);
+        return;
+    }
+
+    coalesce_open_window(self);
+}
+
 char *pctl_player_get_instance(PlayerctlPlayer *player) {
     return player->priv->instance;
 }
 
+PlayerctlSource pctl_player_get_source(PlayerctlPlayer *player) {
+    return player->priv->source;
+}
+
+gint64 pctl_player_get_position_anchor(PlayerctlPlayer *player, gint64 *monotonic_time) {
+    if (monotonic_time != NULL) {
+        *monotonic_time = timespec_to_usec(&player->priv->cached_position_monotonic);
+    }
+
+    if (player->priv->cached_status == PLAYERCTL_PLAYBACK_STATUS_STOPPED) {
+        return 0;
+    }
+
+    return player->priv->cached_position;
+}
+
+struct pctl_metadata *pctl_player_get_metadata_model(PlayerctlPlayer *player, GError **err) {
+    g_return_val_if_fail(err == NULL || *err == NULL, NULL);
+
+    if (player->priv->init_error != NULL) {
+        g_propagate_error(err, g_error_copy(player->priv->init_error));
+        return NULL;
+    }
+
+    return playerctl_player_get_metadata_model(player, err);
+}
+
+gboolean pctl_player_write_metadata_table(PlayerctlPlayer *player, gint fd, GError **err) {
+    GError *tmp_error = NULL;
+
+    g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+    struct pctl_metadata *metadata = pctl_player_get_metadata_model(player, &tmp_error);
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return FALSE;
+    }
+
+    if (metadata == NULL) {
+        return FALSE;
+    }
+
+    struct metadata_table_writer writer = {
+        .buffer = g_string_sized_new(METADATA_TABLE_FLUSH_SIZE),
+        .fd = fd,
+    };
+
+    gsize rows = write_metadata_table(&writer, pctl_metadata_get_raw(metadata),
+                                      player->priv->player_name, &tmp_error);
+    g_string_free(writer.buffer, TRUE);
+
+    if (tmp_error != NULL) {
+        g_propagate_error(err, tmp_error);
+        return FALSE;
+    }
+
+    return rows > 0;
+}
+
 bool pctl_player_has_cached_property(PlayerctlPlayer *player, const gchar *name) {
     GVariant *value = g_dbus_proxy_get_cached_property(G_DBUS_PROXY(player->priv->proxy), name);
     if (value == NULL) {
@@ -127,11 +127,34 @@ typedef enum {
     PLAYERCTL_LOOP_STATUS_PLAYLIST, /* nick=Playlist >*/
 } PlayerctlLoopStatus;
 
+/**
+ * PlayerctlPlayerPropertyFlags:
+ * @PLAYERCTL_PLAYER_PROPERTY_PLAYBACK_STATUS: The playback status changed.
+ * @PLAYERCTL_PLAYER_PROPERTY_LOOP_STATUS: The loop status changed.
+ * @PLAYERCTL_PLAYER_PROPERTY_SHUFFLE: The shuffle status changed.
+ * @PLAYERCTL_PLAYER_PROPERTY_VOLUME: The volume changed.
+ * @PLAYERCTL_PLAYER_PROPERTY_METADATA: The metadata changed.
+ * @PLAYERCTL_PLAYER_PROPERTY_RATE: The playback rate changed.
+ *
+ * The set of properties reported by the #PlayerctlPlayer::properties-changed
+ * signal.
+ */
+typedef enum {
+    PLAYERCTL_PLAYER_PROPERTY_PLAYBACK_STATUS = 1 << 0,
+    PLAYERCTL_PLAYER_PROPERTY_LOOP_STATUS = 1 << 1,
+    PLAYERCTL_PLAYER_PROPERTY_SHUFFLE = 1 << 2,
+    PLAYERCTL_PLAYER_PROPERTY_VOLUME = 1 << 3,
+    PLAYERCTL_PLAYER_PROPERTY_METADATA = 1 << 4,
+    PLAYERCTL_PLAYER_PROPERTY_RATE = 1 << 5,
+} PlayerctlPlayerPropertyFlags;
+
 /*
  * Static methods
  */
 GList *playerctl_list_players(GError **err);
 
+GList *playerctl_list_players_for_source(PlayerctlSource source, GError **err);
+
 /*
  * Method definitions.
  */
@@ -164,6 +187,12 @@ gchar *playerctl_player_get_title(PlayerctlPlayer *self, GError **err);
 
 gchar *playerctl_player_get_album(PlayerctlPlayer *self, GError **err);
 
+GVariant *playerctl_player_lookup_metadata(PlayerctlPlayer *self, const gchar *key, GError **err);
+
+gchar *playerctl_player_get_track_id(PlayerctlPlayer *self, GError **err);
+
+gint64 playerctl_player_get_length(PlayerctlPlayer *self, GError **err);
+
 void playerctl_player_set_volume(PlayerctlPlayer *self, gdouble volume, GError **err);
 
 gint64 playerctl_player_get_position(PlayerctlPlayer *self, GError **err);
@@ -175,4 +204,9 @@ void playerctl_player_set_loop_status(PlayerctlPlayer *self, PlayerctlLoopStatus
 
 void playerctl_player_set_shuffle(PlayerctlPlayer *self, gboolean shuffle, GError **err);
 
+void playerctl_player_seek_coalesced(PlayerctlPlayer *self, gint64 offset, GError **err);
+
+void playerctl_player_change_volume_coalesced(PlayerctlPlayer *self, gdouble delta,
+                                              GError **err);
+
 #endif /* __PLAYERCTL_PLAYER_H__ */
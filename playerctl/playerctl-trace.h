@@ -0,0 +1,44 @@
+/*
+ * This file is part of playerctl.
+ *
+ * playerctl is free software: you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * playerctl is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with playerctl If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Copyright © 2014, Tony Crisci and contributors
+ */
+
+#ifndef __PLAYERCTL_TRACE_H__
+#define __PLAYERCTL_TRACE_H__
+
+/*
+ * Static tracepoints (USDT probes) of the provider "playerctl", built with the
+ * usdt option. A probe is a single nop until a tracer like bpftrace attaches to
+ * it, but its arguments are evaluated on every call whether or not a tracer is
+ * attached, so only pass values that are already at hand. Without the option,
+ * the probes compile to nothing. The scripts in data/bpftrace use these probes.
+ */
+#ifdef PLAYERCTL_USDT
+#include <sys/sdt.h>
+
+#define PCTL_TRACE1(name, arg1) DTRACE_PROBE1(playerctl, name, arg1)
+#define PCTL_TRACE2(name, arg1, arg2) DTRACE_PROBE2(playerctl, name, arg1, arg2)
+#else
+#define PCTL_TRACE1(name, arg1) \
+    do {                        \
+    } while (0)
+#define PCTL_TRACE2(name, arg1, arg2) \
+    do {                              \
+    } while (0)
+#endif
+
+#endif /* __PLAYERCTL_TRACE_H__ */
@@ -29,6 +29,7 @@ extern "C" {
 #include <playerctl/playerctl-enum-types.h>
 #include <playerctl/playerctl-player-manager.h>
 #include <playerctl/playerctl-player-name.h>
+#include <playerctl/playerctl-player-selector.h>
 #include <playerctl/playerctl-player.h>
 #include <playerctl/playerctl-version.h>
 
@@ -0,0 +1,46 @@
+"""Measures the startup time of playerctl with each source option.
+
+Run from the repository root with an installed playerctl and a running system
+bus:
+
+    dbus-run-session python3 -m test.bench_startup
+"""
+from .mpris import setup_mpris
+from .playerctl import PlayerctlCli
+
+import asyncio
+import os
+import time
+
+RUNS = 50
+
+
+async def time_command(playerctl, cmd, runs=RUNS):
+    elapsed = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        result = await playerctl.run(cmd)
+        elapsed.append(time.perf_counter() - start)
+        assert result.returncode == 0, result.stderr
+    elapsed.sort()
+    return elapsed[len(elapsed) // 2], elapsed[int(len(elapsed) * 0.9)]
+
+
+async def main():
+    bus_address = os.environ.get('DBUS_SESSION_BUS_ADDRESS')
+    mpris_players = await setup_mpris('bench1',
+                                      'bench2',
+                                      bus_address=bus_address)
+    playerctl = PlayerctlCli(bus_address)
+
+    print(f'{"command":<40} {"p50 (ms)":>10} {"p90 (ms)":>10}')
+    for source in ('all', 'session', 'auto'):
+        cmd = f'--source {source} status'
+        p50, p90 = await time_command(playerctl, cmd)
+        print(f'{cmd:<40} {p50 * 1000:>10.2f} {p90 * 1000:>10.2f}')
+
+    await asyncio.gather(*[mpris.disconnect() for mpris in mpris_players])
+
+
+if __name__ == '__main__':
+    asyncio.run(main())
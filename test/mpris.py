@@ -84,6 +84,7 @@ class MprisPlayer(ServiceInterface):
         self.stop_called = False
         self.play_called = False
         self.seek_called_with = None
+        self.seek_calls = []
         self.set_position_called_with = None
         self.open_uri_called_with = None
 
@@ -168,6 +169,7 @@ class MprisPlayer(ServiceInterface):
     @method()
     def Seek(self, offset: 'x'):
         self.seek_called_with = offset
+        self.seek_calls.append(offset)
 
     @method()
     def SetPosition(self, track_id: 'o', position: 'x'):
@@ -1,5 +1,7 @@
+from dbus_next import Variant
 from .mpris import setup_mpris
 from .playerctl import PlayerctlCli
+import json
 import math
 
 import asyncio
@@ -70,6 +72,62 @@ async def test_system_list_players(bus_address):
         *[mpris.disconnect() for mpris in system_players + session_players])
 
 
+@pytest.mark.asyncio
+async def test_system_source(bus_address):
+    system_players = await setup_mpris('system', system=True)
+    session_players = await setup_mpris('session1', bus_address=bus_address)
+    playerctl = PlayerctlCli(bus_address)
+
+    result = await playerctl.run('-l --source session')
+    assert result.returncode == 0, result.stderr
+    assert result.stdout.split() == ['session1']
+
+    result = await playerctl.run('-l --source system')
+    assert result.returncode == 0, result.stderr
+    assert result.stdout.split() == ['system']
+
+    # the auto source only looks on the system bus when nothing is selected on
+    # the session bus
+    cmd = 'status --format "{{playerName}}"'
+    result = await playerctl.run(cmd)
+    assert result.returncode == 0, result.stderr
+    assert result.stdout == 'session1'
+
+    result = await playerctl.run('-p system ' + cmd)
+    assert result.returncode == 0, result.stderr
+    assert result.stdout == 'system'
+
+    result = await playerctl.run('-p system,session1 ' + cmd)
+    assert result.returncode == 0, result.stderr
+    assert result.stdout == 'system'
+
+    result = await playerctl.run('--source session -p system ' + cmd)
+    assert result.returncode == 1
+    assert 'No players found' in result.stderr.split('\n')
+
+    await asyncio.gather(
+        *[mpris.disconnect() for mpris in system_players + session_players])
+
+
+@pytest.mark.asyncio
+async def test_system_source_fallback(bus_address):
+    [system] = await setup_mpris('system', system=True)
+    [session] = await setup_mpris('session1', bus_address=bus_address)
+    session.can_go_next = False
+    playerctl = PlayerctlCli(bus_address)
+
+    # a player on the system bus runs the command when the selected players
+    # on the session bus cannot
+    for cmd in ('next', '-p session1,system next'):
+        system.next_called = False
+        result = await playerctl.run(cmd)
+        assert result.returncode == 0, result.stderr
+        assert system.next_called
+        assert not session.next_called
+
+    await asyncio.gather(system.disconnect(), session.disconnect())
+
+
 @pytest.mark.asyncio
 async def test_queries(bus_address):
     [mpris] = await setup_mpris('queries', bus_address=bus_address)
@@ -92,3 +150,104 @@ async def test_queries(bus_address):
 
     query = await playerctl.run('shuffle')
     assert query.stdout == ('On' if mpris.shuffle else 'Off'), query.stderr
+
+
+@pytest.mark.asyncio
+async def test_timings(bus_address):
+    [mpris] = await setup_mpris('timings', bus_address=bus_address)
+    playerctl = PlayerctlCli(bus_address)
+
+    result = await playerctl.run('--timings -p timings status')
+    assert result.returncode == 0, result.stderr
+    assert result.stdout == 'Playing'
+    phases = [line.split(maxsplit=2)[2] for line in result.stderr.splitlines()[1:]]
+    assert phases[:3] == ['options', 'commands', 'manager']
+    assert 'connect timings' in phases
+    assert 'command status timings' in phases
+    assert phases[-1] == 'total'
+
+    result = await playerctl.run('-p timings status')
+    assert result.returncode == 0, result.stderr
+    assert not result.stderr
+
+    await mpris.disconnect()
+
+
+@pytest.mark.asyncio
+async def test_timeout(bus_address):
+    [mpris1, mpris2] = await setup_mpris('timeout1',
+                                         'timeout2',
+                                         bus_address=bus_address)
+    playerctl = PlayerctlCli(bus_address)
+
+    result = await playerctl.run('--timeout 0 play')
+    assert 'Timeout must be a positive number' in result.stderr
+    assert not mpris1.play_called and not mpris2.play_called
+
+    result = await playerctl.run('--timeout 2000 -p timeout2,timeout1 play')
+    assert result.returncode == 0, result.stderr
+    assert mpris2.play_called and not mpris1.play_called
+
+    result = await playerctl.run('--timeout 2000 -a pause')
+    assert result.returncode == 0, result.stderr
+    assert mpris1.pause_called and mpris2.pause_called
+
+    await asyncio.gather(mpris1.disconnect(), mpris2.disconnect())
+
+
+@pytest.mark.asyncio
+async def test_all_players_error(bus_address):
+    [notrack, track] = await setup_mpris('notrack',
+                                         'track',
+                                         bus_address=bus_address)
+    await track.set_artist_title('artist', 'title', track_id='/track')
+    playerctl = PlayerctlCli(bus_address)
+
+    # the players are commanded at once, so an error on one of them does not
+    # keep the others from executing the command
+    result = await playerctl.run('-a -p notrack,track position 5')
+    assert result.returncode == 1
+    assert 'Could not get track id to set position' in result.stderr
+    assert notrack.set_position_called_with is None
+    assert track.set_position_called_with == ('/track', 5000000)
+
+    await asyncio.gather(notrack.disconnect(), track.disconnect())
+
+
+@pytest.mark.asyncio
+async def test_json(bus_address):
+    [mpris] = await setup_mpris('json', bus_address=bus_address)
+    mpris.metadata = {
+        'xesam:artist': Variant('as', ['Artist "one"', 'Artist\ttwo']),
+        'xesam:title': Variant('s', 'Title\n'),
+        'mpris:length': Variant('x', 100000),
+    }
+    mpris.playback_status = 'Paused'
+    mpris.position = 2500000
+    await mpris.ping()
+    playerctl = PlayerctlCli(bus_address)
+
+    result = await playerctl.run('--json metadata')
+    assert result.returncode == 0, result.stderr
+    state = json.loads(result.stdout)
+    assert state['playerName'] == 'json'
+    assert state['status'] == 'Paused'
+    assert state['position'] == 2500000
+    assert isinstance(state['positionMonotonic'], int)
+    assert state['volume'] == mpris.volume
+    assert state['loop'] == mpris.loop_status
+    assert state['shuffle'] == mpris.shuffle
+    assert state['metadata'] == {
+        'xesam:artist': ['Artist "one"', 'Artist\ttwo'],
+        'xesam:title': 'Title\n',
+        'mpris:length': 100000,
+    }
+
+    result = await playerctl.run('--json metadata artist')
+    assert result.returncode == 1
+    assert 'json output is not supported' in result.stderr
+
+    result = await playerctl.run('--json --format "{{status}}" status')
+    assert 'cannot be used together' in result.stderr
+
+    await mpris.disconnect()
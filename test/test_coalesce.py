@@ -0,0 +1,93 @@
+from .mpris import setup_mpris
+import asyncio
+import json
+import os
+import sys
+import pytest
+
+# Drives the coalescing functions of the library through its GObject
+# introspection bindings. The main loop runs between the bursts so each burst
+# opens its own window and the window ends before the next one.
+SCRIPT = '''
+import json
+import sys
+import gi
+gi.require_version('Playerctl', '2.0')
+from gi.repository import GLib, Playerctl
+
+
+def run_loop(ms):
+    loop = GLib.MainLoop()
+    GLib.timeout_add(ms, loop.quit)
+    loop.run()
+
+
+player = Playerctl.Player.new_for_source(sys.argv[1],
+                                         Playerctl.Source.DBUS_SESSION)
+player.props.coalesce_window = 300
+for _ in range(5):
+    player.seek_coalesced(1000000)
+run_loop(1000)
+for _ in range(4):
+    player.change_volume_coalesced(0.1)
+run_loop(1000)
+print(json.dumps([player.props.commands_sent, player.props.commands_merged]))
+'''
+
+
+def library_available():
+    try:
+        import gi
+        gi.require_version('Playerctl', '2.0')
+        from gi.repository import Playerctl  # noqa: F401
+    except (ImportError, ValueError):
+        return False
+    return True
+
+
+async def run_script(bus_address, player_name):
+    env = os.environ.copy()
+    env['DBUS_SESSION_BUS_ADDRESS'] = bus_address
+    proc = await asyncio.create_subprocess_exec(
+        sys.executable,
+        '-c',
+        SCRIPT,
+        player_name,
+        env=env,
+        stdout=asyncio.subprocess.PIPE,
+        stderr=asyncio.subprocess.PIPE)
+    stdout, stderr = await proc.communicate()
+    assert proc.returncode == 0, stderr.decode()
+    return json.loads(stdout.decode())
+
+
+@pytest.mark.asyncio
+async def test_coalesce(bus_address):
+    if not library_available():
+        pytest.skip('the introspection data of the library is not installed')
+
+    [track, notrack] = await setup_mpris('coalesce1',
+                                         'coalesce2',
+                                         bus_address=bus_address)
+    for mpris in (track, notrack):
+        # the position does not move so the merged target is exact
+        mpris.playback_status = 'Paused'
+        mpris.volume = 0.2
+    await track.set_artist_title('artist', 'title', track_id='/track')
+
+    # the first seek is sent right away and the rest are sent as the position
+    # they add up to
+    sent, merged = await run_script(bus_address, 'coalesce1')
+    assert track.seek_calls == [1000000]
+    assert track.set_position_called_with == ('/track', 5000000)
+    assert track.volume == pytest.approx(0.6)
+    assert (sent, merged) == (4, 7)
+
+    # without a track id the rest are sent as one seek by their offsets
+    sent, merged = await run_script(bus_address, 'coalesce2')
+    assert notrack.seek_calls == [1000000, 4000000]
+    assert notrack.set_position_called_with is None
+    assert notrack.volume == pytest.approx(0.6)
+    assert (sent, merged) == (4, 7)
+
+    await asyncio.gather(track.disconnect(), notrack.disconnect())
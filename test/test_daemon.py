@@ -4,21 +4,24 @@ import os
 from .mpris import setup_mpris
 from .playerctl import PlayerctlCli
 from dbus_next.aio import MessageBus
-from dbus_next import Message, MessageType
+from dbus_next import Message, MessageType, Variant
 
 import asyncio
+import struct
 from asyncio import Queue
 from subprocess import run as run_process
 
 
-async def start_playerctld(bus_address, debug=False):
+async def start_playerctld(bus_address, debug=False, args='', runtime_dir=None):
     pkill = await asyncio.create_subprocess_shell('pkill playerctld')
     await pkill.wait()
     env = os.environ.copy()
     env['DBUS_SESSION_BUS_ADDRESS'] = bus_address
     env['G_MESSAGES_DEBUG'] = 'playerctl'
+    if runtime_dir is not None:
+        env['XDG_RUNTIME_DIR'] = str(runtime_dir)
     proc = await asyncio.create_subprocess_shell(
-        'playerctld',
+        f'playerctld {args}',
         env=env,
         stdout=asyncio.subprocess.PIPE,
         stderr=asyncio.subprocess.STDOUT)
@@ -306,3 +309,324 @@ async def test_active_player_change(bus_address):
 
     playerctld_proc.terminate()
     await playerctld_proc.wait()
+
+
+async def read_event(reader):
+    [length] = struct.unpack('<I', await reader.readexactly(4))
+    frame = await reader.readexactly(length)
+    event_type, _, name_len = struct.unpack_from('<BQH', frame)
+    name = frame[11:11 + name_len].decode()
+    return event_type, name, frame[11 + name_len:]
+
+
+@pytest.mark.asyncio
+async def test_daemon_event_socket(bus_address, tmp_path):
+    active_player_changed, properties_changed, seeked = 1, 2, 3
+    playerctld_proc = await start_playerctld(bus_address,
+                                             args='--socket',
+                                             runtime_dir=tmp_path)
+
+    path = tmp_path / 'playerctld.sock'
+    for _ in range(50):
+        if path.exists():
+            break
+        await asyncio.sleep(0.1)
+
+    reader, writer = await asyncio.open_unix_connection(str(path))
+
+    # a new subscriber gets the active player first
+    assert await read_event(reader) == (active_player_changed, '', b'')
+
+    [mpris1] = await setup_mpris('player1', bus_address=bus_address)
+    name = 'org.mpris.MediaPlayer2.player1'
+
+    event_type, event_name, _ = await read_event(reader)
+    assert (event_type, event_name) == (active_player_changed, name)
+
+    events = []
+    while not events or events[-1][0] != seeked:
+        events.append(await read_event(reader))
+    assert [event[0] for event in events[:-1]] == [properties_changed] * len(events[:-1])
+    assert len(events[-1][2]) == 8
+
+    await mpris1.set_artist_title('artist1', 'title1')
+    while True:
+        event_type, event_name, payload = await read_event(reader)
+        if event_type == properties_changed and b'xesam:title' in payload:
+            break
+    assert event_name == name
+    assert b'title1' in payload
+
+    writer.close()
+    playerctld_proc.terminate()
+    await asyncio.gather(mpris1.disconnect(), playerctld_proc.wait())
+    assert not path.exists()
+
+
+@pytest.mark.asyncio
+async def test_daemon_history(bus_address, tmp_path):
+    history_file = tmp_path / 'history'
+    playerctld_proc = await start_playerctld(
+        bus_address, args=f'--history-file {history_file}')
+
+    bus = await MessageBus(bus_address=bus_address).connect()
+
+    async def get_history(since=0):
+        reply = await bus.call(
+            Message(destination='org.mpris.MediaPlayer2.playerctld',
+                    path='/org/mpris/MediaPlayer2',
+                    interface='com.github.altdesktop.playerctld',
+                    member='GetHistory',
+                    signature='x',
+                    body=[since]))
+        if reply.message_type != MessageType.METHOD_RETURN:
+            return []
+        return [tuple(event) for event in reply.body[0]]
+
+    async def wait_for_history(expected):
+        for _ in range(50):
+            history = await get_history()
+            if [event[1:] for event in history] == expected:
+                break
+            await asyncio.sleep(0.1)
+        assert [event[1:] for event in history] == expected
+        return history
+
+    [mpris1] = await setup_mpris('player1', bus_address=bus_address)
+    name = 'org.mpris.MediaPlayer2.player1'
+    expected = [('status', name, 'Playing'), ('active', name, '')]
+    await wait_for_history(expected)
+
+    await mpris1.set_artist_title('artist1', 'title1')
+    expected.append(('track', name, 'artist1 - title1'))
+    history = await wait_for_history(expected)
+
+    # only the events after the time are returned
+    assert await get_history(history[1][0]) == history[2:]
+
+    # each event is appended to the file after a 16 bit length
+    data = history_file.read_bytes()
+    records = 0
+    while data:
+        [length] = struct.unpack_from('<H', data)
+        data = data[2 + length:]
+        records += 1
+    assert records == len(history)
+
+    bus.disconnect()
+    playerctld_proc.terminate()
+    await asyncio.gather(mpris1.disconnect(), playerctld_proc.wait(),
+                         bus.wait_for_disconnect())
+
+
+@pytest.mark.asyncio
+async def test_daemon_state_file(bus_address, tmp_path):
+    state_file = tmp_path / 'state'
+    playerctld_proc = await start_playerctld(bus_address,
+                                             args=f'--state-file {state_file}')
+
+    bus = await MessageBus(bus_address=bus_address).connect()
+
+    async def wait_for_player_names(expected):
+        for _ in range(50):
+            try:
+                playerctld = await get_playerctld(bus)
+                names = (await playerctld.call_get(
+                    'com.github.altdesktop.playerctld', 'PlayerNames')).value
+            except Exception:
+                names = None
+            if names == expected:
+                break
+            await asyncio.sleep(0.1)
+        assert names == expected
+
+    [mpris1, mpris2, mpris3] = await setup_mpris('state1',
+                                                 'state2',
+                                                 'state3',
+                                                 bus_address=bus_address)
+    await mpris1.set_artist_title('artist', 'title')
+    expected = [
+        'org.mpris.MediaPlayer2.state1', 'org.mpris.MediaPlayer2.state3',
+        'org.mpris.MediaPlayer2.state2'
+    ]
+    await wait_for_player_names(expected)
+
+    # the state is saved when playerctld exits
+    playerctld_proc.terminate()
+    await playerctld_proc.wait()
+    assert state_file.exists()
+
+    # the order is restored, and players that went away are dropped
+    await mpris3.disconnect()
+    playerctld_proc = await start_playerctld(bus_address,
+                                             args=f'--state-file {state_file}')
+    await wait_for_player_names(expected[:1] + expected[2:])
+
+    bus.disconnect()
+    playerctld_proc.terminate()
+    await asyncio.gather(mpris1.disconnect(), mpris2.disconnect(),
+                         playerctld_proc.wait(), bus.wait_for_disconnect())
+
+
+@pytest.mark.asyncio
+async def test_daemon_score_policy(bus_address):
+    playerctld_proc = await start_playerctld(bus_address,
+                                             args='--policy score')
+
+    bus = await MessageBus(bus_address=bus_address).connect()
+
+    async def get_player_names():
+        try:
+            playerctld = await get_playerctld(bus)
+            return (await playerctld.call_get('com.github.altdesktop.playerctld',
+                                              'PlayerNames')).value
+        except Exception:
+            return None
+
+    async def wait_for_player_names(expected):
+        for _ in range(50):
+            names = await get_player_names()
+            if names == expected:
+                break
+            await asyncio.sleep(0.1)
+        assert names == expected
+
+    name1 = 'org.mpris.MediaPlayer2.score1'
+    name2 = 'org.mpris.MediaPlayer2.score2'
+    [mpris1] = await setup_mpris('score1', bus_address=bus_address)
+    await wait_for_player_names([name1])
+
+    # a new player that does not outrank the active player by the margin does
+    # not take its place
+    [mpris2] = await setup_mpris('score2', bus_address=bus_address)
+    await wait_for_player_names([name1, name2])
+
+    # neither does a change that is not a change of track or status
+    mpris2.volume = 0.1
+    mpris2.emit_properties_changed({'Volume': mpris2.volume})
+    await mpris2.ping()
+    await asyncio.sleep(0.5)
+    assert await get_player_names() == [name1, name2]
+
+    # a playing player outranks a paused one
+    mpris1.playback_status = 'Paused'
+    mpris1.emit_properties_changed({'PlaybackStatus': 'Paused'})
+    await mpris1.ping()
+    await wait_for_player_names([name2, name1])
+
+    bus.disconnect()
+    playerctld_proc.terminate()
+    await asyncio.gather(mpris1.disconnect(), mpris2.disconnect(),
+                         playerctld_proc.wait(), bus.wait_for_disconnect())
+
+    playerctld_proc = await start_playerctld(bus_address,
+                                             args='--policy unknown')
+    assert await playerctld_proc.wait() == 1
+
+
+@pytest.mark.asyncio
+async def test_daemon_stats(bus_address):
+    playerctld_proc = await start_playerctld(bus_address)
+    [mpris] = await setup_mpris('stats', bus_address=bus_address)
+    playerctl = PlayerctlCli(bus_address)
+
+    await mpris.set_artist_title('artist', 'title')
+    result = await playerctl.run('-p playerctld play')
+    assert result.returncode == 0, result.stderr
+    assert mpris.play_called
+
+    bus = await MessageBus(bus_address=bus_address).connect()
+    reply = await bus.call(
+        Message(destination='org.mpris.MediaPlayer2.playerctld',
+                path='/org/mpris/MediaPlayer2',
+                interface='com.github.altdesktop.playerctld',
+                member='GetStats'))
+    assert reply.message_type == MessageType.METHOD_RETURN, reply.body
+    stats = reply.body[0]
+    assert stats['MethodCalls'].value >= 1
+    assert stats['CallLatency'].value['Count'].value == stats[
+        'MethodCalls'].value
+    assert stats['SignalsReceived'].value >= 1
+    assert stats['ActivePlayerChanges'].value >= 1
+    player_stats = stats['Players'].value['org.mpris.MediaPlayer2.stats'].value
+    assert player_stats['SignalsReceived'].value >= 1
+    assert player_stats['CacheBytes'].value > 0
+
+    env = os.environ.copy()
+    env['DBUS_SESSION_BUS_ADDRESS'] = bus_address
+    proc = await asyncio.create_subprocess_shell(
+        'playerctld stats', env=env, stdout=asyncio.subprocess.PIPE)
+    stdout, _ = await proc.communicate()
+    assert proc.returncode == 0
+    lines = stdout.decode().splitlines()
+    assert any(line.startswith('CallLatency: count ') for line in lines)
+    assert '  org.mpris.MediaPlayer2.stats:' in lines
+
+    bus.disconnect()
+    playerctld_proc.terminate()
+    await asyncio.gather(mpris.disconnect(), playerctld_proc.wait(),
+                         bus.wait_for_disconnect())
+
+
+@pytest.mark.asyncio
+async def test_daemon_coalesce(bus_address):
+    playerctld_proc = await start_playerctld(bus_address,
+                                             args='--coalesce-window 500')
+    [mpris] = await setup_mpris('coalesce', bus_address=bus_address)
+    await mpris.set_artist_title('artist', 'title')
+
+    bus = await MessageBus(bus_address=bus_address).connect()
+
+    def seek(offset):
+        return bus.call(
+            Message(destination='org.mpris.MediaPlayer2.playerctld',
+                    path='/org/mpris/MediaPlayer2',
+                    interface='org.mpris.MediaPlayer2.Player',
+                    member='Seek',
+                    signature='x',
+                    body=[offset]))
+
+    def set_volume(volume):
+        return bus.call(
+            Message(destination='org.mpris.MediaPlayer2.playerctld',
+                    path='/org/mpris/MediaPlayer2',
+                    interface='org.freedesktop.DBus.Properties',
+                    member='Set',
+                    signature='ssv',
+                    body=[
+                        'org.mpris.MediaPlayer2.Player', 'Volume',
+                        Variant('d', volume)
+                    ]))
+
+    # the first seek is sent right away and the rest of the burst is merged
+    replies = await asyncio.gather(*[seek(5000000) for _ in range(10)])
+    for reply in replies:
+        assert reply.message_type == MessageType.METHOD_RETURN, reply.body
+    await mpris.ping()
+    assert mpris.seek_calls == [5000000, 45000000]
+
+    mpris.volume = 0.2
+    mpris.emit_properties_changed({'Volume': mpris.volume})
+    # let the window close so the volume sets open a new one
+    await asyncio.sleep(1)
+
+    # each relative change computes its volume from the same volume, so the
+    # changes add up
+    replies = await asyncio.gather(*[set_volume(0.3) for _ in range(5)])
+    for reply in replies:
+        assert reply.message_type == MessageType.METHOD_RETURN, reply.body
+    await mpris.ping()
+    assert mpris.volume == pytest.approx(0.7)
+
+    reply = await bus.call(
+        Message(destination='org.mpris.MediaPlayer2.playerctld',
+                path='/org/mpris/MediaPlayer2',
+                interface='com.github.altdesktop.playerctld',
+                member='GetStats'))
+    assert reply.message_type == MessageType.METHOD_RETURN, reply.body
+    assert reply.body[0]['MethodCallsMerged'].value == 13
+
+    bus.disconnect()
+    playerctld_proc.terminate()
+    await asyncio.gather(mpris.disconnect(), playerctld_proc.wait(),
+                         bus.wait_for_disconnect())
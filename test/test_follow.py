@@ -2,6 +2,7 @@ from .mpris import setup_mpris
 from .playerctl import PlayerctlCli
 import pytest
 import asyncio
+from dbus_next import Variant
 
 
 @pytest.mark.asyncio
@@ -210,3 +211,94 @@ async def test_follow_all_players(bus_address):
     assert line == ''
 
     await mpris4.disconnect()
+
+
+@pytest.mark.asyncio
+async def test_follow_position(bus_address):
+    [mpris] = await setup_mpris('follow-position', bus_address=bus_address)
+    mpris.position = 0
+
+    playerctl = PlayerctlCli(bus_address)
+    pctl_cmd = 'status --format "{{status}} {{duration(position)}}" --follow'
+    proc = await playerctl.start(pctl_cmd)
+
+    line = await proc.queue.get()
+    assert line == 'Playing 0:00'
+
+    # the position is rendered when the second it shows changes
+    line = await asyncio.wait_for(proc.queue.get(), 2)
+    assert line == 'Playing 0:01'
+
+    mpris.playback_status = 'Paused'
+    mpris.emit_properties_changed({'PlaybackStatus': 'Paused'})
+    await mpris.ping()
+    line = await proc.queue.get()
+    assert line == 'Paused 0:01'
+
+    # the position does not change while paused
+    await asyncio.sleep(1.5)
+    assert proc.queue.empty()
+
+    await mpris.disconnect()
+
+
+@pytest.mark.asyncio
+async def test_follow_debounce(bus_address):
+    [mpris] = await setup_mpris('follow-debounce', bus_address=bus_address)
+    await mpris.set_artist_title('artist', 'title')
+
+    playerctl = PlayerctlCli(bus_address)
+    pctl_cmd = 'metadata --format "{{artist}} - {{title}}" --follow --debounce 200'
+    proc = await playerctl.start(pctl_cmd)
+
+    line = await proc.queue.get()
+    assert line == 'artist - title'
+
+    # changes within the window are printed once
+    await mpris.set_artist_title('artist2', 'title2')
+    await mpris.set_artist_title('artist3', 'title3')
+    line = await proc.queue.get()
+    assert line == 'artist3 - title3'
+    await asyncio.sleep(0.3)
+    assert proc.queue.empty()
+
+    await mpris.disconnect()
+
+
+@pytest.mark.asyncio
+async def test_follow_several_commands(bus_address):
+    [mpris] = await setup_mpris('follow-several', bus_address=bus_address)
+    await mpris.set_artist_title('artist', 'title')
+
+    playerctl = PlayerctlCli(bus_address)
+    proc = await playerctl.start('--follow status , volume , metadata artist')
+
+    lines = [await proc.queue.get() for _ in range(3)]
+    assert lines == ['status\tPlaying', 'volume\t1.000000', 'metadata\tartist']
+
+    # only the command whose output changed prints
+    await mpris.set_artist_title('artist2', 'title2')
+    line = await proc.queue.get()
+    assert line == 'metadata\tartist2'
+
+    await mpris.disconnect()
+
+
+@pytest.mark.asyncio
+async def test_follow_command_name_argument(bus_address):
+    [mpris] = await setup_mpris('follow-argument', bus_address=bus_address)
+    await mpris.set_artist_title('artist', 'title')
+    mpris.metadata['status'] = Variant('s', 'metadata status')
+    mpris.emit_properties_changed({'Metadata': mpris.metadata})
+    await mpris.ping()
+
+    # a command name is an argument of the command before it unless separated
+    playerctl = PlayerctlCli(bus_address)
+    proc = await playerctl.start('--follow metadata status')
+    line = await proc.queue.get()
+    assert line == 'metadata status'
+
+    await mpris.disconnect()
+
+    result = await playerctl.run('--follow status ,')
+    assert result.returncode == 1
@@ -45,7 +45,6 @@ async def test_selection(bus_address):
                                       s6i,
                                       bus_address=bus_address)
 
-    # TODO: test ignored players
     selections = {
         (s1, ): (s1, s1i),
         (s3, s1): (s3, s1, s1i),
@@ -75,6 +74,42 @@ async def test_selection(bus_address):
     await asyncio.gather(*[mpris.disconnect() for mpris in mpris_players])
 
 
+@pytest.mark.asyncio
+async def test_ignored_selection(bus_address):
+    s1 = 'selection1'
+    s1i = 'selection1.i_123'
+    s2 = 'selection2'
+    s3 = 'selection3'
+    m6 = 'selection6'
+    s6i = 'selection6.i_2'
+    any_player = '%any'
+
+    mpris_players = await setup_mpris(s1,
+                                      s1i,
+                                      s2,
+                                      s3,
+                                      s6i,
+                                      bus_address=bus_address)
+
+    playerctl = PlayerctlCli(bus_address)
+
+    # selection, ignored, expected result
+    tests = [
+        ([], [s1], [s2, s3, s6i]),
+        ([], [s1i], [s1, s2, s3, s6i]),
+        ([], [m6, s2], [s1, s1i, s3]),
+        ([s1, s2], [s1i], [s1, s2]),
+        ([s3, s1], [s2], [s3, s1, s1i]),
+        ([any_player, s1], [s3], [s2, s6i, s1, s1i]),
+    ]
+
+    for selection, ignored, expected in tests:
+        result = await playerctl.list(players=selection, ignored=ignored)
+        assert result == expected, (selection, ignored, result)
+
+    await asyncio.gather(*[mpris.disconnect() for mpris in mpris_players])
+
+
 @pytest.mark.asyncio
 async def test_daemon_selection(bus_address):
     playerctld = await setup_playerctld(bus_address=bus_address)